@@ -15,7 +15,9 @@
 //
 
 #include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <type_traits>
 
 //  Define M_PI in the case it's not defined in the math header file
 #ifndef M_PI
@@ -46,6 +48,35 @@
 // Define a helpful macro for handling offsets into buffer objects
 #define BUFFER_OFFSET( offset )   ((GLvoid*) (offset))
 
+//----------------------------------------------------------------------------
+//
+// --- SIMD backend of vec4 and mat4 ---
+//
+//   Chosen at compile time from the target: SSE on x86 (with AVX for the
+//   mat4 product when compiled with -mavx), NEON on ARM, else the scalar
+//   code. Define ANGEL_NO_SIMD to force the scalar code.
+//   The SIMD code evaluates the same float operations in the same order as
+//   the scalar code, so its results are bit-identical to it.
+//
+
+#if !defined(ANGEL_NO_SIMD)
+#  if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#    define ANGEL_SIMD      "SSE"
+#    define ANGEL_SIMD_SSE
+#    include <xmmintrin.h>
+#    if defined(__AVX__)
+#      undef  ANGEL_SIMD
+#      define ANGEL_SIMD    "AVX"
+#      define ANGEL_SIMD_AVX
+#      include <immintrin.h>
+#    endif
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define ANGEL_SIMD      "NEON"
+#    define ANGEL_SIMD_NEON
+#    include <arm_neon.h>
+#  endif
+#endif
+
 //----------------------------------------------------------------------------
 //
 //  --- Include our class libraries and constants ---
@@ -57,6 +88,78 @@ namespace Angel {
 GLuint InitShader( const char* vertexShaderFile,
 		   const char* fragmentShaderFile );
 
+//  The same, binding the attributes attribute_names[0 .. num_attributes - 1]
+//  to the locations 0 .. num_attributes - 1 before linking, and compiling
+//  both shaders with the #define lines of defines (if not NULL) inserted
+//  after their #version line
+GLuint InitShader( const char* vertexShaderFile,
+		   const char* fragmentShaderFile,
+		   const char* const attribute_names[], int num_attributes,
+		   const char* defines = NULL );
+
+//  Store the programs linked by InitShader() from now on in directory
+//  (created if needed) with glGetProgramBinary(), and load them from it in
+//  later runs instead of compiling them. A program is stored under a hash
+//  of its shader sources, defines, attribute names and the GL vendor,
+//  renderer and version, so that a change of any of them compiles it
+//  again; so does a binary the driver rejects. NULL turns the cache off.
+void SetProgramCache( const char* directory );
+
+//  Programs InitShader() has created so far, and the time it took (reading
+//  the sources included): compiled and linked from the sources, or loaded
+//  from the program cache
+struct ProgramCounts {
+    int     compiled, loaded;
+    double  compile_ms, load_ms;
+};
+
+ProgramCounts GetProgramCounts();
+
+//  A program object with the locations of its uniforms and attributes,
+//  looked up by name once, after linking, by the InitShader() below instead
+//  of by glGetUniformLocation() / glGetAttribLocation() at every use. The
+//  locations are indexed by enums of the caller; a name the program does
+//  not use gets -1 (which glUniform*() ignores).
+template <int NumUniforms, int NumAttributes>
+struct ShaderProgram {
+    GLuint  id;
+    GLint   uniforms[NumUniforms];
+    GLint   attributes[NumAttributes];
+
+    GLint uniform( int u ) const { return uniforms[u]; }
+    GLint attribute( int a ) const { return attributes[a]; }
+
+    operator GLuint () const { return id; }  // e.g. for glUseProgram()
+};
+
+//  Looks up the locations of count uniform (or attribute) names of program
+void GetProgramLocations( GLuint program, const char* const names[], int count,
+			  GLint locations[], bool attributes );
+
+//  Binds the uniform blocks names[0 .. count - 1] of program to the uniform
+//  buffer binding points 0 .. count - 1 (given in the order of the caller's
+//  enum of the binding points)
+void BindUniformBlocks( GLuint program, const char* const names[], int count );
+
+//  Loads the shader files as InitShader() above, with attribute_names bound to
+//  the values of their enum as locations (so that vertex arrays can be set up
+//  before, and shared between, programs), and looks up the locations of
+//  uniform_names and attribute_names (given in the order of the enums)
+template <int NumUniforms, int NumAttributes>
+ShaderProgram<NumUniforms, NumAttributes>
+InitShader( const char* vertexShaderFile, const char* fragmentShaderFile,
+	    const char* const (&uniform_names)[NumUniforms],
+	    const char* const (&attribute_names)[NumAttributes],
+	    const char* defines = NULL )
+{
+    ShaderProgram<NumUniforms, NumAttributes>  program;
+    program.id = InitShader( vertexShaderFile, fragmentShaderFile, attribute_names, NumAttributes,
+			     defines );
+    GetProgramLocations( program.id, uniform_names, NumUniforms, program.uniforms, false );
+    GetProgramLocations( program.id, attribute_names, NumAttributes, program.attributes, true );
+    return program;
+}
+
 //  Defined constant for when numbers are too small to be used in the
 //    denominator of a division operation.  This is only used if the
 //    DEBUG macro is defined.
@@ -69,6 +172,8 @@ const GLfloat  DegreesToRadians = GLfloat(M_PI / 180.0);
 
 #include "vec.h"
 #include "mat-yjc-new.h"
+#include "quat.h"
+#include "affine.h"
 #include "CheckError.h"
 
 #define Print(x)  do { std::cerr << #x " = " << (x) << std::endl; } while(0)
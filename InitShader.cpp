@@ -1,5 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "Angel-yjc.h"
 
@@ -40,6 +53,217 @@ readShaderSource(const char* shaderFile)
 GLuint
 InitShader(const char* vShaderFile, const char* fShaderFile)
 {
+    return InitShader( vShaderFile, fShaderFile, NULL, 0 );
+}
+
+// The length of the part of a shader source up to and including its #version
+// line (0 without one), after which the #defines of a variant are inserted:
+// #version must stay the first statement, but may follow comments
+static int
+versionLineLength(const char* source)
+{
+    const char* version = strstr(source, "#version");
+    if ( version == NULL ) { return 0; }
+
+    const char* end = strchr(version, '\n');
+    return end ? int(end + 1 - source) : int(strlen(source));
+}
+
+//----------------------------------------------------------------------------
+//
+//  --- Program cache ---
+//
+//   A linked program is stored as "<directory>/<key>.bin": a header, then
+//   the binary of glGetProgramBinary(). The key is a 64-bit FNV-1a hash of
+//   everything the binary depends on, so that a stale binary is never
+//   found; one the driver rejects anyway (glProgramBinary() leaves the
+//   program unlinked) is compiled again and overwritten. A file is written
+//   under a temporary name and renamed into place, so that another run
+//   reading the cache at the same time never sees half of it.
+//
+
+const char      ProgramBinaryMagic[4] = { 'P', 'B', 'I', 'N' };
+const uint32_t  ProgramBinaryVersion  = 1;
+
+struct ProgramBinaryHeader {
+    char      magic[4];   // "PBIN"
+    uint32_t  version;    // ProgramBinaryVersion
+    uint64_t  key;        // the hash the file is named after
+    uint32_t  format;     // binaryFormat of glGetProgramBinary()
+    uint32_t  length;     // bytes of the binary that follows
+};
+
+static std::string    program_cache_directory;   // empty: no cache
+static ProgramCounts  program_counts = { 0, 0, 0.0, 0.0 };
+
+void
+SetProgramCache(const char* directory)
+{
+    program_cache_directory = (directory != NULL) ? directory : "";
+    if ( directory == NULL ) { return; }
+
+#ifdef _WIN32
+    _mkdir( directory );
+#else
+    mkdir( directory, 0755 );
+#endif
+}
+
+ProgramCounts
+GetProgramCounts()
+{
+    return program_counts;
+}
+
+// Adds the string s, with its terminating '\0', to the FNV-1a hash h
+static uint64_t
+hashString(uint64_t h, const char* s)
+{
+    do {
+	h ^= (unsigned char) *s;
+	h *= 0x100000001b3ULL;
+    } while ( *s++ != '\0' );
+    return h;
+}
+
+// The cache file of a program of the sources, defines and attribute names
+// on the current GL driver
+static std::string
+programCacheFile(const char* const sources[2], const char* defines,
+		 const char* const attribute_names[], int num_attributes, uint64_t& key)
+{
+    key = 0xcbf29ce484222325ULL;
+    key = hashString( key, sources[0] );
+    key = hashString( key, sources[1] );
+    key = hashString( key, defines ? defines : "" );
+    for ( int i = 0; i < num_attributes; ++i )
+	key = hashString( key, attribute_names[i] );
+
+    const GLenum driver[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+    for ( int i = 0; i < 4; ++i ) {
+	const GLubyte* name = glGetString( driver[i] );
+	key = hashString( key, name ? (const char*) name : "" );
+    }
+
+    char name[32];
+    snprintf( name, sizeof(name), "/%016llx.bin", (unsigned long long) key );
+    return program_cache_directory + name;
+}
+
+// True if the driver can load binaries of format
+static bool
+programBinaryFormatSupported(GLenum format)
+{
+    GLint count = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &count );
+    if ( count <= 0 ) { return false; }
+
+    std::vector<GLint> formats( count );
+    glGetIntegerv( GL_PROGRAM_BINARY_FORMATS, formats.data() );
+    for ( int i = 0; i < count; ++i )
+	if ( GLenum(formats[i]) == format ) { return true; }
+    return false;
+}
+
+// Links program from the cache file of key; false if there is none, or if
+// it cannot be used
+static bool
+loadProgramBinary(GLuint program, const std::string& cache_file, uint64_t key)
+{
+    FILE* fp = fopen( cache_file.c_str(), "rb" );
+    if ( fp == NULL ) { return false; }  // not cached yet
+
+    fseek( fp, 0L, SEEK_END );
+    long size = ftell( fp );
+    fseek( fp, 0L, SEEK_SET );
+
+    // The binary must fill the rest of the file exactly (a truncated or
+    // corrupted length is never allocated)
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    bool valid = size > long(sizeof(header)) &&
+		 fread( &header, sizeof(header), 1, fp ) == 1 &&
+		 memcmp( header.magic, ProgramBinaryMagic, 4 ) == 0 &&
+		 header.version == ProgramBinaryVersion && header.key == key &&
+		 header.length == uint64_t(size - long(sizeof(header))) &&
+		 programBinaryFormatSupported( header.format );
+    if ( valid ) {
+	binary.resize( header.length );
+	valid = fread( binary.data(), 1, header.length, fp ) == header.length;
+    }
+    fclose( fp );
+
+    if ( valid ) {
+	glProgramBinary( program, header.format, binary.data(), header.length );
+
+	GLint  linked;
+	glGetProgramiv( program, GL_LINK_STATUS, &linked );
+	valid = linked;
+    }
+    if ( !valid )
+	printf("Note: program binary %s cannot be used, compiling the program\n",
+	       cache_file.c_str());
+    return valid;
+}
+
+// Writes the binary of the linked program to cache_file (see SetProgramCache())
+static void
+storeProgramBinary(GLuint program, const std::string& cache_file, uint64_t key)
+{
+    GLint  length = 0;
+    glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+    if ( length <= 0 ) {
+	printf("Note: the GL driver has no program binaries; programs are not cached\n");
+	program_cache_directory.clear();
+	return;
+    }
+
+    std::vector<char> binary( length );
+    GLenum format;
+    glGetProgramBinary( program, length, &length, &format, binary.data() );
+
+    ProgramBinaryHeader header;
+    memcpy( header.magic, ProgramBinaryMagic, 4 );
+    header.version = ProgramBinaryVersion;
+    header.key = key;
+    header.format = format;
+    header.length = length;
+
+    // Written under a name of this process, then renamed into place
+#ifdef _WIN32
+    std::string temp_file = cache_file + "." + std::to_string( _getpid() ) + ".tmp";
+#else
+    std::string temp_file = cache_file + "." + std::to_string( getpid() ) + ".tmp";
+#endif
+    FILE* fp = fopen( temp_file.c_str(), "wb" );
+    bool written = fp != NULL && fwrite( &header, sizeof(header), 1, fp ) == 1 &&
+		   fwrite( binary.data(), 1, length, fp ) == size_t(length);
+    if ( fp != NULL && fclose( fp ) != 0 ) { written = false; }
+
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows
+    if ( written ) { remove( cache_file.c_str() ); }
+#endif
+    if ( written ) { written = rename( temp_file.c_str(), cache_file.c_str() ) == 0; }
+
+    if ( !written ) {
+	// Not fatal: the program is compiled again in the next run
+	std::cerr << "Warning: program binary could not be written: " << cache_file << std::endl;
+	remove( temp_file.c_str() );
+    }
+}
+
+// Create a GLSL program object from vertex and fragment shader files, with
+// the attributes attribute_names[i] at the locations i and the #define
+// lines of defines (if any); it is loaded from the program cache instead
+// if it is there
+GLuint
+InitShader(const char* vShaderFile, const char* fShaderFile,
+	   const char* const attribute_names[], int num_attributes,
+	   const char* defines)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
     struct Shader {
 	const char*  filename;
 	GLenum       type;
@@ -49,8 +273,6 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	{ fShaderFile, GL_FRAGMENT_SHADER, NULL }
     };
 
-    GLuint program = glCreateProgram();
-    
     for ( int i = 0; i < 2; ++i ) {
 	Shader& s = shaders[i];
 	s.source = readShaderSource( s.filename );
@@ -59,15 +281,46 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	    exit( EXIT_FAILURE );	
 	   }
         else printf("Successfully read %s\n", s.filename);
+    }
+
+    GLuint program = glCreateProgram();
+
+    std::string cache_file;
+    uint64_t key = 0;
+    if ( !program_cache_directory.empty() ) {
+	const char* const sources[2] = { shaders[0].source, shaders[1].source };
+	cache_file = programCacheFile( sources, defines, attribute_names, num_attributes, key );
+
+	if ( loadProgramBinary( program, cache_file, key ) ) {
+	    printf("Loaded program binary %s\n\n", cache_file.c_str());
+	    for ( int i = 0; i < 2; ++i )
+		delete [] shaders[i].source;
+
+	    program_counts.loaded++;
+	    program_counts.load_ms += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start ).count();
+	    return program;
+	}
+    }
+
+    for ( int i = 0; i < 2; ++i ) {
+	Shader& s = shaders[i];
+
+	// The source is passed as its #version line, the defines, and the rest
+	int head = versionLineLength( s.source );
+	const GLchar* parts[3] = { s.source, defines ? defines : "", s.source + head };
+	GLint lengths[3] = { head, -1, -1 };
 
 	GLuint shader = glCreateShader( s.type );
-	glShaderSource( shader, 1, (const GLchar**) &s.source, NULL );
+	glShaderSource( shader, 3, parts, lengths );
 	glCompileShader( shader );
 
 	GLint  compiled;
 	glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
 	if ( !compiled ) {
 	    std::cerr << s.filename << " failed to compile:" << std::endl;
+	    if ( defines != NULL )
+		std::cerr << "(with the defines)" << std::endl << defines;
 	    GLint  logSize;
 	    glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &logSize );
 	    char* logMsg = new char[logSize];
@@ -84,7 +337,14 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
 	glAttachShader( program, shader );
     }
 
+    /* bind the attributes to fixed locations, so that vertex arrays
+       set up with them work with any program using the same names */
+    for ( int i = 0; i < num_attributes; ++i )
+	glBindAttribLocation( program, i, attribute_names[i] );
+
     /* link and error check */
+    if ( !cache_file.empty() )
+	glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
     glLinkProgram(program);
 
     GLint  linked;
@@ -102,6 +362,13 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
     }
     else printf("Successfully linked program object\n\n");
 
+    if ( !cache_file.empty() )
+	storeProgramBinary( program, cache_file, key );
+
+    program_counts.compiled++;
+    program_counts.compile_ms += std::chrono::duration<double, std::milli>(
+	std::chrono::steady_clock::now() - start ).count();
+
 #if 0 /* YJC: Do NOT use this program obj yet!
               Call glUseProgram() outside, in suitable places inside display(),
               to apply different shading programs on different objects.
@@ -113,4 +380,32 @@ InitShader(const char* vShaderFile, const char* fShaderFile)
     return program;
 }
 
+// Look up the locations of the uniforms (or attributes) of a linked program
+void
+GetProgramLocations(GLuint program, const char* const names[], int count,
+		    GLint locations[], bool attributes)
+{
+    for ( int i = 0; i < count; ++i ) {
+	locations[i] = attributes ? glGetAttribLocation( program, names[i] )
+				  : glGetUniformLocation( program, names[i] );
+	if ( locations[i] < 0 )  // e.g. optimized out by the compiler
+	    printf("Note: %s %s is not active in program %u\n",
+		   attributes ? "attribute" : "uniform", names[i], program);
+    }
+}
+
+// Bind the uniform blocks of a linked program to consecutive binding points
+void
+BindUniformBlocks(GLuint program, const char* const names[], int count)
+{
+    for ( int i = 0; i < count; ++i ) {
+	GLuint index = glGetUniformBlockIndex( program, names[i] );
+	if ( index == GL_INVALID_INDEX )  // e.g. optimized out by the compiler
+	    printf("Note: uniform block %s is not active in program %u\n",
+		   names[i], program);
+	else
+	    glUniformBlockBinding( program, index, i );
+    }
+}
+
 }  // Close namespace Angel block
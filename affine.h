@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- affine.h ---
+//
+//   affine3x4: an affine transform stored as the top 3 rows of a mat4 (in row
+//   order); the bottom row is always (0, 0, 0, 1) and is neither stored nor
+//   multiplied. The product of two affine3x4s takes 36 multiplies instead of
+//   the 64 of a mat4 product, and mat4 * affine3x4 takes 48.
+//
+//   Object and view transforms are composed as affine3x4s (with the fused
+//   generators below, e.g. AffineTranslateRotate() builds Translate(t) *
+//   Rotate(q) without a product) and converted to a mat4 only where a full
+//   matrix is needed: for glUniformMatrix4fv(), NormalMatrix() or a product
+//   with a projective matrix.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ANGEL_AFFINE_H__
+#define __ANGEL_AFFINE_H__
+
+#include "Angel-yjc.h"
+
+namespace Angel {
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  affine3x4 - 3D affine transform (3x4 matrix)
+//
+
+class affine3x4 {
+
+    vec4  _m[3];
+
+   public:
+    //
+    //  --- Constructors and Destructors ---
+    //
+
+    constexpr affine3x4()  // the identity
+	: _m{ vec4( 1.0, 0.0, 0.0, 0.0 ), vec4( 0.0, 1.0, 0.0, 0.0 ), vec4( 0.0, 0.0, 1.0, 0.0 ) } {}
+
+    constexpr affine3x4( const vec4& a, const vec4& b, const vec4& c )  // the rows
+	: _m{ a, b, c } {}
+
+    //  The top 3 rows of m, which must be affine (bottom row (0, 0, 0, 1))
+    constexpr explicit affine3x4( const mat4& m )
+	: _m{ m[0], m[1], m[2] } {}
+
+    //
+    //  --- Indexing Operator ---
+    //
+
+    constexpr vec4& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec4& operator [] ( int i ) const { return _m[i]; }
+
+    //
+    //  --- Arithmetic Operators ---
+    //
+
+    //  (*this) * a: row i is the sum over k < 3 of _m[i][k] * (row k of a),
+    //  plus _m[i][3] in w (the implicit bottom row of a)
+    affine3x4 operator * ( const affine3x4& a ) const {
+	affine3x4  c;
+
+#ifdef ANGEL_SIMD
+	simd4  a0 = a._m[0].simd(), a1 = a._m[1].simd(), a2 = a._m[2].simd();
+	for ( int i = 0; i < 3; ++i ) {
+	    simd4  sum = simdMul( simdSplat( _m[i][0] ), a0 );
+	    sum = simdAdd( sum, simdMul( simdSplat( _m[i][1] ), a1 ) );
+	    sum = simdAdd( sum, simdMul( simdSplat( _m[i][2] ), a2 ) );
+	    c._m[i] = vec4( simdAdd( sum, simdSetW( _m[i][3] ) ) );
+	}
+#else
+	for ( int i = 0; i < 3; ++i ) {
+	    for ( int j = 0; j < 4; ++j )
+		c._m[i][j] = _m[i][0]*a._m[0][j] + _m[i][1]*a._m[1][j] + _m[i][2]*a._m[2][j];
+	    c._m[i][3] += _m[i][3];
+	}
+#endif // ANGEL_SIMD
+
+	return c;
+    }
+
+    affine3x4& operator *= ( const affine3x4& a )
+	{ return *this = *this * a; }
+
+    //  m * a (a mat4 result, e.g. for a projective m)
+    friend mat4 operator * ( const mat4& m, const affine3x4& a ) {
+	mat4  c;
+
+#ifdef ANGEL_SIMD
+	simd4  a0 = a._m[0].simd(), a1 = a._m[1].simd(), a2 = a._m[2].simd();
+	for ( int i = 0; i < 4; ++i ) {
+	    simd4  sum = simdMul( simdSplat( m[i][0] ), a0 );
+	    sum = simdAdd( sum, simdMul( simdSplat( m[i][1] ), a1 ) );
+	    sum = simdAdd( sum, simdMul( simdSplat( m[i][2] ), a2 ) );
+	    c[i] = vec4( simdAdd( sum, simdSetW( m[i][3] ) ) );
+	}
+#else
+	for ( int i = 0; i < 4; ++i ) {
+	    for ( int j = 0; j < 4; ++j )
+		c[i][j] = m[i][0]*a._m[0][j] + m[i][1]*a._m[1][j] + m[i][2]*a._m[2][j];
+	    c[i][3] += m[i][3];
+	}
+#endif // ANGEL_SIMD
+
+	return c;
+    }
+
+    vec4 operator * ( const vec4& v ) const {  // a * v
+	return vec4( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
+		     _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
+		     _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
+		     v.w );
+    }
+
+    //
+    //  --- Conversion Operators ---
+    //
+
+    //  The full matrix, e.g. for glUniformMatrix4fv() or NormalMatrix()
+    constexpr operator mat4 () const
+	{ return mat4( _m[0], _m[1], _m[2], vec4( 0.0, 0.0, 0.0, 1.0 ) ); }
+
+    //
+    //  --- Insertion Operator ---
+    //
+
+    friend std::ostream& operator << ( std::ostream& os, const affine3x4& a ) {
+	return os << std::endl
+		  << a[0] << std::endl
+		  << a[1] << std::endl
+		  << a[2] << std::endl;
+    }
+};
+
+//----------------------------------------------------------------------------
+//
+//  affine3x4 generators (the affine3x4 of Translate(), Rotate() and LookAt())
+//
+
+constexpr
+affine3x4 AffineTranslate( const GLfloat x, const GLfloat y, const GLfloat z )
+{
+    return affine3x4( vec4( 1.0, 0.0, 0.0, x ), vec4( 0.0, 1.0, 0.0, y ),
+		      vec4( 0.0, 0.0, 1.0, z ) );
+}
+
+//  Translate(t.x, t.y, t.z) * Rotate(q), without a product: the rotation
+//  matrix of q with t in its last column
+inline
+affine3x4 AffineTranslateRotate( const vec4& t, const quat& q )
+{
+    const GLfloat  x2 = q.x + q.x,  y2 = q.y + q.y,  z2 = q.z + q.z;
+    const GLfloat  xx = q.x * x2,  yy = q.y * y2,  zz = q.z * z2;
+    const GLfloat  xy = q.x * y2,  xz = q.x * z2,  yz = q.y * z2;
+    const GLfloat  wx = q.w * x2,  wy = q.w * y2,  wz = q.w * z2;
+
+    return affine3x4( vec4( 1.0f - (yy + zz), xy - wz, xz + wy, t.x ),
+		      vec4( xy + wz, 1.0f - (xx + zz), yz - wx, t.y ),
+		      vec4( xz - wy, yz + wx, 1.0f - (xx + yy), t.z ) );
+}
+
+inline
+affine3x4 AffineRotate( const quat& q )
+{
+    return AffineTranslateRotate( vec4( 0.0, 0.0, 0.0, 1.0 ), q );
+}
+
+//  LookAt(eye, at, up), with the translation by -eye folded into the last
+//  column (3 dot products instead of a mat4 product)
+inline
+affine3x4 AffineLookAt( const vec4& eye, const vec4& at, const vec4& up )
+{
+    vec4 n = normalize(eye - at);
+    vec4 u = normalize( vec4(cross(up,n),0) );
+    vec4 v = normalize( vec4(cross(n,u),0) );
+
+    return affine3x4( vec4( u.x, u.y, u.z, -(u.x*eye.x + u.y*eye.y + u.z*eye.z) ),
+		      vec4( v.x, v.y, v.z, -(v.x*eye.x + v.y*eye.y + v.z*eye.z) ),
+		      vec4( n.x, n.y, n.z, -(n.x*eye.x + n.y*eye.y + n.z*eye.z) ) );
+}
+
+static_assert( std::is_trivially_copyable<affine3x4>::value && std::is_standard_layout<affine3x4>::value &&
+	       sizeof(affine3x4) == 12 * sizeof(GLfloat), "affine3x4 must be 12 packed GLfloats" );
+
+}  // namespace Angel
+
+#endif // __ANGEL_AFFINE_H__
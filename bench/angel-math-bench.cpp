@@ -0,0 +1,253 @@
+/************************************************************
+ * File: angel-math-bench.cpp
+
+ * Microbenchmark suite of the math headers (vec.h, mat-yjc-new.h, quat.h,
+   affine.h): the generators (Rotate(), RotateX(), Translate(), LookAt(),
+   Perspective(), Rotate(quat), AffineLookAt()), NormalMatrix(), inverse()
+   of mat3 and mat4, transpose1() and the matrix products, i.e. what
+   display() runs several times per frame.
+
+ * The inputs are arrays of 1024 operands drawn as the program draws them:
+   rotation angles and axes of the rolling, eye positions around the scene,
+   the Perspective() parameters of reshape(), and model-view matrices built
+   from those (rigid, with a non-uniform scale, and with the projection).
+   Each function is timed as ns per operation, the best of several runs
+   cycling through its inputs, and as millions of operations per second.
+
+ * The checksum of a function is the sum of all the entries of its results
+   over one pass of the inputs, so that a diff of two runs also shows a
+   change of the results. The table is printed to stdout, and written as
+   JSON (one result per line) to json_file if given ("-" for stdout).
+   No GL context is needed.
+
+ * Usage: angel-math-bench [operations] [json_file]   (default 2000000 per function)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#ifndef ANGEL_SIMD
+#  define ANGEL_SIMD  "none (scalar)"
+#endif
+
+const int NumInputs = 1024;  // operands per function, cycled through by the timing loop
+
+static FILE* table = stdout;  // stderr when the JSON goes to stdout
+
+//----------------------------------------------------------------------------
+//
+//  The inputs, drawn as in "rotate-sphere-texture.cpp"
+//
+
+struct Inputs {
+    vector<GLfloat>    angles;        // degrees
+    vector<vec4>       axes;          // rotation axes of the rolling (in the xz plane), and others
+    vector<vec4>       eyes;          // viewer positions
+    vector<vec4>       positions;     // sphere positions on the ground
+    vector<vec4>       points;
+    vector<vec4>       projections;   // (fovy, aspect, zNear, zFar)
+    vector<quat>       orientations;
+    vector<mat4>       rigid, affine, projective;  // model-views
+    vector<mat3>       rotations, linear;          // their upper-left 3x3s
+    vector<affine3x4>  views, models;
+};
+
+//----------------------------------------------------------------------------
+// drawInputs(in):
+// Fills in with NumInputs operands of each kind (with a fixed seed, so that
+// the checksums of two runs are comparable).
+//
+//----------------------------------------------------------------------------
+static void drawInputs(Inputs& in)
+{
+    mt19937 rng(6533);
+    uniform_real_distribution<GLfloat> unit(-1.0f, 1.0f);
+    uniform_real_distribution<GLfloat> angle(-180.0f, 180.0f);
+    uniform_real_distribution<GLfloat> scale(0.25f, 4.0f);
+    const vec4 at(0.0f, 0.0f, 0.0f, 1.0f), up(0.0f, 1.0f, 0.0f, 0.0f);
+
+    for (int i = 0; i < NumInputs; i++) {
+        in.angles.push_back(angle(rng));
+        if (i % 2 == 0)  // cross(y, direction) of the rolling
+            in.axes.push_back(vec4(cross(vec3(0, 1, 0), normalize(vec3(unit(rng), 0.0f, unit(rng)))), 0.0f));
+        else
+            in.axes.push_back(vec4(unit(rng), unit(rng), 1.0f, 0.0f));
+        in.eyes.push_back(vec4(10.0f * unit(rng), 2.0f + 5.0f * fabs(unit(rng)), 10.0f * unit(rng), 1.0f));
+        in.positions.push_back(vec4(5.0f * unit(rng), 1.0f, 5.0f * unit(rng), 1.0f));
+        in.points.push_back(vec4(unit(rng), unit(rng), unit(rng), 1.0f));
+        in.projections.push_back(vec4(45.0f + 30.0f * unit(rng), 1.0f + 0.5f * unit(rng), 0.5f, 60.0f + 20.0f * unit(rng)));
+        in.orientations.push_back(normalize(Quaternion(angle(rng), unit(rng), unit(rng), 1.0f)));
+
+        const vec4& axis = in.axes.back();
+        mat4 mv = LookAt(in.eyes.back(), at, up) * Translate(in.positions.back())
+                * Rotate(in.angles.back(), axis.x, axis.y, axis.z) * Rotate(in.orientations.back());
+        in.rigid.push_back(mv);
+        in.affine.push_back(mv * Scale(scale(rng), scale(rng), scale(rng)));
+        in.projective.push_back(Perspective(in.projections.back().x, in.projections.back().y,
+                                            in.projections.back().z, in.projections.back().w) * mv);
+        in.rotations.push_back(upperLeftMat3(in.rigid.back()));
+        in.linear.push_back(upperLeftMat3(in.affine.back()));
+        in.views.push_back(AffineLookAt(in.eyes.back(), at, up));
+        in.models.push_back(AffineTranslateRotate(in.positions.back(), in.orientations.back()));
+    }
+}
+
+//----------------------------------------------------------------------------
+// sum(...):
+// Returns the sum of the entries of a result (so that the timed results are
+// used, and for the checksums).
+//
+//----------------------------------------------------------------------------
+static GLfloat sum(const GLfloat* m, int n)
+{
+    GLfloat s = 0.0f;
+    for (int i = 0; i < n; i++)
+        s += m[i];
+    return s;
+}
+
+static GLfloat sum(const mat4& m)       { return sum(m, 16); }
+static GLfloat sum(const mat3& m)       { return sum(m, 9); }
+static GLfloat sum(const vec4& v)       { return sum(v, 4); }
+static GLfloat sum(const quat& q)       { return q.x + q.y + q.z + q.w; }
+static GLfloat sum(const affine3x4& a)  { return sum(a[0]) + sum(a[1]) + sum(a[2]); }
+
+//----------------------------------------------------------------------------
+//
+//  The measurements
+//
+
+struct Result {
+    const char*  name;
+    double       ns_per_op;
+    double       checksum;
+};
+
+//----------------------------------------------------------------------------
+// measure(name, operations, func, results):
+// Times operations calls of func(i) (i cycling through the inputs), best of
+// 5 runs, and appends the result with the checksum of one pass.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static void measure(const char* name, long long operations, Func func, vector<Result>& results)
+{
+    double checksum = 0.0;
+    for (int i = 0; i < NumInputs; i++)
+        checksum += func(i);
+
+    GLfloat sink = 0.0f;
+    double best = 1.0e30;
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (long long i = 0; i < operations; i++)
+            sink += func((int) (i & (NumInputs - 1)));
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    if (sink == 12345.0f)
+        printf(" ");
+
+    Result r = { name, best * 1.0e9 / operations, checksum };
+    results.push_back(r);
+    fprintf(table, "%-36s  %10.2f  %10.1f  %16.6e\n", r.name, r.ns_per_op, 1.0e3 / r.ns_per_op, r.checksum);
+}
+
+//----------------------------------------------------------------------------
+// writeJson(file, operations, results):
+// Writes the results as JSON, one result per line.
+//
+//----------------------------------------------------------------------------
+static bool writeJson(FILE* file, long long operations, const vector<Result>& results)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"angel-math-bench\",\n");
+    fprintf(file, "  \"simd\": \"%s\",\n", ANGEL_SIMD);
+    fprintf(file, "  \"operations\": %lld,\n", operations);
+    fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+        fprintf(file, "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"mops_per_s\": %.3f, \"checksum\": %.9e }%s\n",
+                results[i].name, results[i].ns_per_op, 1.0e3 / results[i].ns_per_op, results[i].checksum,
+                (i + 1 < results.size()) ? "," : "");
+    fprintf(file, "  ]\n}\n");
+    return !ferror(file);
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    long long operations = (argc > 1) ? atoll(argv[1]) : 2000000;
+    const char* json_file = (argc > 2) ? argv[2] : NULL;
+
+    Inputs in;
+    drawInputs(in);
+    const vec4 at(0.0f, 0.0f, 0.0f, 1.0f), up(0.0f, 1.0f, 0.0f, 0.0f);
+
+    bool json_to_stdout = json_file && (strcmp(json_file, "-") == 0);
+    if (json_to_stdout)
+        table = stderr;
+
+    fprintf(table, "SIMD backend: %s\n", ANGEL_SIMD);
+    fprintf(table, "%-36s  %10s  %10s  %16s\n", "function", "ns/op", "Mops/s", "checksum");
+
+    vector<Result> results;
+
+    // Generators
+    measure("Rotate(angle, x, y, z)", operations, [&](int i) {
+        return sum(Rotate(in.angles[i], in.axes[i].x, in.axes[i].y, in.axes[i].z)); }, results);
+    measure("RotateX(angle)", operations, [&](int i) { return sum(RotateX(in.angles[i])); }, results);
+    measure("Translate(x, y, z)", operations, [&](int i) {
+        return sum(Translate(in.positions[i].x, in.positions[i].y, in.positions[i].z)); }, results);
+    measure("LookAt(eye, at, up)", operations, [&](int i) { return sum(LookAt(in.eyes[i], at, up)); }, results);
+    measure("Perspective(fovy, aspect, near, far)", operations, [&](int i) {
+        const vec4& p = in.projections[i];
+        return sum(Perspective(p.x, p.y, p.z, p.w)); }, results);
+    measure("Rotate(quat)", operations, [&](int i) { return sum(Rotate(in.orientations[i])); }, results);
+    measure("AffineLookAt(eye, at, up)", operations, [&](int i) { return sum(AffineLookAt(in.eyes[i], at, up)); }, results);
+
+    // Normal matrices and inverses
+    measure("NormalMatrix(rigid mv, TransformRigid)", operations, [&](int i) {
+        return sum(NormalMatrix(in.rigid[i], TransformRigid)); }, results);
+    measure("NormalMatrix(affine mv, 1)", operations, [&](int i) { return sum(NormalMatrix(in.affine[i], 1)); }, results);
+    measure("NormalMatrix(mv, 0)", operations, [&](int i) { return sum(NormalMatrix(in.affine[i], 0)); }, results);
+    measure("inverse(rotation mat3)", operations, [&](int i) { return sum(inverse(in.rotations[i], TransformRigid)); }, results);
+    measure("inverse(mat3)", operations, [&](int i) { return sum(inverse(in.linear[i])); }, results);
+    measure("inverse(rigid mat4)", operations, [&](int i) { return sum(inverse(in.rigid[i], TransformRigid)); }, results);
+    measure("inverse(affine mat4)", operations, [&](int i) { return sum(inverse(in.affine[i], TransformAffine)); }, results);
+    measure("inverse(projective mat4)", operations, [&](int i) { return sum(inverse(in.projective[i])); }, results);
+    measure("transpose1(mat3)", operations, [&](int i) { return sum(transpose1(in.linear[i])); }, results);
+    measure("transpose1(mat4)", operations, [&](int i) { return sum(transpose1(in.projective[i])); }, results);
+
+    // Products
+    measure("mat4 * mat4", operations, [&](int i) {
+        return sum(in.projective[i] * in.affine[(i + 1) & (NumInputs - 1)]); }, results);
+    measure("mat4 * vec4", operations, [&](int i) { return sum(in.projective[i] * in.points[i]); }, results);
+    measure("mat3 * mat3", operations, [&](int i) {
+        return sum(in.linear[i] * in.rotations[(i + 1) & (NumInputs - 1)]); }, results);
+    measure("quat * quat", operations, [&](int i) {
+        return sum(in.orientations[i] * in.orientations[(i + 1) & (NumInputs - 1)]); }, results);
+    measure("affine3x4 * affine3x4", operations, [&](int i) { return sum(in.views[i] * in.models[i]); }, results);
+    measure("mat4 * affine3x4", operations, [&](int i) { return sum(in.projective[i] * in.models[i]); }, results);
+
+    if (json_file) {
+        FILE* file = json_to_stdout ? stdout : fopen(json_file, "w");
+        if (!file) {
+            printf("Error: cannot open %s\n", json_file);
+            return EXIT_FAILURE;
+        }
+        bool ok = writeJson(file, operations, results);
+        if (!json_to_stdout)
+            ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            printf("Error: cannot write %s\n", json_file);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
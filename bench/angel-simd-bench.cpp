@@ -0,0 +1,332 @@
+/************************************************************
+ * File: angel-simd-bench.cpp
+
+ * Correctness check and microbenchmark of the SIMD backend of vec4 and
+   mat4 (Angel-yjc.h, vec.h, mat-yjc-new.h) against the original scalar
+   code, which is copied here as the reference: mat4 * mat4, mat4 * vec4,
+   transpose1(), the vec4 arithmetic, and the chain of 5 products of
+   drawShadow() (LookAt * N * Translate * R * M).
+
+ * Every result of the backend is compared against the reference and the
+   largest difference is reported in ULPs (0: bit-identical), over random
+   matrices and vectors that include zeros of both signs. The times are
+   ns per operation, best of several runs over arrays of operands.
+
+ * Usage: angel-simd-bench [operations]   (default 2000000 per measurement)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+#ifndef ANGEL_SIMD
+#  define ANGEL_SIMD  "none (scalar)"
+#endif
+
+//----------------------------------------------------------------------------
+// seconds(start):
+// Returns the time elapsed since start in seconds.
+//
+//----------------------------------------------------------------------------
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// Original scalar code of vec.h / mat-yjc-new.h (the operations measured),
+// with the implicit copies instead of its user-declared copy constructors
+//
+//----------------------------------------------------------------------------
+struct Vec {
+    GLfloat  x, y, z, w;
+
+    Vec( GLfloat s = GLfloat(0.0) ) : x(s), y(s), z(s), w(s) {}
+    Vec( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) : x(x), y(y), z(z), w(w) {}
+
+    GLfloat& operator [] ( int i ) { return *(&x + i); }
+    GLfloat operator [] ( int i ) const { return *(&x + i); }
+
+    Vec operator - () const { return Vec( -x, -y, -z, -w ); }
+    Vec operator + ( const Vec& v ) const { return Vec( x + v.x, y + v.y, z + v.z, w + v.w ); }
+    Vec operator - ( const Vec& v ) const { return Vec( x - v.x, y - v.y, z - v.z, w - v.w ); }
+    Vec operator * ( const GLfloat s ) const { return Vec( s*x, s*y, s*z, s*w ); }
+    Vec operator * ( const Vec& v ) const { return Vec( x*v.x, y*v.y, z*v.z, w*v.w ); }
+    friend Vec operator * ( const GLfloat s, const Vec& v ) { return v * s; }
+
+    Vec& operator += ( const Vec& v ) { x += v.x;  y += v.y;  z += v.z;  w += v.w;  return *this; }
+    Vec& operator -= ( const Vec& v ) { x -= v.x;  y -= v.y;  z -= v.z;  w -= v.w;  return *this; }
+    Vec& operator *= ( const GLfloat s ) { x *= s;  y *= s;  z *= s;  w *= s;  return *this; }
+    Vec& operator *= ( const Vec& v ) { x *= v.x, y *= v.y, z *= v.z, w *= v.w;  return *this; }
+
+    operator const GLfloat* () const { return static_cast<const GLfloat*>( &x ); }
+    operator GLfloat* () { return static_cast<GLfloat*>( &x ); }
+};
+
+class Mat {
+    Vec  _m[4];
+
+  public:
+    Mat( const GLfloat d = GLfloat(1.0) ) { _m[0].x = d;  _m[1].y = d;  _m[2].z = d;  _m[3].w = d; }
+
+    Mat( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
+         GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
+         GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
+         GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 )
+    {
+        _m[0] = Vec( m00, m01, m02, m03 );
+        _m[1] = Vec( m10, m11, m12, m13 );
+        _m[2] = Vec( m20, m21, m22, m23 );
+        _m[3] = Vec( m30, m31, m32, m33 );
+    }
+
+    Vec& operator [] ( int i ) { return _m[i]; }
+    const Vec& operator [] ( int i ) const { return _m[i]; }
+
+    Mat operator * ( const Mat& m ) const {
+        Mat  a( 0.0 );
+        for ( int i = 0; i < 4; ++i )
+            for ( int j = 0; j < 4; ++j )
+                for ( int k = 0; k < 4; ++k )
+                    a[i][j] += _m[i][k] * m[k][j];
+        return a;
+    }
+
+    Vec operator * ( const Vec& v ) const {
+        return Vec( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
+                    _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
+                    _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
+                    _m[3][0]*v.x + _m[3][1]*v.y + _m[3][2]*v.z + _m[3][3]*v.w );
+    }
+
+    operator const GLfloat* () const { return static_cast<const GLfloat*>( &_m[0].x ); }
+    operator GLfloat* () { return static_cast<GLfloat*>( &_m[0].x ); }
+};
+
+static Mat scalarTranspose( const Mat& A ) {
+    return Mat( A[0][0], A[0][1], A[0][2], A[0][3],
+                A[1][0], A[1][1], A[1][2], A[1][3],
+                A[2][0], A[2][1], A[2][2], A[2][3],
+                A[3][0], A[3][1], A[3][2], A[3][3] );
+}
+
+//----------------------------------------------------------------------------
+// ulps(a, b):
+// Returns the distance of the floats a and b in units in the last place
+// (0 if they are bit-identical; +0 and -0 are 1 apart).
+//
+//----------------------------------------------------------------------------
+static int64_t ulps(GLfloat a, GLfloat b)
+{
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    int64_t la = (ia < 0) ? -(int64_t) (ia & 0x7FFFFFFF) - 1 : ia;  // monotonic, -0 just below +0
+    int64_t lb = (ib < 0) ? -(int64_t) (ib & 0x7FFFFFFF) - 1 : ib;
+    return (la > lb) ? la - lb : lb - la;
+}
+
+static int64_t maxUlps(const GLfloat* a, const GLfloat* b, int n)
+{
+    int64_t worst = 0;
+    for (int i = 0; i < n; i++)
+        worst = max(worst, ulps(a[i], b[i]));
+    return worst;
+}
+
+//----------------------------------------------------------------------------
+// Random operands: values in [-2, 2], with about 1 in 8 being +0 or -0
+//
+//----------------------------------------------------------------------------
+static GLfloat randomValue()
+{
+    int r = rand() % 16;
+    if (r == 0) return 0.0f;
+    if (r == 1) return -0.0f;
+    return 4.0f * rand() / (GLfloat) RAND_MAX - 2.0f;
+}
+
+static mat4 randomMat4(Mat& reference)
+{
+    mat4 m;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            reference[i][j] = m[i][j] = randomValue();
+    return m;
+}
+
+static vec4 randomVec4(Vec& reference)
+{
+    vec4 v;
+    for (int i = 0; i < 4; i++)
+        reference[i] = v[i] = randomValue();
+    return v;
+}
+
+//----------------------------------------------------------------------------
+// bestTime(runs, func):
+// Returns the shortest of runs calls of func in seconds.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static double bestTime(int runs, Func func)
+{
+    double best = 1.0e30;
+    for (int r = 0; r < runs; r++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        func();
+        best = min(best, seconds(start));
+    }
+    return best;
+}
+
+static void report(const char* name, long long operations, double scalar_time, double simd_time, int64_t max_ulps)
+{
+    printf("%-28s  %10.2f  %10.2f  %7.2fx  %8lld\n", name, 1.0e9 * scalar_time / operations,
+           1.0e9 * simd_time / operations, scalar_time / simd_time, (long long) max_ulps);
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    long long operations = (argc > 1) ? atoll(argv[1]) : 2000000;
+    const int count = 1024;  // operands cycled through (they stay in L1); a power of 2 for the masks
+    const int mask = count - 1;
+    int runs = 9;
+
+    srand(6533);
+    vector<mat4> A(count), B(count);
+    vector<Mat> refA(count), refB(count);
+    vector<vec4> V(count), W(count);
+    vector<Vec> refV(count), refW(count);
+    for (int i = 0; i < count; i++) {
+        A[i] = randomMat4(refA[i]);
+        B[i] = randomMat4(refB[i]);
+        V[i] = randomVec4(refV[i]);
+        W[i] = randomVec4(refW[i]);
+    }
+
+    printf("SIMD backend: %s\n", ANGEL_SIMD);
+    printf("%-28s  %10s  %10s  %8s  %8s\n", "operation", "scalar ns", "simd ns", "speedup", "max ULP");
+
+    vector<mat4> C(count);
+    vector<Mat> refC(count);
+    vector<vec4> U(count);
+    vector<Vec> refU(count);
+    volatile GLfloat sink = 0.0f;
+
+    // mat4 * mat4
+    {
+        int64_t worst = 0;
+        for (int i = 0; i < count; i++) {
+            C[i] = A[i] * B[i];
+            refC[i] = refA[i] * refB[i];
+            worst = max(worst, maxUlps(C[i], refC[i], 16));
+        }
+        double scalar_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                refC[n & mask] = refA[n & mask] * refB[(n + 1) & mask];
+        });
+        double simd_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                C[n & mask] = A[n & mask] * B[(n + 1) & mask];
+        });
+        report("mat4 * mat4", operations, scalar_time, simd_time, worst);
+    }
+
+    // mat4 * vec4
+    {
+        int64_t worst = 0;
+        for (int i = 0; i < count; i++) {
+            U[i] = A[i] * V[i];
+            refU[i] = refA[i] * refV[i];
+            worst = max(worst, maxUlps(U[i], refU[i], 4));
+        }
+        double scalar_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                refU[n & mask] = refA[n & mask] * refV[(n + 1) & mask];
+        });
+        double simd_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                U[n & mask] = A[n & mask] * V[(n + 1) & mask];
+        });
+        report("mat4 * vec4", operations, scalar_time, simd_time, worst);
+    }
+
+    // transpose1()
+    {
+        int64_t worst = 0;
+        for (int i = 0; i < count; i++) {
+            C[i] = transpose1(A[i]);
+            refC[i] = scalarTranspose(refA[i]);
+            worst = max(worst, maxUlps(C[i], refC[i], 16));
+        }
+        double scalar_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                refC[n & mask] = scalarTranspose(refA[(n * 7) & mask]);
+        });
+        double simd_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                C[n & mask] = transpose1(A[(n * 7) & mask]);
+        });
+        report("transpose1(mat4)", operations, scalar_time, simd_time, worst);
+    }
+
+    // vec4 arithmetic: s * a + b timed, every operator checked
+    {
+        int64_t worst = 0;
+        for (int i = 0; i < count; i++) {
+            GLfloat s = W[i].x;
+            vec4 r[6] = { s * V[i] + W[i], V[i] - W[i], V[i] * W[i], -V[i], V[i], V[i] };
+            Vec ref[6] = { s * refV[i] + refW[i], refV[i] - refW[i], refV[i] * refW[i], -refV[i], refV[i], refV[i] };
+            r[4] += W[i];  r[4] -= V[i];  r[4] *= s;  r[4] *= W[i];  r[5] = r[5] / s;
+            ref[4] += refW[i];  ref[4] -= refV[i];  ref[4] *= s;  ref[4] *= refW[i];  ref[5] = ref[5] * (GLfloat(1.0) / s);
+            for (int j = 0; j < 6; j++)
+                worst = max(worst, maxUlps(r[j], ref[j], 4));
+        }
+        double scalar_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                refU[n & mask] = refW[(n + 1) & mask].y * refV[n & mask] + refW[(n + 2) & mask];
+        });
+        double simd_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < operations; n++)
+                U[n & mask] = W[(n + 1) & mask].y * V[n & mask] + W[(n + 2) & mask];
+        });
+        report("vec4: s * a + b", operations, scalar_time, simd_time, worst);
+    }
+
+    // drawShadow(): LookAt * N * Translate * R * M
+    {
+        long long chains = operations / 4;
+        int64_t worst = 0;
+        for (int i = 0; i + 4 < count; i++) {
+            mat4 chain = A[i] * B[i] * A[i + 1] * B[i + 1] * A[i + 2];
+            Mat ref = refA[i] * refB[i] * refA[i + 1] * refB[i + 1] * refA[i + 2];
+            worst = max(worst, maxUlps(chain, ref, 16));
+        }
+        double scalar_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < chains; n++) {
+                long long i = n & (count / 2 - 1);
+                refC[i] = refA[i] * refB[i] * refA[i + 1] * refB[i + 1] * refA[i + 2];
+            }
+        });
+        double simd_time = bestTime(runs, [&]() {
+            for (long long n = 0; n < chains; n++) {
+                long long i = n & (count / 2 - 1);
+                C[i] = A[i] * B[i] * A[i + 1] * B[i + 1] * A[i + 2];
+            }
+        });
+        report("chain of 5 (drawShadow)", chains, scalar_time, simd_time, worst);
+    }
+
+    for (int i = 0; i < count; i++)
+        sink = sink + C[i][0][0] + refC[i][0][0] + U[i].x + refU[i].x;
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/************************************************************
+ * File: frame-transform-bench.cpp
+
+ * Per-frame transform setup cost of display() in "rotate-sphere-texture.cpp",
+   before and after composing the transforms as affine3x4s ("affine.h").
+
+ * before: every draw builds its model-view as mat4 products, the way
+   display() used to:
+     LookAt(eye, at, up) for the axes, the plane (twice), the sphere's
+     lighting and the fireworks, LookAt * N * Translate * R * M for the
+     shadow and LookAt * Translate * R * M for the sphere, with
+     R = Rotate(angle, axis) and M = Rotate(Q) set up once per frame.
+ * after: view = AffineLookAt() and sphere_model = AffineTranslateRotate()
+   are set up once per frame; the sphere is view * sphere_model (an affine
+   product), the shadow mat4(view) * N * sphere_model, and the mat4s are
+   produced only where they are uploaded.
+
+ * Both include the NormalMatrix() calls of the plane and the sphere, which
+   after passes as rigid; before also computes that of the (unlit) shadow,
+   as display() used to. The frames move the eye and roll the sphere as the program does,
+   and the largest difference between the matrices uploaded by the two
+   versions (relative to the largest entry) is reported. No GL context is
+   needed.
+
+ * Usage: frame-transform-bench [frames]   (default 1000000)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+//  The matrices uploaded in one frame
+struct FrameMatrices {
+    mat4  axes, plane, shadow, sphere, sphere_lighting, fireworks;
+    mat3  plane_normal, shadow_normal, sphere_normal;
+};
+
+//  The state display() reads
+struct FrameState {
+    vec4     eye, position, rotation_axis;
+    GLfloat  rotation_angle;
+    quat     Q;
+    bool     rolling_status;
+};
+
+const vec4 at(0.0f, 0.0f, 0.0f, 1.0f);
+const vec4 up(0.0f, 1.0f, 0.0f, 0.0f);
+
+//----------------------------------------------------------------------------
+// frameBefore(f, N, out) / frameAfter(f, N, out):
+// The transform setup of one frame of display(), before and after.
+//
+//----------------------------------------------------------------------------
+static void frameBefore(const FrameState& f, const mat4& N, FrameMatrices& out)
+{
+    mat4 mv = LookAt(f.eye, at, up);  // display()
+    mat4 R = Rotate(f.rotation_angle, f.rotation_axis.x, f.rotation_axis.y, f.rotation_axis.z);
+    mat4 M = Rotate(f.Q);
+
+    out.axes = LookAt(f.eye, at, up);
+
+    out.plane = LookAt(f.eye, at, up);
+    out.plane_normal = NormalMatrix(out.plane, 1);
+
+    out.shadow = LookAt(f.eye, at, up) * N * Translate(f.position.x, f.position.y, f.position.z) * (f.rolling_status ? R : 1) * M;
+    out.shadow_normal = NormalMatrix(out.shadow, 1);
+
+    out.plane = LookAt(f.eye, at, up);  // drawn twice
+    out.plane_normal = NormalMatrix(out.plane, 1);
+
+    out.sphere = LookAt(f.eye, at, up) * Translate(f.position.x, f.position.y, f.position.z) * (f.rolling_status ? R : 1) * M;
+    out.sphere_normal = NormalMatrix(out.sphere, 1);
+    out.sphere_lighting = LookAt(f.eye, at, up);
+
+    out.fireworks = LookAt(f.eye, at, up);
+    (void) mv;
+}
+
+static void frameAfter(const FrameState& f, const mat4& N, FrameMatrices& out)
+{
+    affine3x4 view = AffineLookAt(f.eye, at, up);  // display()
+    mat4 mv = view;
+    quat orientation = f.rolling_status
+                     ? Quaternion(f.rotation_angle, f.rotation_axis.x, f.rotation_axis.y, f.rotation_axis.z) * f.Q : f.Q;
+    affine3x4 sphere_model = AffineTranslateRotate(f.position, orientation);
+
+    out.axes = view;
+
+    out.plane = view;
+    out.plane_normal = NormalMatrix(out.plane, TransformRigid);
+
+    out.shadow = mat4(view) * N * sphere_model;  // not lit
+
+    out.plane = view;  // drawn twice
+    out.plane_normal = NormalMatrix(out.plane, TransformRigid);
+
+    out.sphere = view * sphere_model;
+    out.sphere_normal = NormalMatrix(out.sphere, TransformRigid);
+    out.sphere_lighting = view;
+
+    out.fireworks = view;
+    (void) mv;
+}
+
+//----------------------------------------------------------------------------
+// relativeDifference(a, b, n):
+// Returns the largest |a[i] - b[i]| over the largest |b[i]| of n floats.
+//
+//----------------------------------------------------------------------------
+static double relativeDifference(const GLfloat* a, const GLfloat* b, int n)
+{
+    double difference = 0.0, scale = 0.0;
+    for (int i = 0; i < n; i++) {
+        difference = max(difference, (double) fabs(a[i] - b[i]));
+        scale = max(scale, (double) fabs(b[i]));
+    }
+    return difference / scale;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+    // The shadow matrix of computeShadowMatrix() for the light at (-14, 12, -3)
+    vec4 light(-14.0f, 12.0f, -3.0f, 1.0f);
+    mat4 N = mat4(vec4(light.y, -light.x, 0.0f, 0.0f), vec4(0.0f, 0.0f, 0.0f, 0.0f),
+                  vec4(0.0f, -light.z, light.y, 0.0f), vec4(0.0f, -1.0f, 0.0f, light.y));
+
+    // 1024 frames of rolling along A -> B with the eye moving
+    const int NumStates = 1024;
+    vector<FrameState> states(NumStates);
+    vec4 a(-4.0f, 1.0f, 4.0f, 1.0f), b(3.0f, 1.0f, -4.0f, 1.0f);
+    vec4 direction = normalize(b - a);
+    for (int i = 0; i < NumStates; i++) {
+        FrameState& f = states[i];
+        f.eye = vec4(7.0f - 0.01f * i, 3.0f + 0.002f * i, -10.0f + 0.005f * i, 1.0f);
+        f.position = a + (0.02f * i) * direction;
+        f.rotation_axis = cross(vec3(0, 1, 0), direction);
+        f.rotation_angle = fmod(1.1459f * (i + 1), 4.0f);
+        f.Q = (i == 0) ? quat() : renormalize(Quaternion(f.rotation_angle, f.rotation_axis.x, f.rotation_axis.y, f.rotation_axis.z) * states[i - 1].Q);
+        f.rolling_status = (i % 64) != 0;
+    }
+
+    // Differences of the uploaded matrices
+    double difference = 0.0;
+    for (int i = 0; i < NumStates; i++) {
+        FrameMatrices before, after;
+        frameBefore(states[i], N, before);
+        frameAfter(states[i], N, after);
+        const mat4* mb[] = { &before.axes, &before.plane, &before.shadow, &before.sphere, &before.sphere_lighting, &before.fireworks };
+        const mat4* ma[] = { &after.axes, &after.plane, &after.shadow, &after.sphere, &after.sphere_lighting, &after.fireworks };
+        for (int m = 0; m < 6; m++)
+            difference = max(difference, relativeDifference(*ma[m], *mb[m], 16));
+        difference = max(difference, relativeDifference(after.plane_normal, before.plane_normal, 9));
+        difference = max(difference, relativeDifference(after.sphere_normal, before.sphere_normal, 9));
+    }
+
+    double times[2];
+    for (int version = 0; version < 2; version++) {
+        vector<FrameMatrices> out(16);
+        double best = 1.0e30;
+        for (int run = 0; run < 5; run++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                if (version == 0)
+                    frameBefore(states[i & (NumStates - 1)], N, out[i & 15]);
+                else
+                    frameAfter(states[i & (NumStates - 1)], N, out[i & 15]);
+            }
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        times[version] = best * 1.0e9 / frames;
+    }
+
+    printf("%-28s  %12s\n", "transform setup", "ns/frame");
+    printf("%-28s  %12.1f\n", "before (mat4 products)", times[0]);
+    printf("%-28s  %12.1f\n", "after (affine3x4)", times[1]);
+    printf("%-28s  %11.2fx\n", "speedup", times[0] / times[1]);
+    printf("%-28s  %12.2e\n", "max relative difference", difference);
+    return 0;
+}
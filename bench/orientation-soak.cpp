@@ -0,0 +1,155 @@
+/************************************************************
+ * File: orientation-soak.cpp
+
+ * Soak test of the sphere's rolling orientation accumulator. The rolling of
+   idle() in "rotate-sphere-texture.cpp" (A -> B -> C -> A, speed 0.02, a
+   sphere of radius 1) is replayed for up to 10^8 steps with
+     - matrix:      M = Rotate(angle, axis) * M   (the original accumulator)
+     - quat:        Q = renormalize(Quaternion(angle, axis) * Q)   (idle() now)
+     - quat, raw:   Q = Quaternion(angle, axis) * Q   (without renormalize())
+
+ * At every power of 10 steps the orthonormality error of the accumulated
+   rotation matrix (Rotate(Q) for the quaternions) is printed: the largest
+   entry of |M^T M - I| over the upper-left 3x3, computed in double
+   precision. The time per step of each accumulator is printed at the end.
+   No GL context is needed.
+
+ * Usage: orientation-soak [steps]   (default 100000000)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// orthonormalityError(m):
+// Returns the largest entry of |M^T M - I| for the upper-left 3x3 of m.
+//
+//----------------------------------------------------------------------------
+static double orthonormalityError(const mat4& m)
+{
+    double error = 0.0;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            double d = (i == j) ? -1.0 : 0.0;
+            for (int k = 0; k < 3; k++)
+                d += (double) m[k][i] * m[k][j];
+            error = max(error, fabs(d));
+        }
+    return error;
+}
+
+//----------------------------------------------------------------------------
+//
+//  The rolling of idle() and setNewDirection() without the display
+//
+
+struct Rolling {
+    vec4     positions[3] = { vec4(-4.0f, 1.0f, 4.0f, 1.0f), vec4(3.0f, 1.0f, -4.0f, 1.0f), vec4(-3.0f, 1.0f, -3.0f, 1.0f) };
+    int      current_segment = 0;
+    GLfloat  rotation_angle = 0.0f;
+    GLfloat  speed = 0.02f;
+    GLfloat  sphere_radius = 1.0f;
+    vec4     position = positions[0];
+    vec4     direction;
+    vec4     rotation_axis;
+
+    Rolling() { setNewDirection(); }
+
+    void setNewDirection() {
+        vec4 nextPosition = positions[(current_segment + 1) % 3];
+        direction = normalize(nextPosition - position);
+        rotation_axis = cross(vec3(0, 1, 0), direction);
+    }
+
+    // Moves the sphere one step; returns the rotation angle of this step
+    GLfloat step() {
+        position += speed * direction;
+        rotation_angle += (GLfloat) ((speed / (2 * M_PI * sphere_radius)) * 360.0);
+        if (rotation_angle > 4.0f) rotation_angle = 0.0f;
+        return rotation_angle;
+    }
+
+    // Goes on to the next segment at its end (after the accumulator was updated, as in idle())
+    void nextSegment() {
+        vec4 nextPosition = positions[(current_segment + 1) % 3];
+        if (length(position - nextPosition) < 0.05f) {
+            position = nextPosition;
+            current_segment = (current_segment + 1) % 3;
+            setNewDirection();
+        }
+    }
+};
+
+const char* const AccumulatorNames[] = { "matrix", "quat", "quat, raw" };
+enum { MatrixAccumulator, QuatAccumulator, RawQuatAccumulator, NumAccumulators };
+
+//----------------------------------------------------------------------------
+// soak(accumulator, steps, errors):
+// Replays steps steps of rolling with accumulator, storing the orthonormality
+// error after 10, 100, ... steps in errors; returns the time per step in ns
+// (including the time of the rolling itself and the error checks).
+//
+//----------------------------------------------------------------------------
+static double soak(int accumulator, long long steps, vector<double>& errors)
+{
+    Rolling rolling;
+    mat4 M = mat4(1.0f);
+    quat Q;
+    long long checkpoint = 10;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (long long i = 1; i <= steps; i++) {
+        GLfloat angle = rolling.step();
+        const vec4& axis = rolling.rotation_axis;
+
+        if (accumulator == MatrixAccumulator)
+            M = Rotate(angle, axis.x, axis.y, axis.z) * M;
+        else if (accumulator == QuatAccumulator)
+            Q = renormalize(Quaternion(angle, axis.x, axis.y, axis.z) * Q);
+        else
+            Q = Quaternion(angle, axis.x, axis.y, axis.z) * Q;
+
+        rolling.nextSegment();
+
+        if (i == checkpoint) {
+            errors.push_back(orthonormalityError(accumulator == MatrixAccumulator ? M : Rotate(Q)));
+            checkpoint *= 10;
+        }
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1.0e9 / steps;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    long long steps = (argc > 1) ? atoll(argv[1]) : 100000000LL;
+
+    vector<double> errors[NumAccumulators];
+    double ns_per_step[NumAccumulators];
+    for (int a = 0; a < NumAccumulators; a++)
+        ns_per_step[a] = soak(a, steps, errors[a]);
+
+    printf("%12s", "steps");
+    for (int a = 0; a < NumAccumulators; a++)
+        printf("  %14s", AccumulatorNames[a]);
+    printf("     (max |M^T M - I|)\n");
+
+    long long checkpoint = 10;
+    for (size_t c = 0; c < errors[0].size(); c++, checkpoint *= 10) {
+        printf("%12lld", checkpoint);
+        for (int a = 0; a < NumAccumulators; a++)
+            printf("  %14.3e", errors[a][c]);
+        printf("\n");
+    }
+
+    printf("%12s", "ns/step");
+    for (int a = 0; a < NumAccumulators; a++)
+        printf("  %14.1f", ns_per_step[a]);
+    printf("\n");
+    return 0;
+}
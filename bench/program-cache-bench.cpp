@@ -0,0 +1,172 @@
+/************************************************************
+ * File: program-cache-bench.cpp
+
+ * Startup cost of the shader programs of the renderer with and without the
+   program cache of InitShader() (see SetProgramCache()): variants of
+   vshader53.glsl / fshader53.glsl (combinations of lighting, spotlight,
+   sphere texture and fog type) are created three times into an empty
+   cache directory:
+
+     cold     nothing cached: each program is compiled, linked and stored
+     warm     each program is loaded from the cache with glProgramBinary()
+     invalid  the binaries of the cache are corrupted: each program must be
+              rejected and compiled again
+
+ * The time per pass and per program is printed (best of 3 runs of the
+   warm pass). The program fails if the warm pass compiles a program or the
+   invalid pass loads one, or if the driver has no program binaries. Mesa
+   builds its program binaries on a shader cache of its own (they are gone
+   with MESA_SHADER_CACHE_DISABLE=true), which also speeds up the invalid
+   pass and the cold pass of a later run of the bench. Needs a GL 3.2
+   context (a GLUT window), and the shader files in the working directory.
+
+ * Usage: program-cache-bench [variants] [cache_dir]   (default 48 program-cache-bench.cache)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include "../shader-variants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Angel;
+
+// The options of vshader53.glsl / fshader53.glsl (shader_options of rotate-sphere-texture.cpp);
+// the variants are the combinations of the first four
+const ShaderOption Options[] = {
+    { "LIGHTING", 2 }, { "SPOTLIGHT", 2 }, { "SPHERE_TEXTURE", 3 }, { "FOG_TYPE", 4 },
+    { "WIREFRAME", 2 }, { "FLAT_SHADING", 2 }, { "UNLIT_COLOR", 3 }, { "BLENDING_SHADOW", 2 },
+    { "LATTICE", 2 }, { "GROUND_TEXTURE", 2 }, { "QUANTIZED_POSITION", 2 }, { "OCTAHEDRAL_NORMAL", 2 }
+};
+const int NumOptions = sizeof(Options) / sizeof(Options[0]);
+const int NumVariedOptions = 4;
+const int MaxVariants = 2 * 2 * 3 * 4;
+
+const char* const attribute_names[] = { "vPosition", "vNormal", "vTexCoord" };
+
+// Programs created by a pass, and its time
+struct Pass {
+    int     compiled, loaded;
+    double  ms;
+};
+
+//----------------------------------------------------------------------------
+// createVariants(variants):
+// Creates the first "variants" combinations of the varied options with
+// InitShader() and deletes them again; returns what it took.
+//
+//----------------------------------------------------------------------------
+static Pass createVariants(int variants)
+{
+    ProgramCounts before = GetProgramCounts();
+
+    for (int v = 0; v < variants; v++) {
+        int values[NumOptions] = { 0 };
+        for (int i = 0, k = v; i < NumVariedOptions; i++) {
+            values[i] = k % Options[i].num_values;
+            k /= Options[i].num_values;
+        }
+        string defines = ShaderDefines(Options, NumOptions, values);
+        GLuint program = InitShader("vshader53.glsl", "fshader53.glsl", attribute_names, 3, defines.c_str());
+        glDeleteProgram(program);
+    }
+
+    ProgramCounts after = GetProgramCounts();
+    Pass pass = { after.compiled - before.compiled, after.loaded - before.loaded,
+                  after.compile_ms - before.compile_ms + after.load_ms - before.load_ms };
+    return pass;
+}
+
+//----------------------------------------------------------------------------
+// corruptCache(directory):
+// Overwrites the binary after the header of each file of the program cache
+// in directory with zeros, keeping its size.
+//
+//----------------------------------------------------------------------------
+static int corruptCache(const string& directory)
+{
+    const size_t HeaderSize = 24;  // ProgramBinaryHeader of InitShader.cpp
+    int count = 0;
+
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(directory)) {
+        uintmax_t size = entry.file_size();
+        if (size <= HeaderSize)
+            continue;
+        fstream file(entry.path(), ios::in | ios::out | ios::binary);
+        file.seekp(HeaderSize);
+        vector<char> zeros(size - HeaderSize, 0);
+        file.write(zeros.data(), zeros.size());
+        count += bool(file);
+    }
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    glutInit(&argc, argv);
+#ifdef __APPLE__
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE | GLUT_3_2_CORE_PROFILE);
+#else
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE);
+#endif
+    glutInitWindowSize(64, 64);
+    glutCreateWindow("program-cache-bench");
+#ifndef __APPLE__
+    int err = glewInit();
+    if (GLEW_OK != err) {
+        printf("Error: glewInit failed: %s\n", (char*) glewGetErrorString(err));
+        return EXIT_FAILURE;
+    }
+#endif
+
+    int variants = (argc > 1) ? min(atoi(argv[1]), MaxVariants) : MaxVariants;
+    string directory = (argc > 2) ? argv[2] : "program-cache-bench.cache";
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        printf("Error: %s has no program binary formats\n", (const char*) glGetString(GL_RENDERER));
+        return EXIT_FAILURE;
+    }
+
+    filesystem::remove_all(directory);
+    SetProgramCache(directory.c_str());
+
+    Pass cold = createVariants(variants);
+    Pass warm = createVariants(variants);
+    for (int run = 1; run < 3; run++) {
+        Pass again = createVariants(variants);
+        if (again.ms < warm.ms)
+            warm = again;
+    }
+    int corrupted = corruptCache(directory);
+    Pass invalid = createVariants(variants);
+
+    bool ok = true;
+    if (warm.loaded != variants) {
+        printf("Error: the warm pass loaded %d of %d programs from the cache\n", warm.loaded, variants);
+        ok = false;
+    }
+    if (invalid.compiled != variants) {
+        printf("Error: the invalid pass compiled %d of %d programs (%d binaries corrupted)\n",
+               invalid.compiled, variants, corrupted);
+        ok = false;
+    }
+
+    printf("\n%s, %d programs\n", (const char*) glGetString(GL_RENDERER), variants);
+    printf("%-8s  %8s  %8s  %10s  %12s  %8s\n", "pass", "compiled", "loaded", "ms", "ms/program", "speedup");
+    const char* const names[] = { "cold", "warm", "invalid" };
+    const Pass passes[] = { cold, warm, invalid };
+    for (int p = 0; p < 3; p++)
+        printf("%-8s  %8d  %8d  %10.1f  %12.2f  %7.2fx\n", names[p], passes[p].compiled, passes[p].loaded,
+               passes[p].ms, passes[p].ms / variants, cold.ms / passes[p].ms);
+
+    filesystem::remove_all(directory);
+    printf("%s\n", ok ? "Each pass created its programs as expected." : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+/************************************************************
+ * File: sphere-ingest-bench.cpp
+
+ * Microbenchmark of the fused ingest kernel ingestSphereTriangles() in
+   "sphere-mesh.cpp" against the original ingest path: the per-vertex
+   normalize() / per-face cross() code of readSphereFile() pushing into
+   three std::vectors, the findRadius() pass over all points and the copy
+   of the three arrays into the sphere globals. The fused kernel computes
+   no flat normals (flat shading takes them from the fragment shader).
+
+ * Both paths start from the already parsed coordinates (9 floats per
+   triangle), so only the ingest itself is timed. The points, smooth
+   normals and radius of both paths are compared bit for bit. No GL
+   context is needed.
+
+ * Usage: sphere-ingest-bench [max_triangles]   (default 1000000)
+**************************************************************/
+
+#include "../sphere-mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// seconds(start):
+// Returns the time elapsed since start in seconds.
+//
+//----------------------------------------------------------------------------
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// Original ingest: readSphereFile() + findRadius() + copy into the globals
+//
+//----------------------------------------------------------------------------
+struct LegacySphere {
+    vector<point4> points;
+    vector<vec3> smooth_normals;
+    vector<vec3> flat_normals;
+    GLfloat radius;
+};
+
+static void legacyIngest(const vector<float>& coords, LegacySphere& sphere)
+{
+    vector<point4> points;
+    vector<vec3> smooth_normals;
+    vector<vec3> flat_normals;
+    size_t triangle_count = coords.size() / 9;
+
+    points.reserve(3 * triangle_count);
+    smooth_normals.reserve(3 * triangle_count);
+    flat_normals.reserve(3 * triangle_count);
+
+    // readSphereFile()
+    for (size_t i = 0; i < triangle_count; i++) {
+        point3 vertices[3];
+
+        for (int j = 0; j < 3; j++) {
+            float x = coords[9 * i + 3 * j], y = coords[9 * i + 3 * j + 1], z = coords[9 * i + 3 * j + 2];
+            points.push_back(point4(x, y, z, 1.0f));
+
+            vec3 normal = normalize(vec3(x, y, z));
+            smooth_normals.push_back(normal);
+
+            vertices[j] = point3(x, y, z);
+        }
+
+        vec3 u = vec3(vertices[1]) - vec3(vertices[0]);
+        vec3 v = vec3(vertices[2]) - vec3(vertices[0]);
+        vec3 normal = normalize(cross(u, v));
+
+        for (int j = 0; j < 3; j++) {
+            flat_normals.push_back(normal);
+        }
+    }
+
+    // findRadius()
+    float max_radius = 0.0f;
+    for (const point4& sp : points) {
+        max_radius = max(sqrt(sp.x * sp.x + sp.y * sp.y + sp.z * sp.z), max_radius);
+    }
+
+    // sphere_points = points; ...
+    sphere.points = points;
+    sphere.smooth_normals = smooth_normals;
+    sphere.flat_normals = flat_normals;
+    sphere.radius = max_radius;
+}
+
+//----------------------------------------------------------------------------
+// Fused ingest: points stored once into the reserved mesh storage, then
+// ingestSphereTriangles() in one pass
+//
+//----------------------------------------------------------------------------
+static void fusedIngest(const vector<float>& coords, vector<char>& storage, GLfloat& radius)
+{
+    size_t triangle_count = coords.size() / 9;
+    point4* points = (point4*) storage.data();
+    vec3* smooth_normals = (vec3*) (points + 3 * triangle_count);
+
+    for (size_t i = 0; i < 3 * triangle_count; i++) {
+        points[i] = point4(coords[3 * i], coords[3 * i + 1], coords[3 * i + 2], 1.0f);
+    }
+
+    radius = 0.0f;
+    ingestSphereTriangles(points, triangle_count, smooth_normals, radius);
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    long long max_triangles = (argc > 1) ? atoll(argv[1]) : 1000000;
+
+    printf("%10s  %12s  %12s  %14s  %14s  %8s  %10s\n", "triangles", "original ms", "fused ms",
+           "original tri/s", "fused tri/s", "speedup", "identical");
+
+    for (long long triangle_count = 1000; triangle_count <= max_triangles; triangle_count *= 10) {
+        // Random triangles on the unit sphere, as parsed from a sphere file
+        vector<float> coords(9 * triangle_count);
+        srand((unsigned) triangle_count);
+        for (long long i = 0; i < 3 * triangle_count; i++) {
+            vec3 p = normalize(vec3(rand() / (float) RAND_MAX - 0.5f,
+                                    rand() / (float) RAND_MAX - 0.5f,
+                                    rand() / (float) RAND_MAX - 0.5f) + vec3(1.0e-4f));
+            coords[3 * i] = p.x;  coords[3 * i + 1] = p.y;  coords[3 * i + 2] = p.z;
+        }
+
+        // Small meshes are ingested several times and the best run is kept
+        int runs = (triangle_count < 1000000) ? 20 : 3;
+        double legacy_time = 1.0e30, fused_time = 1.0e30;
+
+        LegacySphere legacy;
+        for (int r = 0; r < runs; r++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            legacyIngest(coords, legacy);
+            legacy_time = min(legacy_time, seconds(start));
+        }
+
+        vector<char> storage(3 * triangle_count * (sizeof(point4) + sizeof(vec3)));
+        GLfloat radius = 0.0f;
+        for (int r = 0; r < runs; r++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            fusedIngest(coords, storage, radius);
+            fused_time = min(fused_time, seconds(start));
+        }
+
+        // Both paths must produce the same bits
+        size_t num_vertices = 3 * triangle_count;
+        const char* data = storage.data();
+        bool identical =
+            memcmp(data, legacy.points.data(), num_vertices * sizeof(point4)) == 0 &&
+            memcmp(data + num_vertices * sizeof(point4), legacy.smooth_normals.data(), num_vertices * sizeof(vec3)) == 0 &&
+            radius == legacy.radius;
+
+        printf("%10lld  %12.3f  %12.3f  %14.0f  %14.0f  %7.2fx  %10s\n", triangle_count,
+               1000.0 * legacy_time, 1000.0 * fused_time,
+               triangle_count / legacy_time, triangle_count / fused_time,
+               legacy_time / fused_time, identical ? "yes" : "NO");
+    }
+
+    return 0;
+}
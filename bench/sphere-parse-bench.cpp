@@ -0,0 +1,189 @@
+/************************************************************
+ * File: sphere-parse-bench.cpp
+
+ * Throughput benchmark of the sphere mesh text parsers in "sphere-mesh.cpp":
+   the original ifstream parser readSphereFile() against the chunked
+   multithreaded std::from_chars parser parseSphereFile() and the
+   bounded-memory streaming loader streamSphereFile().
+
+ * Sphere files of 1K up to 10M triangles (in the same format as sphere.N.txt)
+   are generated in the current directory, parsed by all parsers, compared
+   and deleted again. No GL context is needed.
+
+ * The peak memory of parseSphereFile() and streamSphereFile() is measured
+   in a child process each, so that it is not hidden by the parent's peak.
+
+ * Usage: sphere-parse-bench [max_triangles]   (default 10000000)
+**************************************************************/
+
+#include "../sphere-mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// writeSphereFile(fileName, triangle_count):
+// Generates a sphere file of triangle_count random triangles on the unit
+// sphere. Returns the size of the file in bytes.
+//
+//----------------------------------------------------------------------------
+static long long writeSphereFile(const char* fileName, int triangle_count)
+{
+    FILE* fp = fopen(fileName, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: %s could not be created\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    srand(triangle_count);
+    fprintf(fp, "%d\n", triangle_count);
+    for (int i = 0; i < triangle_count; i++) {
+        fprintf(fp, "3\n");
+        for (int j = 0; j < 3; j++) {
+            vec3 p = normalize(vec3(rand() / (float) RAND_MAX - 0.5f,
+                                    rand() / (float) RAND_MAX - 0.5f,
+                                    rand() / (float) RAND_MAX - 0.5f) + vec3(1.0e-4f));
+            fprintf(fp, "%f %f %f\n", p.x, p.y, p.z);
+        }
+    }
+
+    long long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+//----------------------------------------------------------------------------
+// seconds(start):
+// Returns the time elapsed since start in seconds.
+//
+//----------------------------------------------------------------------------
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// childPeakMegabytes(func):
+// Runs func in a child process and returns the peak memory of that process
+// in MB.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static double childPeakMegabytes(Func func)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return 0.0;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        func();
+        size_t peak = peakMemoryUsage();
+        ssize_t written = write(fds[1], &peak, sizeof(peak));
+        _exit(written == sizeof(peak) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    size_t peak = 0;
+    if (pid < 0 || read(fds[0], &peak, sizeof(peak)) != sizeof(peak))
+        peak = 0;
+    close(fds[0]);
+    if (pid > 0)
+        waitpid(pid, NULL, 0);
+    return peak / 1.0e6;
+}
+
+//----------------------------------------------------------------------------
+// streamSphere(fileName, points):
+// Loads fileName with streamSphereFile() from the text file (not its cache);
+// if points is given the chunks are compared against it. Returns false if
+// they differ.
+//
+//----------------------------------------------------------------------------
+static bool streamSphere(const string& fileName, const vector<point4>* points)
+{
+    remove((fileName + ".mesh").c_str());
+
+    bool same = true;
+    GLfloat radius;
+    streamSphereFile(fileName, [](int) {}, [&](const SphereMeshChunk& chunk) {
+        if (points != NULL &&
+            memcmp(chunk.points, points->data() + 3 * (size_t) chunk.first_triangle,
+                   3 * (size_t) chunk.triangle_count * sizeof(point4)) != 0)
+            same = false;
+        return true;
+    }, radius);
+
+    remove((fileName + ".mesh").c_str());
+    return same;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    long long max_triangles = (argc > 1) ? atoll(argv[1]) : 10000000;
+
+    printf("%10s  %8s  %13s  %12s  %12s  %14s  %14s  %8s  %12s  %12s\n", "triangles", "MB",
+           "ifstream MB/s", "chunked MB/s", "bounded MB/s", "ifstream tri/s", "chunked tri/s", "speedup",
+           "chunked peak", "bounded peak");
+
+    for (long long triangle_count = 1000; triangle_count <= max_triangles; triangle_count *= 10) {
+        char fileName[64];
+        sprintf(fileName, "bench-sphere.%lld.txt", triangle_count);
+        double megabytes = writeSphereFile(fileName, (int) triangle_count) / 1.0e6;
+
+        // Peak memory (MB) of loading the whole mesh vs. streaming it
+        double chunked_peak = childPeakMegabytes([&]() { SphereMesh mesh; parseSphereFile(fileName, mesh); });
+        double bounded_peak = childPeakMegabytes([&]() { streamSphere(fileName, NULL); });
+
+        // Small files are parsed several times and the best run is kept
+        int runs = (triangle_count < 1000000) ? 5 : 1;
+        double stream_time = 1.0e30, chunked_time = 1.0e30, bounded_time = 1.0e30;
+
+        vector<point4> points;
+        SphereMesh mesh;
+        for (int r = 0; r < runs; r++) {
+            vector<vec3> smooth_normals;
+            points.clear();
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            readSphereFile(fileName, points, smooth_normals);
+            stream_time = min(stream_time, seconds(start));
+        }
+        for (int r = 0; r < runs; r++) {
+            releaseSphereMesh(mesh);
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            parseSphereFile(fileName, mesh);
+            chunked_time = min(chunked_time, seconds(start));
+        }
+        bool same = true;
+        for (int r = 0; r < runs; r++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            same = streamSphere(fileName, &points) && same;
+            bounded_time = min(bounded_time, seconds(start));
+        }
+
+        // All parsers must produce the same points
+        if (mesh.num_vertices != (int) points.size() ||
+            memcmp(mesh.points, points.data(), points.size() * sizeof(point4)) != 0 || !same)
+            fprintf(stderr, "Error: parsers disagree on %s\n", fileName);
+
+        printf("%10lld  %8.1f  %13.1f  %12.1f  %12.1f  %14.0f  %14.0f  %7.2fx  %9.1f MB  %9.1f MB\n",
+               triangle_count, megabytes,
+               megabytes / stream_time, megabytes / chunked_time, megabytes / bounded_time,
+               triangle_count / stream_time, triangle_count / chunked_time,
+               stream_time / chunked_time, chunked_peak, bounded_peak);
+
+        releaseSphereMesh(mesh);
+        remove(fileName);
+    }
+
+    return 0;
+}
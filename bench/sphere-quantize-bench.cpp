@@ -0,0 +1,146 @@
+/************************************************************
+ * File: sphere-quantize-bench.cpp
+
+ * Size and accuracy of the quantized sphere vertex format in "sphere-mesh.h"
+   (QuantizedPoint and OctahedralNormal, 10 bytes per vertex planar, 12
+   interleaved) against the float format (point4 and vec3, 28 bytes per
+   vertex). The buffer sizes are computed for the planar layout.
+
+ * For icospheres of 20 * 4^level triangles the sizes of the sphere buffer
+   as createSphereBuffers() lays it out (the welded buffer with its index
+   buffer, drawn by both shading modes) are computed in both formats,
+   together with the vertex bytes fetched to draw the sphere once, the time
+   to quantize all vertices, and the largest position error
+   (relative to the radius) and normal error (in degrees) after decoding the
+   vertices as vshader53.glsl does. No GL context is needed.
+
+ * Usage: sphere-quantize-bench [max_level]   (default 8, 1.3M triangles)
+**************************************************************/
+
+#include "../sphere-mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// seconds(start):
+// Returns the time elapsed since start in seconds.
+//
+//----------------------------------------------------------------------------
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// snorm16(c):
+// Decodes a normalized GLshort as the vertex fetch does.
+//
+//----------------------------------------------------------------------------
+static GLfloat snorm16(GLshort c)
+{
+    return max(c / 32767.0f, -1.0f);
+}
+
+//----------------------------------------------------------------------------
+// octahedralDecode(e):
+// The octahedralDecode() of vshader53.glsl.
+//
+//----------------------------------------------------------------------------
+static vec3 octahedralDecode(const OctahedralNormal& e)
+{
+    vec3 n(snorm16(e.u), snorm16(e.v), 0.0f);
+    n.z = 1.0f - fabs(n.x) - fabs(n.y);
+    GLfloat t = max(-n.z, 0.0f);
+    n.x += (n.x >= 0.0f) ? -t : t;
+    n.y += (n.y >= 0.0f) ? -t : t;
+    return normalize(n);
+}
+
+//----------------------------------------------------------------------------
+// maxErrors(points, normals, count, radius, position_error, normal_error):
+// Quantizes count points and normals, decodes them again and raises
+// position_error (relative to radius) and normal_error (degrees) to the
+// largest errors.
+//
+//----------------------------------------------------------------------------
+static void maxErrors(const point4* points, const vec3* normals, size_t count, GLfloat radius,
+                      double& position_error, double& normal_error)
+{
+    vector<QuantizedPoint> quantized(count);
+    vector<OctahedralNormal> encoded(count);
+    quantizeSpherePoints(points, count, radius, quantized.data());
+    encodeOctahedralNormals(normals, count, encoded.data());
+
+    for (size_t i = 0; i < count; i++) {
+        vec3 p(snorm16(quantized[i].x) * radius, snorm16(quantized[i].y) * radius, snorm16(quantized[i].z) * radius);
+        position_error = max(position_error, (double) length(p - vec3(points[i].x, points[i].y, points[i].z)) / radius);
+
+        // Angle between the normals, in double precision (acos() of a float dot product near 1 is too coarse)
+        vec3 d = octahedralDecode(encoded[i]);
+        const vec3& n = normals[i];
+        double cx = (double) d.y * n.z - (double) d.z * n.y;
+        double cy = (double) d.z * n.x - (double) d.x * n.z;
+        double cz = (double) d.x * n.y - (double) d.y * n.x;
+        double cosine = (double) d.x * n.x + (double) d.y * n.y + (double) d.z * n.z;
+        normal_error = max(normal_error, atan2(sqrt(cx * cx + cy * cy + cz * cz), cosine) * 180.0 / M_PI);
+    }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    int max_level = (argc > 1) ? atoi(argv[1]) : 8;
+
+    printf("%5s  %10s  %13s  %13s  %8s  %14s  %14s  %10s  %12s  %12s\n", "level", "triangles",
+           "float VBO MB", "quant VBO MB", "ratio", "float fetch MB", "quant fetch MB", "encode ms",
+           "max pos err", "max nrm deg");
+
+    for (int level = 3; level <= max_level; level++) {
+        SphereMesh mesh;
+        WeldedSphereMesh welded;
+
+        cout.setstate(ios::failbit);  // generateIcosphere() and weldSphereMesh() report what they did
+        generateIcosphere(level, mesh);
+        weldSphereMesh(mesh, 1.0e-5f, welded);
+        cout.clear();
+
+        size_t unique_vertices = welded.points.size();
+        size_t float_vertex = sizeof(point4) + sizeof(vec3);
+        size_t quantized_vertex = sizeof(QuantizedPoint) + sizeof(OctahedralNormal);
+
+        // Welded buffer + index buffer, as in createSphereBuffers()
+        double float_size = unique_vertices * float_vertex + welded.indexDataSize();
+        double quantized_size = unique_vertices * quantized_vertex + welded.indexDataSize();
+
+        // Vertex data fetched to draw the sphere once (each unique vertex at least once)
+        double float_fetch = unique_vertices * float_vertex;
+        double quantized_fetch = unique_vertices * quantized_vertex;
+
+        // Quantization of all vertices, as uploadSphereVertices() does it
+        vector<QuantizedPoint> quantized(unique_vertices);
+        vector<OctahedralNormal> encoded(unique_vertices);
+        int runs = (level < 7) ? 10 : 3;
+        double encode_time = 1.0e30;
+        for (int r = 0; r < runs; r++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            quantizeSpherePoints(welded.points.data(), unique_vertices, mesh.radius, quantized.data());
+            encodeOctahedralNormals(welded.normals.data(), unique_vertices, encoded.data());
+            encode_time = min(encode_time, seconds(start));
+        }
+
+        double position_error = 0.0, normal_error = 0.0;
+        maxErrors(welded.points.data(), welded.normals.data(), unique_vertices, mesh.radius, position_error, normal_error);
+
+        printf("%5d  %10d  %13.2f  %13.2f  %7.2fx  %14.2f  %14.2f  %10.2f  %12.2e  %12.5f\n", level, mesh.triangle_count,
+               float_size / 1.0e6, quantized_size / 1.0e6, float_size / quantized_size,
+               float_fetch / 1.0e6, quantized_fetch / 1.0e6, 1000.0 * encode_time, position_error, normal_error);
+
+        releaseSphereMesh(mesh);
+    }
+
+    return 0;
+}
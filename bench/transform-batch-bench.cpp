@@ -0,0 +1,133 @@
+/************************************************************
+ * File: transform-batch-bench.cpp
+
+ * Throughput of the batched SoA transforms in "transform-batch.h" against a
+   loop of mat4 * vec4 (and mat3 * vec3 + normalize() for normals) over an
+   array of point4, on 1K to 10M random points.
+
+ * For every batch size the AoS loop and the SoA kernels are timed (best of
+   several runs), and the SoA results are checked to be bit-identical to the AoS results. The
+   times do not include converting between the layouts; pointsToSoA() is
+   timed separately for reference. No GL context is needed.
+
+ * Usage: transform-batch-bench [max_points]   (default 10000000)
+**************************************************************/
+
+#include "../transform-batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// seconds(start):
+// Returns the time elapsed since start in seconds.
+//
+//----------------------------------------------------------------------------
+static double seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// bestTime(count, func):
+// Returns the best time of several runs of func() on a batch of count points.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static double bestTime(size_t count, Func func)
+{
+    int runs = (count <= 100000) ? 50 : (count <= 1000000) ? 10 : 3;
+    double best = 1.0e30;
+    for (int r = 0; r < runs; r++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        func();
+        best = min(best, seconds(start));
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------------
+// sameBits(a, b, count):
+// Returns whether two float arrays hold the same bits.
+//
+//----------------------------------------------------------------------------
+static bool sameBits(const GLfloat* a, const GLfloat* b, size_t count)
+{
+    return memcmp(a, b, count * sizeof(GLfloat)) == 0;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    size_t max_points = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000000;
+
+    // A model-view-projection and its normal matrix, as drawSphere() builds them
+    mat4 mv = LookAt(vec4(7.0, 3.0, -10.0, 1.0), vec4(0.0, 0.0, 0.0, 1.0), vec4(0.0, 1.0, 0.0, 0.0))
+            * Translate(1.0, 1.0, 0.0) * Rotate(30.0, 0.0, 0.0, 1.0) * Scale(1.5, 1.5, 1.5);
+    mat4 mvp = Perspective(45.0, 1.0, 0.5, 60.0) * mv;
+    mat3 nm = NormalMatrix(mv, 1);
+
+    printf("%-8s  %10s  %12s  %12s  %8s  %14s\n", "kind", "points", "AoS Mpts/s",
+           "SoA Mpts/s", "speedup", "bit-identical");
+
+    mt19937 rng(12345);
+    uniform_real_distribution<GLfloat> coordinate(-1.0f, 1.0f);
+
+    for (size_t count = 1000; count <= max_points; count *= 10) {
+        vector<vec4> points(count), aos_out(count);
+        for (vec4& p : points)
+            p = vec4(coordinate(rng), coordinate(rng), coordinate(rng), 1.0f);
+
+        SoAPointArray in, out;
+        in.resize(count);
+        out.resize(count);
+        pointsToSoA(points.data(), count, in.out());
+        SoAPoints in_xyz = in.points();
+        in_xyz.w = NULL;  // w = 1
+
+        double convert = bestTime(count, [&]() { pointsToSoA(points.data(), count, in.out()); });
+
+        // Points: mvp * p
+        double aos = bestTime(count, [&]() {
+            for (size_t i = 0; i < count; i++)
+                aos_out[i] = mvp * points[i];
+        });
+        double soa = bestTime(count, [&]() { transformPoints(mvp, in_xyz, out.out(), count); });
+
+        vector<vec4> soa_out(count);
+        pointsFromSoA(out.points(), count, soa_out.data());
+        bool same = sameBits(&aos_out[0].x, &soa_out[0].x, 4 * count);
+
+        printf("%-8s  %10zu  %12.1f  %12.1f  %7.2fx  %14s\n", "point", count,
+               count / aos / 1.0e6, count / soa / 1.0e6, aos / soa, same ? "yes" : "NO");
+
+        // Normals: normalize(nm * n)
+        vector<vec3> normals(count), aos_normals(count);
+        for (size_t i = 0; i < count; i++)
+            normals[i] = normalize(vec3(points[i].x, points[i].y, points[i].z));
+        for (size_t i = 0; i < count; i++) {
+            in.x[i] = normals[i].x;  in.y[i] = normals[i].y;  in.z[i] = normals[i].z;
+        }
+
+        aos = bestTime(count, [&]() {
+            for (size_t i = 0; i < count; i++)
+                aos_normals[i] = normalize(nm * normals[i]);
+        });
+        soa = bestTime(count, [&]() { transformNormals(nm, in.points(), out.out(), count, true); });
+
+        same = true;
+        for (size_t i = 0; i < count; i++)
+            same = same && sameBits(&aos_normals[i].x, &out.x[i], 1) && sameBits(&aos_normals[i].y, &out.y[i], 1)
+                        && sameBits(&aos_normals[i].z, &out.z[i], 1);
+
+        printf("%-8s  %10zu  %12.1f  %12.1f  %7.2fx  %14s\n", "normal", count,
+               count / aos / 1.0e6, count / soa / 1.0e6, aos / soa, same ? "yes" : "NO");
+        printf("%-8s  %10zu  %12.1f\n", "to SoA", count, count / convert / 1.0e6);
+    }
+
+    return 0;
+}
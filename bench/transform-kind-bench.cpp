@@ -0,0 +1,224 @@
+/************************************************************
+ * File: transform-kind-bench.cpp
+
+ * Correctness check and microbenchmark of the closed forms that
+   NormalMatrix(mv, kind) and inverse(m, kind) in "mat-yjc-new.h" use for
+   the kind of transform the caller passes (see TransformKind).
+
+ * For each kind, random model-view matrices are built as the renderer builds
+   them:
+     rigid:          LookAt() * Translate() * Rotate() * Rotate(quat)
+     uniform scale:  rigid * Scale(s, s, s)
+     affine:         rigid * Scale(sx, sy, sz)
+     projective:     Perspective() * rigid
+   NormalMatrix() and inverse() are timed on them with their kind ("by
+   kind"), and with the general kind TransformProjective, which runs the
+   general inverses ("general").
+
+ * Both results are compared with a double precision reference (the inverse
+   transpose of the upper-left 3x3, and the Gauss-Jordan inverse of mv), as
+   the largest error relative to the largest entry of the reference. The
+   program fails if a result by kind is off by more than 1e-5, or if
+   inverse() finds a matrix not invertible. No GL context is needed.
+
+ * Usage: transform-kind-bench [operations]   (default 2000000)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+const int NumMatrices = 1024;  // matrices per kind, cycled through by the timing loops
+const double MaxError = 1.0e-5;
+
+const char* const KindNames[] = { "rigid", "uniform scale", "affine", "projective" };
+
+//----------------------------------------------------------------------------
+// referenceInverse(m, inv):
+// Inverts the n x n row-major matrix m in double precision (Gauss-Jordan
+// with partial pivoting).
+//
+//----------------------------------------------------------------------------
+static void referenceInverse(int n, const double* m, double* inv)
+{
+    double a[4][8];
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            a[i][j] = m[n * i + j];
+            a[i][n + j] = (i == j) ? 1.0 : 0.0;
+        }
+
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int i = c + 1; i < n; i++)
+            if (fabs(a[i][c]) > fabs(a[pivot][c]))
+                pivot = i;
+        for (int j = 0; j < 2 * n; j++)
+            swap(a[c][j], a[pivot][j]);
+
+        double p = a[c][c];
+        for (int j = 0; j < 2 * n; j++)
+            a[c][j] /= p;
+        for (int i = 0; i < n; i++)
+            if (i != c) {
+                double f = a[i][c];
+                for (int j = 0; j < 2 * n; j++)
+                    a[i][j] -= f * a[c][j];
+            }
+    }
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            inv[n * i + j] = a[i][n + j];
+}
+
+//----------------------------------------------------------------------------
+// relativeError(n, result, reference):
+// Returns the largest entry of |result - reference| over the largest entry
+// of |reference|, for n x n row-major matrices.
+//
+//----------------------------------------------------------------------------
+static double relativeError(int n, const GLfloat* result, const double* reference)
+{
+    double error = 0.0, scale = 0.0;
+    for (int i = 0; i < n * n; i++) {
+        error = max(error, fabs(result[i] - reference[i]));
+        scale = max(scale, fabs(reference[i]));
+    }
+    return error / scale;
+}
+
+//----------------------------------------------------------------------------
+// randomModelView(kind, rng):
+// Returns a random model-view matrix of the given kind.
+//
+//----------------------------------------------------------------------------
+static mat4 randomModelView(TransformKind kind, mt19937& rng)
+{
+    uniform_real_distribution<GLfloat> unit(-1.0f, 1.0f);
+    uniform_real_distribution<GLfloat> angle(-180.0f, 180.0f);
+    uniform_real_distribution<GLfloat> scale(0.25f, 4.0f);
+
+    vec4 eye(10.0f * unit(rng), 2.0f + 5.0f * fabs(unit(rng)), 10.0f * unit(rng), 1.0f);
+    mat4 mv = LookAt(eye, vec4(0.0, 0.0, 0.0, 1.0), vec4(0.0, 1.0, 0.0, 0.0))
+            * Translate(5.0f * unit(rng), 1.0f, 5.0f * unit(rng))
+            * Rotate(angle(rng), unit(rng), unit(rng), 1.0f)
+            * Rotate(normalize(Quaternion(angle(rng), 1.0f, unit(rng), unit(rng))));
+
+    if (kind == TransformUniformScale) {
+        GLfloat s = scale(rng);
+        mv = mv * Scale(s, s, s);
+    }
+    else if (kind == TransformAffine)
+        mv = mv * Scale(scale(rng), scale(rng), scale(rng));
+    else if (kind == TransformProjective)
+        mv = Perspective(45.0f, 1.0f, 0.5f, 60.0f) * mv;
+    return mv;
+}
+
+//----------------------------------------------------------------------------
+// sum(m, n):
+// Returns the sum of the entries of the n x n matrix m (so that the timed
+// results are used).
+//
+//----------------------------------------------------------------------------
+static GLfloat sum(const GLfloat* m, int n)
+{
+    GLfloat s = 0.0f;
+    for (int i = 0; i < n * n; i++)
+        s += m[i];
+    return s;
+}
+
+//----------------------------------------------------------------------------
+// timeOp(matrices, operations, func):
+// Returns ns per call of func(matrices[i]) over operations calls.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static double timeOp(const vector<mat4>& matrices, int operations, Func func)
+{
+    GLfloat sink = 0.0f;
+    double best = 1.0e30;
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < operations; i++)
+            sink += func(matrices[i & (NumMatrices - 1)]);
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    if (sink == 12345.0f)
+        printf(" ");
+    return best * 1.0e9 / operations;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    int operations = (argc > 1) ? atoi(argv[1]) : 2000000;
+    mt19937 rng(6533);
+    bool ok = true;
+
+    printf("%-14s  %-13s  %11s  %11s  %8s  %12s  %12s\n", "kind", "function", "general ns", "by kind ns",
+           "speedup", "general err", "by kind err");
+
+    for (int k = TransformRigid; k <= TransformProjective; k++) {
+        const TransformKind kind = (TransformKind) k;
+        const TransformKind general = TransformProjective;
+
+        vector<mat4> matrices(NumMatrices);
+        for (int i = 0; i < NumMatrices; i++)
+            matrices[i] = randomModelView(kind, rng);
+
+        // Errors against the double precision references
+        double normal_error[2] = { 0.0, 0.0 }, inverse_error[2] = { 0.0, 0.0 };
+        for (int i = 0; i < NumMatrices; i++) {
+            const mat4& m = matrices[i];
+            double upper[9], upper_inverse[9], normal[9], full[16], full_inverse[16];
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++)
+                    upper[3 * r + c] = m[r][c];
+            for (int j = 0; j < 16; j++)
+                full[j] = ((const GLfloat*) m)[j];
+            referenceInverse(3, upper, upper_inverse);
+            referenceInverse(4, full, full_inverse);
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++)
+                    normal[3 * r + c] = upper_inverse[3 * c + r];
+
+            bool invertible[2];
+            mat3 n[2] = { NormalMatrix(m, general), NormalMatrix(m, kind) };
+            mat4 inv[2] = { inverse(m, general, &invertible[0]), inverse(m, kind, &invertible[1]) };
+            if (!invertible[0] || !invertible[1]) {
+                printf("Error: inverse() finds a %s model-view not invertible\n", KindNames[kind]);
+                ok = false;
+            }
+            for (int j = 0; j < 2; j++) {
+                normal_error[j] = max(normal_error[j], relativeError(3, n[j], normal));
+                inverse_error[j] = max(inverse_error[j], relativeError(4, inv[j], full_inverse));
+            }
+        }
+
+        double general_ns = timeOp(matrices, operations, [=](const mat4& m) { return sum(NormalMatrix(m, general), 3); });
+        double kind_ns = timeOp(matrices, operations, [=](const mat4& m) { return sum(NormalMatrix(m, kind), 3); });
+        printf("%-14s  %-13s  %11.2f  %11.2f  %7.2fx  %12.2e  %12.2e\n", KindNames[kind], "NormalMatrix",
+               general_ns, kind_ns, general_ns / kind_ns, normal_error[0], normal_error[1]);
+
+        general_ns = timeOp(matrices, operations, [=](const mat4& m) { return sum(inverse(m, general), 4); });
+        kind_ns = timeOp(matrices, operations, [=](const mat4& m) { return sum(inverse(m, kind), 4); });
+        printf("%-14s  %-13s  %11.2f  %11.2f  %7.2fx  %12.2e  %12.2e\n", KindNames[kind], "inverse",
+               general_ns, kind_ns, general_ns / kind_ns, inverse_error[0], inverse_error[1]);
+
+        if (normal_error[1] > MaxError || inverse_error[1] > MaxError) {
+            printf("Error: the %s closed forms are off by more than %g\n", KindNames[kind], MaxError);
+            ok = false;
+        }
+    }
+
+    printf("%s\n", ok ? "All results within tolerance." : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
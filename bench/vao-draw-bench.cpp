@@ -0,0 +1,293 @@
+/************************************************************
+ * File: vao-draw-bench.cpp
+
+ * CPU cost of drawing many small meshes with the vertex attributes set up
+   before each draw, as drawObj() did (bind the buffer, then enable and
+   point each attribute, draw, and disable them), vs. with a vertex array
+   object per mesh built once, as drawObj() does now (bind it, draw).
+
+ * Each mesh has its own vertex buffer in the planar layout of the plane of
+   the renderer (point4 positions, then vec3 normals, then vec2 texture
+   coordinates) and is drawn with a trivial program whose attribute
+   locations are fixed with glBindAttribLocation(), as InitShader() does.
+   The meshes are drawn into a small window so that the GPU work stays
+   small next to the driver's.
+
+ * For each number of meshes, the main thread CPU time of submitting a frame
+   and of a frame up to glFinish() is printed per frame and per draw (best
+   of 5 runs). Both methods must draw the same image; the program fails if
+   they do not (or draw nothing). Needs a GL 3.2 context (a GLUT window).
+
+ * Usage: vao-draw-bench [frames] [max_meshes]   (default 200 4096)
+**************************************************************/
+
+#include "../Angel-yjc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+using namespace Angel;
+
+typedef Angel::vec4  point4;
+
+const int WindowSize = 64;
+const int MeshVertices = 36;  // 12 triangles
+
+enum Attributes { ATTRIBUTE_POSITION, ATTRIBUTE_NORMAL, ATTRIBUTE_TEX_COORD, NUM_ATTRIBUTES };
+const char* const attribute_names[] = { "vPosition", "vNormal", "vTexCoord" };
+
+const char* const VertexShader =
+    "#version 150\n"
+    "in vec4 vPosition;\n"
+    "in vec3 vNormal;\n"
+    "in vec2 vTexCoord;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    gl_Position = vPosition;\n"
+    "    color = vec4(abs(vNormal) * 0.5 + vec3(vTexCoord, 0.0) * 0.5, 1.0);\n"
+    "}\n";
+const char* const FragmentShader =
+    "#version 150\n"
+    "in vec4 color;\n"
+    "out vec4 fColor;\n"
+    "void main() { fColor = color; }\n";
+
+struct Mesh {
+    GLuint  buffer, vao;
+};
+
+//----------------------------------------------------------------------------
+// compileProgram():
+// Returns the program of VertexShader and FragmentShader, with the attribute
+// locations of attribute_names; exits on an error.
+//
+//----------------------------------------------------------------------------
+static GLuint compileProgram()
+{
+    const char* sources[] = { VertexShader, FragmentShader };
+    GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    GLuint program = glCreateProgram();
+    char log[1024];
+
+    for (int i = 0; i < 2; i++) {
+        GLuint shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        GLint compiled;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            printf("Error: shader failed to compile:\n%s\n", log);
+            exit(EXIT_FAILURE);
+        }
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+
+    for (int i = 0; i < NUM_ATTRIBUTES; i++)
+        glBindAttribLocation(program, i, attribute_names[i]);
+    glLinkProgram(program);
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        printf("Error: program failed to link:\n%s\n", log);
+        exit(EXIT_FAILURE);
+    }
+    return program;
+}
+
+//----------------------------------------------------------------------------
+// createMesh(index, count):
+// Creates the vertex buffer of mesh index of count: 12 triangles in its
+// cell of a grid over the window, and the vertex array object of the buffer.
+//
+//----------------------------------------------------------------------------
+static Mesh createMesh(int index, int count)
+{
+    int side = 1;
+    while (side * side < count)
+        side++;
+    GLfloat cell = 2.0f / side;
+    GLfloat x0 = -1.0f + cell * (index % side), y0 = -1.0f + cell * (index / side);
+
+    point4 points[MeshVertices];
+    vec3 normals[MeshVertices];
+    vec2 tex_coords[MeshVertices];
+    for (int v = 0; v < MeshVertices; v++) {
+        int t = v / 3, corner = v % 3;
+        GLfloat u = (t + (corner == 1)) / 12.0f, w = (corner == 2) ? 1.0f : 0.0f;
+        points[v] = point4(x0 + cell * u, y0 + cell * w, 0.0f, 1.0f);
+        normals[v] = vec3(GLfloat(index % 7) / 7.0f, GLfloat(t) / 12.0f, 1.0f);
+        tex_coords[v] = vec2(u, w);
+    }
+
+    Mesh mesh;
+    glGenBuffers(1, &mesh.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(points) + sizeof(normals) + sizeof(tex_coords), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(points), sizeof(normals), normals);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(points) + sizeof(normals), sizeof(tex_coords), tex_coords);
+
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+    glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+    glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof(points)));
+    glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+    glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof(points) + sizeof(normals)));
+    glBindVertexArray(0);
+    return mesh;
+}
+
+//----------------------------------------------------------------------------
+// drawPerDraw(meshes, shared_vao):
+// Draws meshes as the old drawObj(): the attributes of each are set up in
+// shared_vao right before its draw, and disabled after it.
+//
+//----------------------------------------------------------------------------
+static void drawPerDraw(const vector<Mesh>& meshes, GLuint shared_vao)
+{
+    glBindVertexArray(shared_vao);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, meshes[i].buffer);
+        glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+        glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+        glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+        glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 0,
+                              BUFFER_OFFSET(sizeof(point4) * MeshVertices));
+        glEnableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+        glVertexAttribPointer(ATTRIBUTE_TEX_COORD, 2, GL_FLOAT, GL_FALSE, 0,
+                              BUFFER_OFFSET((sizeof(point4) + sizeof(vec3)) * MeshVertices));
+        glDrawArrays(GL_TRIANGLES, 0, MeshVertices);
+        glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+        glDisableVertexAttribArray(ATTRIBUTE_NORMAL);
+        glDisableVertexAttribArray(ATTRIBUTE_TEX_COORD);
+    }
+}
+
+//----------------------------------------------------------------------------
+// drawVertexArrays(meshes):
+// Draws meshes as drawObj() does now: a bind of the vertex array object of
+// each and its draw.
+//
+//----------------------------------------------------------------------------
+static void drawVertexArrays(const vector<Mesh>& meshes)
+{
+    for (size_t i = 0; i < meshes.size(); i++) {
+        glBindVertexArray(meshes[i].vao);
+        glDrawArrays(GL_TRIANGLES, 0, MeshVertices);
+    }
+}
+
+//----------------------------------------------------------------------------
+// timeFrames(frames, draw, submit_us, frame_us, image):
+// Draws frames frames with draw() and returns the best (of 5 runs) main
+// thread CPU time per frame of the submission and of the whole frame up to
+// glFinish(), in microseconds; and the image of the last frame.
+//
+//----------------------------------------------------------------------------
+template <typename Draw>
+static void timeFrames(int frames, Draw draw, double& submit_us, double& frame_us, vector<unsigned char>& image)
+{
+    submit_us = frame_us = 1.0e30;
+    for (int run = 0; run < 5; run++) {
+        double submit = 0.0;
+        glFinish();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            chrono::steady_clock::time_point frame_start = chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT);
+            draw();
+            submit += chrono::duration<double>(chrono::steady_clock::now() - frame_start).count();
+            glFlush();
+        }
+        glFinish();
+        double total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        submit_us = min(submit_us, submit * 1.0e6 / frames);
+        frame_us = min(frame_us, total * 1.0e6 / frames);
+    }
+
+    image.resize(WindowSize * WindowSize * 4);
+    glReadPixels(0, 0, WindowSize, WindowSize, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    glutInit(&argc, argv);
+#ifdef __APPLE__
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE | GLUT_3_2_CORE_PROFILE);
+#else
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE);
+#endif
+    glutInitWindowSize(WindowSize, WindowSize);
+    glutCreateWindow("vao-draw-bench");
+#ifndef __APPLE__
+    int err = glewInit();
+    if (GLEW_OK != err) {
+        printf("Error: glewInit failed: %s\n", (char*) glewGetErrorString(err));
+        return EXIT_FAILURE;
+    }
+#endif
+
+    int frames = (argc > 1) ? atoi(argv[1]) : 200;
+    int max_meshes = (argc > 2) ? atoi(argv[2]) : 4096;
+    bool ok = true;
+
+    printf("%s\n", (const char*) glGetString(GL_RENDERER));
+    GLuint program = compileProgram();
+    glUseProgram(program);
+    glViewport(0, 0, WindowSize, WindowSize);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    GLuint shared_vao;  // the one vertex array of the per-draw setup (a core profile needs one)
+    glGenVertexArrays(1, &shared_vao);
+
+    printf("%7s  %-13s  %10s  %10s  %10s  %8s\n", "meshes", "method", "submit us", "frame us", "ns/draw", "speedup");
+
+    for (int count = 16; count <= max_meshes; count *= 4) {
+        vector<Mesh> meshes;
+        for (int i = 0; i < count; i++)
+            meshes.push_back(createMesh(i, count));
+
+        double submit_us[2], frame_us[2];
+        vector<unsigned char> image[2];
+        timeFrames(frames, [&]() { drawPerDraw(meshes, shared_vao); }, submit_us[0], frame_us[0], image[0]);
+        timeFrames(frames, [&]() { drawVertexArrays(meshes); }, submit_us[1], frame_us[1], image[1]);
+
+        const char* const methods[] = { "per-draw", "vertex arrays" };
+        for (int m = 0; m < 2; m++)
+            printf("%7d  %-13s  %10.1f  %10.1f  %10.1f  %7.2fx\n", count, methods[m], submit_us[m], frame_us[m],
+                   submit_us[m] * 1.0e3 / count, submit_us[0] / submit_us[m]);
+
+        size_t lit = 0;
+        for (size_t i = 0; i < image[1].size(); i += 4)
+            lit += (image[1][i] | image[1][i + 1] | image[1][i + 2]) != 0;
+        if (lit == 0) {
+            printf("Error: nothing was drawn of %d meshes\n", count);
+            ok = false;
+        }
+        if (image[0] != image[1]) {
+            printf("Error: the two methods drew different images of %d meshes\n", count);
+            ok = false;
+        }
+        if (glGetError() != GL_NO_ERROR) {
+            printf("Error: GL error drawing %d meshes\n", count);
+            ok = false;
+        }
+
+        for (size_t i = 0; i < meshes.size(); i++) {
+            glDeleteVertexArrays(1, &meshes[i].vao);
+            glDeleteBuffers(1, &meshes[i].buffer);
+        }
+    }
+
+    printf("%s\n", ok ? "Both methods drew the same images." : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,313 @@
+/************************************************************
+ * File: vertex-layout-bench.cpp
+
+ * Vertex throughput of the sphere buffers in the planar layout (all
+   positions, then all normals) vs. the interleaved layout (the position and
+   normal of a vertex next to each other) of "vertex-format.h".
+
+ * The meshes are the 1024-triangle sphere file (if it can be read) and
+   icospheres of 1280 to 20 * 4^max_level triangles, in the float
+   (point4, vec3) and the quantized (QuantizedPoint, OctahedralNormal)
+   vertex formats: the welded sphere drawn with its index buffer, as
+   createSphereBuffers() lays it out, and the triangle soup of a streamed
+   sphere (with its smooth normals) drawn with glDrawArrays().
+
+ * Each buffer is drawn with the rasterizer discarded, so that only the
+   vertex fetch and the vertex shader (which reads every attribute) are
+   timed: millions of vertices per second, best of 5 runs of at least 4M
+   vertices each. Both layouts must draw the same image with the rasterizer
+   on; the program fails if they do not. Needs a GL 3.2 context (a GLUT
+   window).
+
+ * Usage: vertex-layout-bench [max_level] [sphere_file]
+          (default 8 sphere.1024.txt)
+**************************************************************/
+
+#include "../sphere-mesh.h"
+#include "../vertex-format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const int WindowSize = 64;
+const double MinRunVertices = 4.0e6;
+
+enum Attributes { ATTRIBUTE_POSITION, ATTRIBUTE_NORMAL, NUM_ATTRIBUTES };
+const char* const attribute_names[] = { "vPosition", "vNormal" };
+
+const char* const VertexShader =
+    "#version 150\n"
+    "in vec4 vPosition;\n"
+    "in vec3 vNormal;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(vPosition.xyz * 0.9 + vNormal * 0.01, 1.0);\n"
+    "    color = vec4(abs(vNormal), 1.0);\n"
+    "}\n";
+const char* const FragmentShader =
+    "#version 150\n"
+    "in vec4 color;\n"
+    "out vec4 fColor;\n"
+    "void main() { fColor = color; }\n";
+
+//  A sphere buffer in one vertex format and layout, with its vertex array
+struct LayoutBuffer {
+    GLuint  buffer, vao;
+};
+
+//----------------------------------------------------------------------------
+// compileProgram():
+// Returns the program of VertexShader and FragmentShader, with the attribute
+// locations of attribute_names; exits on an error.
+//
+//----------------------------------------------------------------------------
+static GLuint compileProgram()
+{
+    const char* sources[] = { VertexShader, FragmentShader };
+    GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    GLuint program = glCreateProgram();
+    char log[1024];
+
+    for (int i = 0; i < 2; i++) {
+        GLuint shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        GLint compiled;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+            printf("Error: shader failed to compile:\n%s\n", log);
+            exit(EXIT_FAILURE);
+        }
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+
+    for (int i = 0; i < NUM_ATTRIBUTES; i++)
+        glBindAttribLocation(program, i, attribute_names[i]);
+    glLinkProgram(program);
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        printf("Error: program failed to link:\n%s\n", log);
+        exit(EXIT_FAILURE);
+    }
+    return program;
+}
+
+//----------------------------------------------------------------------------
+// sphereFormat(quantized, interleaved):
+// Returns the vertex format of the sphere buffers, as setSphereVertexFormat()
+// builds it.
+//
+//----------------------------------------------------------------------------
+static VertexFormat sphereFormat(bool quantized, bool interleaved)
+{
+    VertexFormat format(interleaved);
+    if (quantized)
+        format.add<QuantizedPoint>(ATTRIBUTE_POSITION).add<OctahedralNormal>(ATTRIBUTE_NORMAL);
+    else
+        format.add<point4>(ATTRIBUTE_POSITION).add<vec3>(ATTRIBUTE_NORMAL);
+    return format;
+}
+
+//----------------------------------------------------------------------------
+// createBuffer(format, points, normals, num_vertices, radius, index_buffer):
+// Creates a buffer of num_vertices points and normals (quantized if format
+// is) and its vertex array, with index_buffer (if not 0) as its element
+// buffer.
+//
+//----------------------------------------------------------------------------
+static LayoutBuffer createBuffer(const VertexFormat& format, const point4* points, const vec3* normals,
+                                 GLsizeiptr num_vertices, GLfloat radius, GLuint index_buffer)
+{
+    const void* values[2] = { points, normals };
+    vector<QuantizedPoint> quantized;
+    vector<OctahedralNormal> encoded;
+    if (format.attribute(0).type == GL_SHORT) {
+        quantized.resize(num_vertices);
+        encoded.resize(num_vertices);
+        quantizeSpherePoints(points, num_vertices, radius, quantized.data());
+        encodeOctahedralNormals(normals, num_vertices, encoded.data());
+        values[0] = quantized.data();
+        values[1] = encoded.data();
+    }
+
+    LayoutBuffer b;
+    glGenVertexArrays(1, &b.vao);
+    glBindVertexArray(b.vao);
+    glGenBuffers(1, &b.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, b.buffer);
+    glBufferData(GL_ARRAY_BUFFER, format.bufferSize(num_vertices), NULL, GL_STATIC_DRAW);
+    format.upload(num_vertices, 0, num_vertices, values);
+    format.setAttributes(num_vertices);
+    if (index_buffer != 0)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBindVertexArray(0);
+    return b;
+}
+
+//----------------------------------------------------------------------------
+// draw(b, count, index_type):
+// Draws count vertices of b, indexed if index_type is not GL_NONE.
+//
+//----------------------------------------------------------------------------
+static void draw(const LayoutBuffer& b, int count, GLenum index_type)
+{
+    glBindVertexArray(b.vao);
+    if (index_type != GL_NONE)
+        glDrawElements(GL_TRIANGLES, count, index_type, BUFFER_OFFSET(0));
+    else
+        glDrawArrays(GL_TRIANGLES, 0, count);
+}
+
+//----------------------------------------------------------------------------
+// vertexRate(b, count, index_type):
+// Returns millions of vertices per second of drawing b with the rasterizer
+// discarded (best of 5 runs).
+//
+//----------------------------------------------------------------------------
+static double vertexRate(const LayoutBuffer& b, int count, GLenum index_type)
+{
+    int draws = int(MinRunVertices / count) + 1;
+    double best = 1.0e30;
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    draw(b, count, index_type);  // warm up
+    glFinish();
+    for (int run = 0; run < 5; run++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int i = 0; i < draws; i++)
+            draw(b, count, index_type);
+        glFinish();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    return double(draws) * count / best / 1.0e6;
+}
+
+//----------------------------------------------------------------------------
+// image(b, count, index_type):
+// Returns the image of drawing b once.
+//
+//----------------------------------------------------------------------------
+static vector<unsigned char> image(const LayoutBuffer& b, int count, GLenum index_type)
+{
+    vector<unsigned char> pixels(WindowSize * WindowSize * 4);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    draw(b, count, index_type);
+    glReadPixels(0, 0, WindowSize, WindowSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+//----------------------------------------------------------------------------
+// benchMesh(name, mesh):
+// Prints the vertex rates of the indexed and soup buffers of mesh in both
+// formats and layouts; false if the layouts drew different images.
+//
+//----------------------------------------------------------------------------
+static bool benchMesh(const string& name, const SphereMesh& mesh)
+{
+    WeldedSphereMesh welded;
+    weldSphereMesh(mesh, 1.0e-5f, welded);
+
+    GLuint index_buffer;
+    glGenBuffers(1, &index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, welded.indexDataSize(), welded.indexData(), GL_STATIC_DRAW);
+
+    bool ok = true;
+    for (int quantized = 0; quantized < 2; quantized++) {
+        for (int smooth = 1; smooth >= 0; smooth--) {
+            const point4* points = smooth ? welded.points.data() : mesh.points;
+            const vec3* normals = smooth ? welded.normals.data() : mesh.smooth_normals;
+            GLsizeiptr num_vertices = smooth ? GLsizeiptr(welded.points.size()) : mesh.num_vertices;
+            GLenum index_type = smooth ? welded.index_type : GL_NONE;
+
+            double rate[2];
+            vector<unsigned char> pixels[2];
+            GLsizeiptr stride[2];
+            for (int interleaved = 0; interleaved < 2; interleaved++) {
+                VertexFormat format = sphereFormat(quantized != 0, interleaved != 0);
+                LayoutBuffer b = createBuffer(format, points, normals, num_vertices, mesh.radius,
+                                              smooth ? index_buffer : 0);
+                stride[interleaved] = format.stride();
+                rate[interleaved] = vertexRate(b, mesh.num_vertices, index_type);
+                pixels[interleaved] = image(b, mesh.num_vertices, index_type);
+                glDeleteVertexArrays(1, &b.vao);
+                glDeleteBuffers(1, &b.buffer);
+            }
+
+            printf("%-16s  %-9s  %-6s  %10d  %4d / %-4d  %11.1f  %11.1f  %7.2fx\n", name.c_str(),
+                   quantized ? "quantized" : "float", smooth ? "index" : "soup", mesh.num_vertices,
+                   int(stride[0]), int(stride[1]), rate[0], rate[1], rate[1] / rate[0]);
+            if (pixels[0] != pixels[1]) {
+                printf("Error: the layouts drew different images of %s\n", name.c_str());
+                ok = false;
+            }
+        }
+    }
+
+    glDeleteBuffers(1, &index_buffer);
+    return ok;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    glutInit(&argc, argv);
+#ifdef __APPLE__
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE | GLUT_DEPTH | GLUT_3_2_CORE_PROFILE);
+#else
+    glutInitDisplayMode(GLUT_RGBA | GLUT_SINGLE | GLUT_DEPTH);
+#endif
+    glutInitWindowSize(WindowSize, WindowSize);
+    glutCreateWindow("vertex-layout-bench");
+#ifndef __APPLE__
+    int err = glewInit();
+    if (GLEW_OK != err) {
+        printf("Error: glewInit failed: %s\n", (char*) glewGetErrorString(err));
+        return EXIT_FAILURE;
+    }
+#endif
+
+    int max_level = (argc > 1) ? atoi(argv[1]) : 8;
+    string sphere_file = (argc > 2) ? argv[2] : "sphere.1024.txt";
+    bool ok = true;
+
+    printf("%s\n", (const char*) glGetString(GL_RENDERER));
+    glUseProgram(compileProgram());
+    glViewport(0, 0, WindowSize, WindowSize);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    printf("%-16s  %-9s  %-6s  %10s  %11s  %11s  %11s  %8s\n", "mesh", "format", "buffer", "vertices",
+           "stride", "planar Mv/s", "inter. Mv/s", "speedup");
+
+    SphereMesh mesh;
+    if (loadSphereMesh(sphere_file, mesh)) {
+        ok = benchMesh(sphere_file, mesh) && ok;
+        releaseSphereMesh(mesh);
+    }
+    else
+        printf("Note: %s not read, only icospheres are measured\n", sphere_file.c_str());
+
+    for (int level = 3; level <= max_level; level++) {
+        SphereMesh ico;
+        generateIcosphere(level, ico);
+        ok = benchMesh("icosphere." + to_string(level), ico) && ok;
+        releaseSphereMesh(ico);
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        printf("Error: GL error\n");
+        ok = false;
+    }
+    printf("%s\n", ok ? "Both layouts drew the same images." : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,6 +1,13 @@
 /* 
 File Name: "fshader53.glsl":
            Fragment Shader
+  - Compiled with the options of vshader53.glsl #defined to their values; it tests
+      LIGHTING, WIREFRAME, FLAT_SHADING, SPOTLIGHT  (0 or 1)
+      BLENDING_SHADOW     the blended shadow color and alpha
+      LATTICE             discard the lattice holes
+      GROUND_TEXTURE      modulate with the ground texture (Texture_2D, texCoord)
+      SPHERE_TEXTURE      1: the 1-D stripes, 2: the 2-D checkerboard
+      FOG_TYPE            0: no fog, 1: linear, 2: exp, 3: exp^2
 */
 
 #version 150  // YJC: Comment/un-comment this line to resolve compilation errors
@@ -15,85 +22,191 @@ in  vec2 texCoord2D;
 
 in vec2 latticeTexCoord;
 
-uniform vec4 FogColor; 
+// Frame-constant lighting, for flat shading (the same block as in vshader53.glsl)
+layout(std140) uniform Lighting {
+    vec4 GlobalAmbient;
 
-uniform int FogType;   // 0: no fog, 1: linear, 2: exp, 3: exp^2
-uniform float FogStart;    // 0.0 for linear
-uniform float FogEnd;      // 18.0 for linear
-uniform float FogDensity;  // 0.09 for exp & exp^2
+    vec4 LightDirection;     // Directional light direction (w = 0.0) (passed in eye frame) [originally in eye]
+    vec4 DirLightAmbient;
+    vec4 DirLightDiffuse;
+    vec4 DirLightSpecular;
 
-uniform bool IsBlendingShadowEnabled;
+    vec4 LightPosition;   // Positional light direction (w = 1.0) (passed in eye frame)
+    vec4 LightAmbient;
+    vec4 LightDiffuse;
+    vec4 LightSpecular;
+
+    vec3 SpotlightDirection;    // Spot light direction (passed in eye frame)
+    float SpotlightExponent;    // Spot exponent
+    float SpotlightCutoff;      // Spot cutoff angle in radians
+
+    float ConstAtt;  // Constant Attenuation
+    float LinearAtt; // Linear Attenuation
+    float QuadAtt;   // Quadratic Attenuation
+};
+
+// Fog (FogBlock in rotate-sphere-texture.cpp)
+layout(std140) uniform Fog {
+    vec4 FogColor;
+
+    float FogStart;    // 0.0 for linear
+    float FogEnd;      // 18.0 for linear
+    float FogDensity;  // 0.09 for exp & exp^2
+};
+
+// Per-object transforms, material and texture mapping modes (the same block as in vshader53.glsl)
+layout(std140, row_major) uniform Object {
+    mat4 ModelView;
+    mat3 NormalMatrix;
+
+    vec4 MaterialAmbient;
+    vec4 MaterialDiffuse;
+    vec4 MaterialSpecular;
+    float Shininess;
+
+    float PositionScale;
+
+    bool IsEyeSpace;
+    int SphereMappingMode;
+    int LatticeMappingMode;
+};
 
 uniform sampler1D Texture_1D;
 uniform sampler2D Texture_2D; 
 
-uniform int IsTextureMappedGround; // 0: no texture application: obj color
-                                    // 1: (obj color) * (texture color)
+out vec4 fColor;
 
-uniform int TextureMappedSphereFlag;
+// Lights a point at pos (eye frame) with normal N, turned towards the viewer;
+// the same function as in vshader53.glsl
+vec4 shade(vec3 pos, vec3 N)
+{
+    vec3 E = normalize(-pos); // Viewer eye vector
 
-uniform bool IsWireframeEnabled;
+    if (dot(N, E) < 0) N = -N;
 
-uniform bool IsLatticeOn;
+    vec4 totalColor = GlobalAmbient * MaterialAmbient;
 
-out vec4 fColor;
+    // Directional Light 
+    vec3 dir_L = normalize(-LightDirection.xyz);
+    vec3 dir_H = normalize(dir_L + E);
+
+    float dir_d = max(dot(N, dir_L), 0.0);
+    vec4 dirDiffuse = dir_d * DirLightDiffuse * MaterialDiffuse;
+
+    float dir_s = pow(max(dot(N, dir_H), 0.0), Shininess);
+    vec4 dirSpecular = dir_s * DirLightSpecular * MaterialSpecular;
+
+    if (dot(N, dir_L) < 0.0) dirSpecular = vec4(0.0);
+
+    float attenuation = 1.0;
+
+    totalColor += attenuation * (DirLightAmbient * MaterialAmbient + dirDiffuse + dirSpecular);
+
+    // Positional Light
+    vec3 pos_L = LightPosition.xyz - pos;
+    float distance = length(pos_L);
+    pos_L = normalize(pos_L);
+    vec3 pos_H = normalize(pos_L + E);
+
+    attenuation = 1.0 / (ConstAtt + LinearAtt * distance + QuadAtt * distance * distance);
+
+    float pos_d = max(dot(N, pos_L), 0.0);
+    vec4 posDiffuse = pos_d * LightDiffuse * MaterialDiffuse;
+
+    float pos_s = pow(max(dot(N, pos_H), 0.0), Shininess);
+    vec4 posSpecular = pos_s * LightSpecular * MaterialSpecular;
+
+    if (dot(N, pos_L) < 0.0) posSpecular = vec4(0.0);
+
+    // Spotlight
+    vec4 spotlightAttenuation = vec4(1.0); // Starting value for spotEffect
+#if SPOTLIGHT
+    {
+        float spotCos = dot(normalize(SpotlightDirection), -pos_L); // pos_L points from light to vert & SpotlightDirection is already in the eye frame
+        if (spotCos < cos(SpotlightCutoff)) { // SpotlightCutOff is already in radians
+            spotlightAttenuation = vec4(0.0); // outside spotlight cone
+        }
+        else {
+            spotlightAttenuation = vec4(pow(spotCos, SpotlightExponent));
+        }
+    }
+#endif
+
+    vec4 posAmbient = LightAmbient * MaterialAmbient;
+    totalColor += attenuation * spotlightAttenuation * (posAmbient + posDiffuse + posSpecular);
+
+    return totalColor;
+}
 
 void main() 
 {   
-    if (!IsWireframeEnabled && IsLatticeOn) {
+#if FLAT_SHADING
+    // The normal of the face of the fragment, from the screen-space derivatives of its
+    // eye position (taken before any discard, where they are still defined)
+    vec3 faceNormal = cross(dFdx(eyePosition.xyz), dFdy(eyePosition.xyz));
+#endif
+
+#if LATTICE
+    {
         float s = fract(4.0 * latticeTexCoord.s);
         float t = fract(4.0 * latticeTexCoord.t);
         if (s < 0.35 && t < 0.35)
             discard;
     }
+#endif
 
     float fogFactor = 1.0;
     float z = -eyePosition.z;
 
     vec4 currColor = color;
 
-    if (IsBlendingShadowEnabled)
-        currColor = vec4(0.25f, 0.25f, 0.25f, 0.65f);  // Shadow Blending Color
-    
+#if FLAT_SHADING
+    // Flat shading: the sphere shares its buffer (and smooth normals) with smooth shading,
+    // so it is lit here with its face normal instead
+    currColor = shade(eyePosition.xyz, normalize(faceNormal));
+#endif
 
-    if (IsTextureMappedGround == 0)
-        currColor = currColor;
-    else if (IsTextureMappedGround == 1)
-        currColor = currColor * texture(Texture_2D, texCoord);
+#if BLENDING_SHADOW
+    currColor = vec4(0.25f, 0.25f, 0.25f, 0.65f);  // Shadow Blending Color
+#endif
 
-    if (!IsWireframeEnabled) {
-        if (TextureMappedSphereFlag == 0) {
-            currColor = currColor;
-        }
-        else if (TextureMappedSphereFlag == 1) {
-            vec4 texColor = texture(Texture_1D, texCoord1D);
-            currColor = currColor * texColor * vec4(1.0f, 1.0f, 0.0f, 1.0f); // modulate with yellow
-        }
-        else if (TextureMappedSphereFlag == 2) {
-            vec4 texColor = texture(Texture_2D, texCoord2D);
+#if GROUND_TEXTURE  // (obj color) * (texture color)
+    currColor = currColor * texture(Texture_2D, texCoord);
+#endif
 
-            // Change greenish into reddish, if found
-            if (texColor.x < 0.2f && texColor.y > 0.5f && texColor.z < 0.2f)
-                texColor = vec4(0.9f, 0.1f, 0.1f, 1.0f);
+#if SPHERE_TEXTURE == 1
+    {
+        vec4 texColor = texture(Texture_1D, texCoord1D);
+        currColor = currColor * texColor * vec4(1.0f, 1.0f, 0.0f, 1.0f); // modulate with yellow
+    }
+#elif SPHERE_TEXTURE == 2
+    {
+        vec4 texColor = texture(Texture_2D, texCoord2D);
 
-            currColor = currColor * texColor * vec4(1.0f, 1.0f, 0.0f, 1.0f);
-        }
+        // Change greenish into reddish, if found
+        if (texColor.x < 0.2f && texColor.y > 0.5f && texColor.z < 0.2f)
+            texColor = vec4(0.9f, 0.1f, 0.1f, 1.0f);
+
+        currColor = currColor * texColor * vec4(1.0f, 1.0f, 0.0f, 1.0f);
     }
+#endif
 
-    if (FogType == 1)   // Linear
-        fogFactor = (FogEnd - z) / (FogEnd - FogStart);
-    else if (FogType == 2)  // Exponential
-        fogFactor = exp(-FogDensity * z);
-    else if (FogType == 3)  // Exponential Squared
-        fogFactor = exp(-pow(FogDensity * z, 2.0));
+#if FOG_TYPE == 1   // Linear
+    fogFactor = (FogEnd - z) / (FogEnd - FogStart);
+#elif FOG_TYPE == 2  // Exponential
+    fogFactor = exp(-FogDensity * z);
+#elif FOG_TYPE == 3  // Exponential Squared
+    fogFactor = exp(-pow(FogDensity * z, 2.0));
+#endif
 
     fogFactor = clamp(fogFactor, 0.0, 1.0);
 
     vec3 finalRGB = mix(FogColor.rgb, currColor.rgb, fogFactor);
 
-    if (IsBlendingShadowEnabled) 
-        fColor = vec4(finalRGB, 0.65f);
-    else 
-        fColor = vec4(finalRGB, fogFactor);
+#if BLENDING_SHADOW
+    fColor = vec4(finalRGB, 0.65f);
+#else
+    fColor = vec4(finalRGB, fogFactor);
+#endif
 } 
 
@@ -0,0 +1,283 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- gl-state-cache.cpp ---
+//
+//   Shadowed GL state with redundant calls dropped (see gl-state-cache.h).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "gl-state-cache.h"
+#include <string.h>
+
+using namespace std;
+
+namespace Angel {
+
+//----------------------------------------------------------------------------
+// invalidate():
+// Marks every piece of shadowed state as unknown, so that the next call
+// setting it is issued.
+//
+//----------------------------------------------------------------------------
+void GLStateCache::invalidate()
+{
+    capabilities.clear();
+    known_polygon_mode = known_line_width = known_point_size = known_blend_func = false;
+    known_depth_mask = known_color_mask = false;
+    known_program = known_active_texture = false;
+    for (int unit = 0; unit < NumTextureUnits; unit++)
+	known_textures[unit][0] = known_textures[unit][1] = false;
+    known_vertex_array = known_array_buffer = known_uniform_buffer = false;
+    for (int i = 0; i < NumBufferBindings; i++)
+	known_ranges[i] = false;
+    uniforms.clear();
+}
+
+GLStateCounts GLStateCache::endFrame()
+{
+    GLStateCounts frame = counts;
+    counts.issued = counts.elided = 0;
+    return frame;
+}
+
+template <class T>
+bool GLStateCache::set( bool& known, T& value, const T& new_value )
+{
+    if (known && value == new_value) {
+	counts.elided++;
+	return false;
+    }
+    known = true;
+    value = new_value;
+    counts.issued++;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// Fixed-function and per-fragment state
+//----------------------------------------------------------------------------
+void GLStateCache::enable( GLenum capability, bool enabled )
+{
+    for (size_t i = 0; i < capabilities.size(); i++) {
+	if (capabilities[i].first == capability) {
+	    bool known = true;
+	    if (!set(known, capabilities[i].second, enabled))
+		return;
+	    if (enabled)
+		glEnable(capability);
+	    else
+		glDisable(capability);
+	    return;
+	}
+    }
+    capabilities.push_back(make_pair(capability, enabled));
+    counts.issued++;
+    if (enabled)
+	glEnable(capability);
+    else
+	glDisable(capability);
+}
+
+void GLStateCache::polygonMode( GLenum mode )
+{
+    if (set(known_polygon_mode, polygon_mode, mode))
+	glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+void GLStateCache::lineWidth( GLfloat width )
+{
+    if (set(known_line_width, line_width, width))
+	glLineWidth(width);
+}
+
+void GLStateCache::pointSize( GLfloat size )
+{
+    if (set(known_point_size, point_size, size))
+	glPointSize(size);
+}
+
+void GLStateCache::blendFunc( GLenum sfactor, GLenum dfactor )
+{
+    if (known_blend_func && blend_func[0] == sfactor && blend_func[1] == dfactor) {
+	counts.elided++;
+	return;
+    }
+    known_blend_func = true;
+    blend_func[0] = sfactor;
+    blend_func[1] = dfactor;
+    counts.issued++;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void GLStateCache::depthMask( GLboolean flag )
+{
+    if (set(known_depth_mask, depth_mask, flag))
+	glDepthMask(flag);
+}
+
+void GLStateCache::colorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha )
+{
+    if (known_color_mask && color_mask[0] == red && color_mask[1] == green &&
+	color_mask[2] == blue && color_mask[3] == alpha) {
+	counts.elided++;
+	return;
+    }
+    known_color_mask = true;
+    color_mask[0] = red;
+    color_mask[1] = green;
+    color_mask[2] = blue;
+    color_mask[3] = alpha;
+    counts.issued++;
+    glColorMask(red, green, blue, alpha);
+}
+
+//----------------------------------------------------------------------------
+// Bindings
+//----------------------------------------------------------------------------
+void GLStateCache::useProgram( GLuint new_program )
+{
+    if (set(known_program, program, new_program))
+	glUseProgram(new_program);
+}
+
+void GLStateCache::activeTexture( GLenum unit )
+{
+    if (set(known_active_texture, active_texture, int(unit - GL_TEXTURE0)))
+	glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture( GLenum target, GLuint texture )
+{
+    int t = (target == GL_TEXTURE_1D) ? 0 : (target == GL_TEXTURE_2D) ? 1 : -1;
+    if (!known_active_texture || active_texture < 0 || active_texture >= NumTextureUnits || t < 0) {
+	counts.issued++;   // not shadowed
+	glBindTexture(target, texture);
+	return;
+    }
+    if (set(known_textures[active_texture][t], textures[active_texture][t], texture))
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::bindBuffer( GLenum target, GLuint buffer )
+{
+    bool issue = (target == GL_ARRAY_BUFFER) ? set(known_array_buffer, array_buffer, buffer)
+	       : (target == GL_UNIFORM_BUFFER) ? set(known_uniform_buffer, uniform_buffer, buffer)
+	       : (counts.issued++, true);   // not shadowed
+    if (issue)
+	glBindBuffer(target, buffer);
+}
+
+void GLStateCache::bindBufferBase( GLenum target, GLuint index, GLuint buffer )
+{
+    bindBufferRange(target, index, buffer, 0, -1);
+}
+
+//----------------------------------------------------------------------------
+// bindBufferRange(target, index, buffer, offset, size):
+// glBindBufferRange(), or glBindBufferBase() for size -1. Both also bind
+// buffer to the generic binding point of target.
+//
+//----------------------------------------------------------------------------
+void GLStateCache::bindBufferRange( GLenum target, GLuint index, GLuint buffer,
+				    GLintptr offset, GLsizeiptr size )
+{
+    if (target == GL_UNIFORM_BUFFER && index < GLuint(NumBufferBindings)) {
+	BufferRange& r = ranges[index];
+	if (known_ranges[index] && r.buffer == buffer && r.offset == offset && r.size == size &&
+	    known_uniform_buffer && uniform_buffer == buffer) {
+	    counts.elided++;
+	    return;
+	}
+	known_ranges[index] = true;
+	r.buffer = buffer;
+	r.offset = offset;
+	r.size = size;
+	known_uniform_buffer = true;
+	uniform_buffer = buffer;
+    }
+    counts.issued++;
+    if (size == -1)
+	glBindBufferBase(target, index, buffer);
+    else
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::deleteBuffers( GLsizei n, const GLuint* buffers )
+{
+    // Deleting a bound buffer binds 0 in its place; a new buffer may then
+    // get the same name
+    for (GLsizei i = 0; i < n; i++) {
+	if (known_array_buffer && array_buffer == buffers[i])
+	    array_buffer = 0;
+	if (known_uniform_buffer && uniform_buffer == buffers[i])
+	    uniform_buffer = 0;
+	for (int b = 0; b < NumBufferBindings; b++)
+	    if (known_ranges[b] && ranges[b].buffer == buffers[i])
+		known_ranges[b] = false;
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void GLStateCache::bindVertexArray( GLuint array )
+{
+    if (set(known_vertex_array, vertex_array, array))
+	glBindVertexArray(array);
+}
+
+void GLStateCache::deleteVertexArrays( GLsizei n, const GLuint* arrays )
+{
+    for (GLsizei i = 0; i < n; i++)
+	if (known_vertex_array && vertex_array == arrays[i])
+	    vertex_array = 0;   // as deleteBuffers()
+    glDeleteVertexArrays(n, arrays);
+}
+
+//----------------------------------------------------------------------------
+// Uniforms
+//----------------------------------------------------------------------------
+bool GLStateCache::setUniform( GLint location, const GLfloat* v, int count )
+{
+    if (location < 0 || !known_program) {   // ignored by GL, or not shadowed
+	counts.issued++;
+	return true;
+    }
+    vector<GLfloat>& value = uniforms[make_pair(program, location)];
+    if (value.size() == size_t(count) && memcmp(value.data(), v, count * sizeof(GLfloat)) == 0) {
+	counts.elided++;
+	return false;
+    }
+    value.assign(v, v + count);
+    counts.issued++;
+    return true;
+}
+
+void GLStateCache::uniform1i( GLint location, GLint v )
+{
+    GLfloat bits;
+    memcpy(&bits, &v, sizeof(bits));
+    if (setUniform(location, &bits, 1))
+	glUniform1i(location, v);
+}
+
+void GLStateCache::uniform1f( GLint location, GLfloat v )
+{
+    if (setUniform(location, &v, 1))
+	glUniform1f(location, v);
+}
+
+void GLStateCache::uniform3fv( GLint location, const GLfloat* v )
+{
+    if (setUniform(location, v, 3))
+	glUniform3fv(location, 1, v);
+}
+
+void GLStateCache::uniformMatrix4fv( GLint location, GLboolean transpose, const GLfloat* m )
+{
+    GLfloat value[17];
+    memcpy(value, m, 16 * sizeof(GLfloat));
+    value[16] = transpose;   // the same matrix transposed or not is another value
+    if (setUniform(location, value, 17))
+	glUniformMatrix4fv(location, 1, transpose, m);
+}
+
+}  // namespace Angel
@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- gl-state-cache.h ---
+//
+//   A thin layer over the GL state calls of a frame that shadows the current
+//   value of each piece of state it sets (capabilities, polygon mode, line
+//   width, blending, depth and color masks, program, vertex array, texture
+//   and buffer bindings, uniform values) and drops a call that would set the value the
+//   state already has.
+//
+//   The shadow is only right as long as every change of the cached state
+//   goes through the cache: state set by a direct gl*() call must be
+//   followed by invalidate(). State not known yet (at the start, or after
+//   invalidate()) is always set.
+//
+//   Each call is counted as issued or elided; endFrame() returns the counts
+//   of the frame and starts the next one.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __GL_STATE_CACHE_H__
+#define __GL_STATE_CACHE_H__
+
+#include "Angel-yjc.h"
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace Angel {
+
+//  Calls of a frame made through a GLStateCache
+struct GLStateCounts {
+    long  issued;   // passed on to GL
+    long  elided;   // dropped, as GL already had the value
+
+    bool operator == ( const GLStateCounts& c ) const
+	{ return issued == c.issued && elided == c.elided; }
+    bool operator != ( const GLStateCounts& c ) const
+	{ return !(*this == c); }
+};
+
+class GLStateCache {
+public:
+    GLStateCache() { invalidate(); counts.issued = counts.elided = 0; }
+
+    //  Forget the shadowed state, e.g. after GL state was set directly
+    void invalidate();
+
+    //  Counts of the frame since the last call, then start counting the next
+    GLStateCounts endFrame();
+
+    //  Fixed-function and per-fragment state
+    void enable( GLenum capability, bool enabled = true );
+    void disable( GLenum capability ) { enable( capability, false ); }
+    void polygonMode( GLenum mode );        // GL_FRONT_AND_BACK
+    void lineWidth( GLfloat width );
+    void pointSize( GLfloat size );
+    void blendFunc( GLenum sfactor, GLenum dfactor );
+    void depthMask( GLboolean flag );
+    void colorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha );
+
+    //  Bindings. Only the GL_ARRAY_BUFFER and GL_UNIFORM_BUFFER bindings are
+    //  shadowed; other buffer targets are always bound.
+    void useProgram( GLuint program );
+    void activeTexture( GLenum unit );
+    void bindTexture( GLenum target, GLuint texture );   // of the active unit
+    void bindBuffer( GLenum target, GLuint buffer );
+    void bindBufferBase( GLenum target, GLuint index, GLuint buffer );
+    void bindBufferRange( GLenum target, GLuint index, GLuint buffer,
+			  GLintptr offset, GLsizeiptr size );
+    void deleteBuffers( GLsizei n, const GLuint* buffers );  // unbinds them as GL does
+    void bindVertexArray( GLuint array );
+    void deleteVertexArrays( GLsizei n, const GLuint* arrays );
+
+    //  Uniforms of the current program (see useProgram())
+    void uniform1i( GLint location, GLint v );
+    void uniform1f( GLint location, GLfloat v );
+    void uniform3fv( GLint location, const GLfloat* v );
+    void uniformMatrix4fv( GLint location, GLboolean transpose, const GLfloat* m );
+
+private:
+    static const int  NumTextureUnits = 8;
+    static const int  NumBufferBindings = 16;   // indexed GL_UNIFORM_BUFFER binding points
+
+    //  A binding point of glBindBufferRange() / glBindBufferBase() (size -1)
+    struct BufferRange {
+	GLuint      buffer;
+	GLintptr    offset;
+	GLsizeiptr  size;
+    };
+
+    //  Sets value to new_value and counts the call; true if it has to be issued
+    template <class T>
+    bool set( bool& known, T& value, const T& new_value );
+
+    //  Compares the count floats v with the cached value of location of the
+    //  current program, and stores them; true if the uniform has to be set
+    bool setUniform( GLint location, const GLfloat* v, int count );
+
+    GLStateCounts  counts;
+
+    std::vector< std::pair<GLenum, bool> >  capabilities;   // the known ones
+
+    bool       known_polygon_mode, known_line_width, known_point_size;
+    bool       known_blend_func, known_depth_mask, known_color_mask;
+    GLenum     polygon_mode;
+    GLfloat    line_width, point_size;
+    GLenum     blend_func[2];
+    GLboolean  depth_mask;
+    GLboolean  color_mask[4];
+
+    bool       known_program, known_active_texture;
+    GLuint     program;
+    int        active_texture;   // unit - GL_TEXTURE0
+    bool       known_textures[NumTextureUnits][2];
+    GLuint     textures[NumTextureUnits][2];   // GL_TEXTURE_1D, GL_TEXTURE_2D
+
+    bool         known_vertex_array;
+    GLuint       vertex_array;
+
+    bool         known_array_buffer, known_uniform_buffer;
+    GLuint       array_buffer, uniform_buffer;
+    bool         known_ranges[NumBufferBindings];
+    BufferRange  ranges[NumBufferBindings];
+
+    //  Uniform values (as floats, bit for bit) by program and location
+    std::map< std::pair<GLuint, GLint>, std::vector<GLfloat> >  uniforms;
+};
+
+}  // namespace Angel
+
+#endif // __GL_STATE_CACHE_H__
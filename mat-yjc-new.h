@@ -53,6 +53,34 @@
 
 namespace Angel {
 
+//----------------------------------------------------------------------------
+//
+//  Transform kinds
+//
+//  The kinds of transform, from the most to the least special; the product
+//  of two transforms is of the larger of their kinds. inverse(m, kind) and
+//  NormalMatrix(mv, kind) use closed forms for the special kinds:
+//    TransformRigid:        rotation (mat3), rotation and translation (mat4)
+//    TransformUniformScale: a rigid transform with a uniform scale s != 0
+//    TransformAffine:       any 3x3 linear part (mat3), with translation (mat4)
+//    TransformProjective:   any mat4 (bottom row other than (0, 0, 0, 1))
+//  mat3 and mat4 are plain arrays of GLfloats and do not record their kind:
+//  the caller, which knows how it built a matrix, passes it (productKind()
+//  gives the kind of a composition). A kind that is too special gives a
+//  wrong result.
+//
+
+enum TransformKind {
+    TransformRigid,
+    TransformUniformScale,
+    TransformAffine,
+    TransformProjective
+};
+
+//  The kind of a product of transforms of kinds a and b
+constexpr TransformKind productKind( TransformKind a, TransformKind b )
+    { return a > b ? a : b; }
+
 //----------------------------------------------------------------------------
 //
 //  mat2 - 2D square matrix
@@ -67,29 +95,22 @@ class mat2 {
     //  --- Constructors and Destructors ---
     //
 
-    mat2( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;   }
+    constexpr mat2( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec2( d, 0.0 ), vec2( 0.0, d ) } {}
 
-    mat2( const vec2& a, const vec2& b )
-	{ _m[0] = a;  _m[1] = b;  }
+    constexpr mat2( const vec2& a, const vec2& b )
+	: _m{ a, b } {}
 
-    mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )   //YJC: These 4 items are given in *column order,
-                                                                 //     but the matrix is stored in *row order*.
-      { _m[0] = vec2( m00, m01 ); _m[1] = vec2( m10, m11 ); }    //YJC: This is in row order.
-
-    mat2( const mat2& m ) {
-	if ( *this != m ) {
-	    _m[0] = m._m[0];
-	    _m[1] = m._m[1];
-	} 
-    }
+    constexpr mat2( GLfloat m00, GLfloat m10, GLfloat m01, GLfloat m11 )   //YJC: These 4 items are given in *column order,
+                                                                           //     but the matrix is stored in *row order*.
+	: _m{ vec2( m00, m01 ), vec2( m10, m11 ) } {}                      //YJC: This is in row order.
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec2& operator [] ( int i ) { return _m[i]; }
-    const vec2& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec2& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec2& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmatic Operators ---
@@ -252,37 +273,26 @@ class mat3 {
     //  --- Constructors and Destructors ---
     //
 
-    mat3( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;   }
+    constexpr mat3( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec3( d, 0.0, 0.0 ), vec3( 0.0, d, 0.0 ), vec3( 0.0, 0.0, d ) } {}
 
-    mat3( const vec3& a, const vec3& b, const vec3& c )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  }
+    constexpr mat3( const vec3& a, const vec3& b, const vec3& c )
+	: _m{ a, b, c } {}
 
-    mat3( GLfloat m00, GLfloat m10, GLfloat m20,
-	  GLfloat m01, GLfloat m11, GLfloat m21,
-	  GLfloat m02, GLfloat m12, GLfloat m22 ) //YJC: These 9 items are given in *column order*,
-                                                  //     but the matrix is stored in *row order*.
-	{
-	    _m[0] = vec3( m00, m01, m02 );        //YJC: This is in row order.
-	    _m[1] = vec3( m10, m11, m12 );
-	    _m[2] = vec3( m20, m21, m22 );
-	}
-
-    mat3( const mat3& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-	    } 
-	}
+    constexpr mat3( GLfloat m00, GLfloat m10, GLfloat m20,
+		    GLfloat m01, GLfloat m11, GLfloat m21,
+		    GLfloat m02, GLfloat m12, GLfloat m22 ) //YJC: These 9 items are given in *column order*,
+                                                            //     but the matrix is stored in *row order*.
+	: _m{ vec3( m00, m01, m02 ),                        //YJC: This is in row order.
+	      vec3( m10, m11, m12 ),
+	      vec3( m20, m21, m22 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec3& operator [] ( int i ) { return _m[i]; }
-    const vec3& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec3& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec3& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithmatic Operators ---
@@ -442,8 +452,15 @@ mat3 transpose1( const mat3& A ) {
 ///////////////////////////////////////////////////////////////
 // YJC: Added the following:
 //      inverse(): return the inverse of the given 3x3 matrix m
+//      (of the given kind, see TransformKind)
 inline
-mat3 inverse( const mat3& m ) {
+mat3 inverse( const mat3& m, TransformKind kind = TransformAffine ) {
+  // Closed forms: the inverse of a rotation R is R^T, that of s R is (s R)^T / s^2
+  if (kind == TransformRigid)
+    return transpose1(m);
+  if (kind == TransformUniformScale)
+    return transpose1(m) / dot(m[0], m[0]);
+
   mat3 r;
 
   float det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) +
@@ -475,6 +492,69 @@ mat3 inverse( const mat3& m ) {
   return r;
 }
 
+//----------------------------------------------------------------------------
+//
+//  mat4 SIMD kernels (see the SIMD backend in Angel-yjc.h). The matrices are
+//  16 floats in row order; the sums are accumulated in the same order as by
+//  the scalar loops in mat4, so the results are bit-identical.
+//
+
+#ifdef ANGEL_SIMD
+
+//  c = a * b (c must not overlap a or b): row i of c is the sum over k of
+//  a[i][k] * (row k of b), starting from 0 like the scalar loop.
+inline void simdMat4Multiply( const GLfloat* a, const GLfloat* b, GLfloat* c ) {
+#ifdef ANGEL_SIMD_AVX
+    // Two rows of c at a time, with row k of b in both halves
+    __m256  b0 = _mm256_broadcast_ps( (const __m128*) (b + 0) );
+    __m256  b1 = _mm256_broadcast_ps( (const __m128*) (b + 4) );
+    __m256  b2 = _mm256_broadcast_ps( (const __m128*) (b + 8) );
+    __m256  b3 = _mm256_broadcast_ps( (const __m128*) (b + 12) );
+
+    for ( int i = 0; i < 4; i += 2 ) {
+	__m256  rows = _mm256_loadu_ps( a + 4*i );
+	__m256  sum = _mm256_setzero_ps();
+	sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0x00 ), b0 ) );
+	sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0x55 ), b1 ) );
+	sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0xAA ), b2 ) );
+	sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0xFF ), b3 ) );
+	_mm256_storeu_ps( c + 4*i, sum );
+    }
+#else
+    simd4  b0 = simdLoad( b + 0 ), b1 = simdLoad( b + 4 ), b2 = simdLoad( b + 8 ), b3 = simdLoad( b + 12 );
+
+    for ( int i = 0; i < 4; ++i ) {
+	simd4  sum = simdZero();
+	sum = simdAdd( sum, simdMul( simdSplat( a[4*i + 0] ), b0 ) );
+	sum = simdAdd( sum, simdMul( simdSplat( a[4*i + 1] ), b1 ) );
+	sum = simdAdd( sum, simdMul( simdSplat( a[4*i + 2] ), b2 ) );
+	sum = simdAdd( sum, simdMul( simdSplat( a[4*i + 3] ), b3 ) );
+	simdStore( c + 4*i, sum );
+    }
+#endif // ANGEL_SIMD_AVX
+}
+
+//  m * v: with the columns of m in registers, lane i of the result is
+//  m[i][0]*v.x + m[i][1]*v.y + m[i][2]*v.z + m[i][3]*v.w.
+inline simd4 simdMat4Transform( const GLfloat* m, const vec4& v ) {
+    simd4  c0 = simdLoad( m + 0 ), c1 = simdLoad( m + 4 ), c2 = simdLoad( m + 8 ), c3 = simdLoad( m + 12 );
+    simdTranspose( c0, c1, c2, c3 );
+
+    simd4  sum = simdMul( c0, simdSplat( v.x ) );
+    sum = simdAdd( sum, simdMul( c1, simdSplat( v.y ) ) );
+    sum = simdAdd( sum, simdMul( c2, simdSplat( v.z ) ) );
+    return simdAdd( sum, simdMul( c3, simdSplat( v.w ) ) );
+}
+
+//  t = the transpose of m (t may be m)
+inline void simdMat4Transpose( const GLfloat* m, GLfloat* t ) {
+    simd4  r0 = simdLoad( m + 0 ), r1 = simdLoad( m + 4 ), r2 = simdLoad( m + 8 ), r3 = simdLoad( m + 12 );
+    simdTranspose( r0, r1, r2, r3 );
+    simdStore( t + 0, r0 );  simdStore( t + 4, r1 );  simdStore( t + 8, r2 );  simdStore( t + 12, r3 );
+}
+
+#endif // ANGEL_SIMD
+
 //----------------------------------------------------------------------------
 //
 //  mat4.h - 4D square matrix
@@ -489,46 +569,35 @@ class mat4 {
     //  --- Constructors and Destructors ---
     //
 
-    mat4( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
-	{ _m[0].x = d;  _m[1].y = d;  _m[2].z = d;  _m[3].w = d; }
+    constexpr mat4( const GLfloat d = GLfloat(1.0) )  // Create a diagional matrix
+	: _m{ vec4( d, 0.0, 0.0, 0.0 ), vec4( 0.0, d, 0.0, 0.0 ),
+	      vec4( 0.0, 0.0, d, 0.0 ), vec4( 0.0, 0.0, 0.0, d ) } {}
 
-    mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d )
-	{ _m[0] = a;  _m[1] = b;  _m[2] = c;  _m[3] = d; }
+    constexpr mat4( const vec4& a, const vec4& b, const vec4& c, const vec4& d )
+	: _m{ a, b, c, d } {}
             //
            // YJC: a becomes the first row, b the 2nd row,
            //      c the 3rd row, d the 4th row.
 
-    mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
-	  GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
-	  GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
-	  GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 )
+    constexpr mat4( GLfloat m00, GLfloat m10, GLfloat m20, GLfloat m30,
+		    GLfloat m01, GLfloat m11, GLfloat m21, GLfloat m31,
+		    GLfloat m02, GLfloat m12, GLfloat m22, GLfloat m32,
+		    GLfloat m03, GLfloat m13, GLfloat m23, GLfloat m33 )
             //
             //YJC: These 16 items are given in *column order*,
             //     but the matrix is stored in *row order*.
             //
-	{
-	    _m[0] = vec4( m00, m01, m02, m03 );  //YJC: This is in row order:
-	    _m[1] = vec4( m10, m11, m12, m13 );  //     _m[0] is the first row,
-	    _m[2] = vec4( m20, m21, m22, m23 );  //     _m[1] the 2nd row, etc.
-	    _m[3] = vec4( m30, m31, m32, m33 );
-	}
-
-    mat4( const mat4& m )
-	{
-	    if ( *this != m ) {
-		_m[0] = m._m[0];
-		_m[1] = m._m[1];
-		_m[2] = m._m[2];
-		_m[3] = m._m[3];
-	    } 
-	}
+	: _m{ vec4( m00, m01, m02, m03 ),   //YJC: This is in row order:
+	      vec4( m10, m11, m12, m13 ),   //     _m[0] is the first row,
+	      vec4( m20, m21, m22, m23 ),   //     _m[1] the 2nd row, etc.
+	      vec4( m30, m31, m32, m33 ) } {}
 
     //
     //  --- Indexing Operator ---
     //
 
-    vec4& operator [] ( int i ) { return _m[i]; }
-    const vec4& operator [] ( int i ) const { return _m[i]; }
+    constexpr vec4& operator [] ( int i ) { return _m[i]; }
+    constexpr const vec4& operator [] ( int i ) const { return _m[i]; }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
@@ -562,6 +631,9 @@ class mat4 {
     mat4 operator * ( const mat4& m ) const {
 	mat4  a( 0.0 );
 
+#ifdef ANGEL_SIMD
+	simdMat4Multiply( *this, m, a );
+#else
 	for ( int i = 0; i < 4; ++i ) {
 	    for ( int j = 0; j < 4; ++j ) {
 		for ( int k = 0; k < 4; ++k ) {
@@ -569,6 +641,7 @@ class mat4 {
 		}
 	    }
 	}
+#endif // ANGEL_SIMD
 
 	return a;
     }
@@ -595,6 +668,9 @@ class mat4 {
     mat4& operator *= ( const mat4& m ) {
 	mat4  a( 0.0 );
 
+#ifdef ANGEL_SIMD
+	simdMat4Multiply( *this, m, a );
+#else
 	for ( int i = 0; i < 4; ++i ) {
 	    for ( int j = 0; j < 4; ++j ) {
 		for ( int k = 0; k < 4; ++k ) {
@@ -602,6 +678,7 @@ class mat4 {
 		}
 	    }
 	}
+#endif // ANGEL_SIMD
 
 	return *this = a;
     }
@@ -624,11 +701,15 @@ class mat4 {
     //
 
     vec4 operator * ( const vec4& v ) const {  // m * v
+#ifdef ANGEL_SIMD
+	return vec4( simdMat4Transform( *this, v ) );
+#else
 	return vec4( _m[0][0]*v.x + _m[0][1]*v.y + _m[0][2]*v.z + _m[0][3]*v.w,
 		     _m[1][0]*v.x + _m[1][1]*v.y + _m[1][2]*v.z + _m[1][3]*v.w,
 		     _m[2][0]*v.x + _m[2][1]*v.y + _m[2][2]*v.z + _m[2][3]*v.w,
 		     _m[3][0]*v.x + _m[3][1]*v.y + _m[3][2]*v.z + _m[3][3]*v.w
 	    );
+#endif // ANGEL_SIMD
     }
 	
     //
@@ -685,12 +766,18 @@ mat4 transpose( const mat4& A ) {
 //          In particular this is to be used in the function Rotate().
 inline
 mat4 transpose1( const mat4& A ) {
+#ifdef ANGEL_SIMD
+    mat4  T;
+    simdMat4Transpose( A, T );
+    return T;
+#else
     return mat4( A[0][0], A[0][1], A[0][2], A[0][3],
 		 A[1][0], A[1][1], A[1][2], A[1][3],
 		 A[2][0], A[2][1], A[2][2], A[2][3],
 		 A[3][0], A[3][1], A[3][2], A[3][3] ); //YJC: Important!!
                                                        //     The 16 items must be given in *column order*,
                                                        //     so in this way we get the transpose.
+#endif // ANGEL_SIMD
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -970,6 +1057,22 @@ mat3 NormalMatrix( const mat4& mv, int non_uniform_scale_flag ) {
     return transpose1( inverse(m) );
 }
 
+//----------------------------------------------------------------------------
+// NormalMatrix(mv, kind): the Normal Matrix of a model-view mv of the given
+// kind (see TransformKind), with the closed forms for the special kinds:
+// transpose1(inverse(R)) = R, and transpose1(inverse(s R)) = s R / s^2.
+//
+inline
+mat3 NormalMatrix( const mat4& mv, TransformKind kind ) {
+  mat3 m = upperLeftMat3( mv );
+
+  if (kind == TransformRigid)
+    return m;
+  if (kind == TransformUniformScale)
+    return m / dot(m[0], m[0]);
+  return transpose1( inverse(m) );
+}
+
 // YJC: Added the following:
 //      mat4WithUpperLeftMat3(m)
 //
@@ -987,6 +1090,101 @@ mat4 mat4WithUpperLeftMat3( const mat3& m){
                vec4(    0.0,     0.0,     0.0, 1.0) );
 }
 
+//----------------------------------------------------------------------------
+// inverse(m, kind, invertible): return the inverse of the given 4x4 matrix m
+// of the given kind (see TransformKind).
+//
+//   For the affine kinds m = [A t; 0 1], and the inverse is [A^-1  -A^-1 t; 0 1]
+//   with the closed forms of inverse(mat3) for A^-1. A projective m is
+//   inverted with the cofactors of its 2x2 minors.
+//
+//   If the determinant of m is too close to 0, the identity is returned and
+//   *invertible (if given) is set to false, for the caller to decide what to
+//   do; otherwise *invertible is set to true.
+//
+inline
+mat4 inverse( const mat4& m, TransformKind kind = TransformProjective, bool* invertible = NULL ) {
+  if (invertible)
+    *invertible = true;
+
+  if (kind != TransformProjective) {
+    float a[3][3];
+    if (kind == TransformAffine) { // the cofactors, as in inverse(mat3)
+      a[0][0] =  (m[1][1] * m[2][2] - m[1][2] * m[2][1]);
+      a[1][0] = -(m[1][0] * m[2][2] - m[1][2] * m[2][0]);
+      a[2][0] =  (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+      float det = m[0][0] * a[0][0] + m[0][1] * a[1][0] + m[0][2] * a[2][0];
+      if (std::abs(det) < (1e-8) * (1e-8))
+        { if (invertible) *invertible = false;
+          return mat4();
+        }
+      float r = 1.0f / det;
+
+      a[0][0] *= r;  a[1][0] *= r;  a[2][0] *= r;
+      a[0][1] = -(m[0][1] * m[2][2] - m[0][2] * m[2][1]) * r;
+      a[1][1] =  (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * r;
+      a[2][1] = -(m[0][0] * m[2][1] - m[0][1] * m[2][0]) * r;
+      a[0][2] =  (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * r;
+      a[1][2] = -(m[0][0] * m[1][2] - m[0][2] * m[1][0]) * r;
+      a[2][2] =  (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * r;
+    }
+    else { // A^-1 = A^T / s^2 (s = 1 for a rigid m)
+      float r2 = (kind == TransformRigid) ? 1.0f
+               : 1.0f / (m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2]);
+      for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+          a[r][c] = m[c][r] * r2;
+    }
+
+    const float tx = m[0][3], ty = m[1][3], tz = m[2][3];
+    return mat4( vec4(a[0][0], a[0][1], a[0][2], -(a[0][0] * tx + a[0][1] * ty + a[0][2] * tz)),
+                 vec4(a[1][0], a[1][1], a[1][2], -(a[1][0] * tx + a[1][1] * ty + a[1][2] * tz)),
+                 vec4(a[2][0], a[2][1], a[2][2], -(a[2][0] * tx + a[2][1] * ty + a[2][2] * tz)),
+                 vec4(    0.0,     0.0,     0.0,  1.0) );
+  }
+
+  // The 2x2 minors of the top two rows (s) and of the bottom two rows (c)
+  float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+  float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+  float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+  float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+  float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+  float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+  float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+  float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+  float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+  float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+  float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+  float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+  float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+  // check if non-singular matrix
+  if (std::abs(det) < (1e-8) * (1e-8))
+    { if (invertible) *invertible = false;
+      return mat4();
+    }
+  float r = 1.0f / det;
+
+  return mat4( vec4( ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * r,
+                     (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * r,
+                     ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * r,
+                     (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * r ),
+               vec4( (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * r,
+                     ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * r,
+                     (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * r,
+                     ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * r ),
+               vec4( ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * r,
+                     (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * r,
+                     ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * r,
+                     (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * r ),
+               vec4( (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * r,
+                     ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * r,
+                     (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * r,
+                     ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * r ) );
+}
+
 //----------------------------------------------------------------------------
 
 inline
@@ -1021,6 +1219,20 @@ mat4 identity()
     return c;
 }
 
+//----------------------------------------------------------------------------
+//
+//  Layout: the matrices are trivially copyable, with their entries as the
+//  first GLfloats in row order (standard layout puts _m at offset 0), so
+//  the GLfloat* conversion can be passed to glUniformMatrix*fv() and the
+//  entries loaded into SIMD registers.
+//
+
+static_assert( std::is_trivially_copyable<mat2>::value && std::is_standard_layout<mat2>::value &&
+	       sizeof(mat2) == 4 * sizeof(GLfloat), "mat2 must be 4 packed GLfloats" );
+static_assert( std::is_trivially_copyable<mat3>::value && std::is_standard_layout<mat3>::value &&
+	       sizeof(mat3) == 9 * sizeof(GLfloat), "mat3 must be 9 packed GLfloats" );
+static_assert( std::is_trivially_copyable<mat4>::value && std::is_standard_layout<mat4>::value &&
+	       sizeof(mat4) == 16 * sizeof(GLfloat), "mat4 must be 16 packed GLfloats" );
 
 }  // namespace Angel
 
@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- quat.h ---
+//
+//   Unit quaternions for accumulating rotations (e.g. a rolling object's
+//   orientation). Composing two rotations costs 16 multiplies instead of
+//   the 64 of a mat4 product. Drift off unit length is removed with
+//   renormalize() (no square root), which keeps the rotation exactly
+//   orthonormal up to float rounding, however many rotations are
+//   accumulated. Rotate(q) converts to a mat4 in the row order of
+//   "mat-yjc-new.h" for upload.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ANGEL_QUAT_H__
+#define __ANGEL_QUAT_H__
+
+#include "Angel-yjc.h"
+
+namespace Angel {
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  quat - quaternion x i + y j + z k + w (w is the scalar part)
+//
+
+struct quat {
+
+    GLfloat  x;
+    GLfloat  y;
+    GLfloat  z;
+    GLfloat  w;
+
+    //
+    //  --- Constructors and Destructors ---
+    //
+
+    constexpr quat() :		// the identity rotation
+	x(0.0), y(0.0), z(0.0), w(1.0) {}
+
+    constexpr quat( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
+	x(x), y(y), z(z), w(w) {}
+
+    constexpr quat( const vec3& v, const GLfloat w ) :
+	x(v.x), y(v.y), z(v.z), w(w) {}
+
+    //
+    //  --- Arithmetic Operators ---
+    //
+
+    //  Hamilton product: (p * q) rotates by q first, then by p (as mat4 P * Q)
+    constexpr quat operator * ( const quat& q ) const
+	{ return quat( w*q.x + x*q.w + y*q.z - z*q.y,
+		       w*q.y - x*q.z + y*q.w + z*q.x,
+		       w*q.z + x*q.y - y*q.x + z*q.w,
+		       w*q.w - x*q.x - y*q.y - z*q.z ); }
+
+    constexpr quat operator * ( const GLfloat s ) const
+	{ return quat( s*x, s*y, s*z, s*w ); }
+
+    friend constexpr quat operator * ( const GLfloat s, const quat& q )
+	{ return q * s; }
+
+    quat& operator *= ( const quat& q )
+	{ *this = *this * q;  return *this; }
+
+    //
+    //  --- Insertion and Extraction Operators ---
+    //
+
+    friend std::ostream& operator << ( std::ostream& os, const quat& q ) {
+	return os << "( " << q.x << ", " << q.y << ", " << q.z << ", " << q.w << " )";
+    }
+};
+
+//----------------------------------------------------------------------------
+//
+//  Non-class quat Methods
+//
+
+constexpr
+GLfloat dot( const quat& p, const quat& q ) {
+    return p.x*q.x + p.y*q.y + p.z*q.z + p.w*q.w;
+}
+
+inline
+GLfloat length( const quat& q ) {
+    return std::sqrt( dot(q,q) );
+}
+
+inline
+quat normalize( const quat& q ) {
+    return q * (GLfloat(1.0) / length(q));
+}
+
+//  The inverse rotation of a unit quaternion
+constexpr
+quat conjugate( const quat& q ) {
+    return quat( -q.x, -q.y, -q.z, q.w );
+}
+
+//  Renormalizes a quaternion that is already close to unit length (as after
+//  a product of unit quaternions): one Newton step of 1/sqrt(dot(q,q)) at 1,
+//  which squares the length error, without a square root or a division.
+constexpr
+quat renormalize( const quat& q ) {
+    return q * (GLfloat(0.5) * (GLfloat(3.0) - dot(q,q)));
+}
+
+//----------------------------------------------------------------------------
+//
+//  Rotation quaternion generators
+//
+
+//  The rotation by angle degrees about the axis (x, y, z) of any length,
+//  as Rotate(angle, x, y, z) in "mat-yjc-new.h"
+inline
+quat Quaternion( const GLfloat angle, const GLfloat x, const GLfloat y, const GLfloat z )
+{
+    GLfloat len = std::sqrt( x*x + y*y + z*z );
+    if ( len < 0.00001 ) {
+	printf("Error! Rotation axis vector is too close to (0,0,0)\n");
+	exit(-1);
+    }
+
+    GLfloat half = GLfloat(0.5) * DegreesToRadians * angle;
+    GLfloat s = sinf( half ) / len;
+    return quat( s*x, s*y, s*z, cosf( half ) );
+}
+
+//  The rotation matrix of a unit quaternion, in row order
+inline
+mat4 Rotate( const quat& q )
+{
+    const GLfloat  x2 = q.x + q.x,  y2 = q.y + q.y,  z2 = q.z + q.z;
+    const GLfloat  xx = q.x * x2,  yy = q.y * y2,  zz = q.z * z2;
+    const GLfloat  xy = q.x * y2,  xz = q.x * z2,  yz = q.y * z2;
+    const GLfloat  wx = q.w * x2,  wy = q.w * y2,  wz = q.w * z2;
+
+    return mat4( vec4( 1.0f - (yy + zz), xy - wz, xz + wy, 0.0 ),
+		 vec4( xy + wz, 1.0f - (xx + zz), yz - wx, 0.0 ),
+		 vec4( xz - wy, yz + wx, 1.0f - (xx + yy), 0.0 ),
+		 vec4( 0.0, 0.0, 0.0, 1.0 ) );
+}
+
+static_assert( std::is_trivially_copyable<quat>::value && sizeof(quat) == 4 * sizeof(GLfloat),
+	       "quat must be 4 packed GLfloats" );
+
+}  // namespace Angel
+
+#endif // __ANGEL_QUAT_H__
@@ -23,10 +23,19 @@
 **************************************************************/
 
 #include "Angel-yjc.h"
+#include "sphere-mesh.h"
+#include "gl-state-cache.h"
+#include "vertex-format.h"
+#include "shader-variants.h"
 #include "texmap.c"
 #include <iostream>
 #include <fstream>
+#include <cstring>
 #include <vector>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -35,8 +44,6 @@ typedef Angel::vec4  point4;
 typedef Angel::vec3  point3;
  
 GLuint Angel::InitShader(const char* vShaderFile, const char* fShaderFile);
-void setupLightingUniformVars(mat4 mv);
-mat4 computeShadowMatrix(vec4 light_position);
 
 enum MenuOptions {
     MENU_RESET,
@@ -65,8 +72,194 @@ enum MenuOptions {
     MENU_FIREWORKS_NO,
 };
 
-GLuint program, fireworks_program;       /* shader program object id */
-GLuint sphere_smooth_buffer, sphere_flat_buffer, plane_buffer, axes_buffer, fireworks_buffer; /* vertex buffer object ids for sphere, plane, axes, fireworks*/
+GLuint plane_buffer, axes_buffer, fireworks_buffer; /* vertex buffer object ids for plane, axes, fireworks (the sphere's are in sphere_lods) */
+GLuint plane_vao, axes_vao, fireworks_vao;          /* their vertex array objects, set up once in init() */
+VertexFormat plane_format;                          /* vertex format of the plane buffer (see interleaved_vertices) */
+
+// Uniforms and attributes of the variants of programs (vshader53.glsl / fshader53.glsl),
+// indexing the locations InitShader() looks up once at link time
+enum Uniforms {
+    UNIFORM_PROJECTION,
+    UNIFORM_TEXTURE_1D,
+    UNIFORM_TEXTURE_2D,
+    NUM_UNIFORMS
+};
+
+const char* const uniform_names[] = { "Projection", "Texture_1D", "Texture_2D" };
+
+// Uniform blocks of the variants of programs, indexing their uniform buffer binding points (see BindUniformBlocks())
+enum UniformBlocks {
+    BLOCK_LIGHTING,  // frame constant (setupLightingBlock())
+    BLOCK_FOG,       // frame constant (setupFogBlock())
+    BLOCK_OBJECT,    // one range per draw (setupObjectBlock())
+    NUM_UNIFORM_BLOCKS
+};
+
+const char* const uniform_block_names[] = { "Lighting", "Fog", "Object" };
+
+// Objects drawn with programs, each with its own range of the Object uniform buffer
+enum Objects {
+    OBJECT_X_AXIS,
+    OBJECT_Y_AXIS,
+    OBJECT_Z_AXIS,
+    OBJECT_PLANE,
+    OBJECT_SHADOW,
+    OBJECT_SPHERE,
+    NUM_OBJECTS
+};
+
+enum Attributes {
+    ATTRIBUTE_POSITION,
+    ATTRIBUTE_NORMAL,
+    ATTRIBUTE_TEX_COORD,
+    NUM_ATTRIBUTES
+};
+
+const char* const attribute_names[] = { "vPosition", "vNormal", "vTexCoord" };
+
+// Options vshader53.glsl / fshader53.glsl are specialized on (see shader-variants.h),
+// indexing the option values of a draw (see useProgramVariant())
+enum ShaderOptions {
+    OPTION_LIGHTING,
+    OPTION_WIREFRAME,
+    OPTION_FLAT_SHADING,        // lit with the face normals, per fragment
+    OPTION_SPOTLIGHT,
+    OPTION_UNLIT_COLOR,         // 0: material diffuse, 1: shadow, 2: wireframe
+    OPTION_BLENDING_SHADOW,
+    OPTION_LATTICE,
+    OPTION_GROUND_TEXTURE,
+    OPTION_SPHERE_TEXTURE,      // texture_mapped_sphere_flag
+    OPTION_FOG_TYPE,            // fog_type
+    OPTION_QUANTIZED_POSITION,  // QuantizedPoint positions (see sphere-mesh.h)
+    OPTION_OCTAHEDRAL_NORMAL,   // OctahedralNormal normals
+    NUM_SHADER_OPTIONS
+};
+
+const ShaderOption shader_options[] = {
+    { "LIGHTING", 2 }, { "WIREFRAME", 2 }, { "FLAT_SHADING", 2 }, { "SPOTLIGHT", 2 },
+    { "UNLIT_COLOR", 3 }, { "BLENDING_SHADOW", 2 }, { "LATTICE", 2 }, { "GROUND_TEXTURE", 2 },
+    { "SPHERE_TEXTURE", 3 }, { "FOG_TYPE", 4 }, { "QUANTIZED_POSITION", 2 }, { "OCTAHEDRAL_NORMAL", 2 }
+};
+
+// Uniforms and attributes of fireworks_program (fireworksVShader.glsl / fireworksFShader.glsl)
+enum FireworksUniforms {
+    FIREWORKS_UNIFORM_MODEL_VIEW,
+    FIREWORKS_UNIFORM_PROJECTION,
+    FIREWORKS_UNIFORM_START_POS,
+    FIREWORKS_UNIFORM_CURRENT_TIME,
+    NUM_FIREWORKS_UNIFORMS
+};
+
+const char* const fireworks_uniform_names[] = { "ModelView", "Projection", "StartPos", "CurrentTime" };
+
+enum FireworksAttributes {
+    FIREWORKS_ATTRIBUTE_VELOCITY,
+    FIREWORKS_ATTRIBUTE_COLOR,
+    NUM_FIREWORKS_ATTRIBUTES
+};
+
+const char* const fireworks_attribute_names[] = { "vVelocity", "vColor" };
+
+static_assert(sizeof(uniform_names) / sizeof(uniform_names[0]) == NUM_UNIFORMS &&
+              sizeof(attribute_names) / sizeof(attribute_names[0]) == NUM_ATTRIBUTES &&
+              sizeof(fireworks_uniform_names) / sizeof(fireworks_uniform_names[0]) == NUM_FIREWORKS_UNIFORMS &&
+              sizeof(fireworks_attribute_names) / sizeof(fireworks_attribute_names[0]) == NUM_FIREWORKS_ATTRIBUTES &&
+              sizeof(uniform_block_names) / sizeof(uniform_block_names[0]) == NUM_UNIFORM_BLOCKS &&
+              sizeof(shader_options) / sizeof(shader_options[0]) == NUM_SHADER_OPTIONS,
+              "a name is missing for a uniform, attribute, uniform block or shader option enum");
+
+// The shader programs of vshader53.glsl / fshader53.glsl, one per combination of the
+// shader_options drawn with, compiled on first use (see useProgramVariant())
+void setupProgramVariant(const ShaderProgram<NUM_UNIFORMS, NUM_ATTRIBUTES>& program);
+ShaderVariants<NUM_UNIFORMS, NUM_ATTRIBUTES> programs("vshader53.glsl", "fshader53.glsl", uniform_names,
+                                                      attribute_names, shader_options, setupProgramVariant);
+vector<unsigned> program_variants_reported(1, ~0u);  // variants of the frame last reported by display()
+ShaderProgram<NUM_FIREWORKS_UNIFORMS, NUM_FIREWORKS_ATTRIBUTES> fireworks_program;
+
+// GL state set by the program, with the calls that would not change it dropped (see gl-state-cache.h);
+// the calls of each frame are reported by display()
+GLStateCache gl_state;
+GLStateCounts gl_state_reported = { -1, -1 };
+
+// The uniform blocks of vshader53.glsl / fshader53.glsl in their std140 layout: vec4 and
+// matrix rows (row_major) take 16 bytes, a vec3 is followed by a float in its fourth
+// component, and bool is a 4-byte GLint. All padding is explicit, so that blocks can be
+// compared with memcmp(). The flags the shaders branched on are options of their
+// variants instead (see shader_options).
+struct LightingBlock {   // frame constant, in the eye frame
+    vec4     global_ambient;
+    vec4     light_direction, dir_light_ambient, dir_light_diffuse, dir_light_specular;
+    vec4     light_position, light_ambient, light_diffuse, light_specular;
+    vec3     spotlight_direction;
+    GLfloat  spotlight_exponent;
+    GLfloat  spotlight_cutoff;
+    GLfloat  const_att, linear_att, quad_att;
+};
+
+struct FogBlock {
+    vec4     fog_color;
+    GLfloat  fog_start, fog_end, fog_density;
+    GLint    padding;
+};
+
+struct ObjectBlock {     // per draw
+    vec4     model_view[4];     // rows
+    vec4     normal_matrix[3];  // rows, w unused
+    vec4     material_ambient, material_diffuse, material_specular;
+    GLfloat  shininess;
+    GLfloat  position_scale;
+    GLint    is_eye_space, sphere_mapping_mode, lattice_mapping_mode;
+    GLint    padding[3];
+};
+
+static_assert(offsetof(LightingBlock, spotlight_direction) == 144 && offsetof(LightingBlock, spotlight_exponent) == 156 &&
+              offsetof(LightingBlock, quad_att) == 172 && sizeof(LightingBlock) == 176, "LightingBlock is not std140");
+static_assert(offsetof(FogBlock, fog_start) == 16 && sizeof(FogBlock) == 32, "FogBlock is not std140");
+static_assert(offsetof(ObjectBlock, normal_matrix) == 64 && offsetof(ObjectBlock, material_ambient) == 112 &&
+              offsetof(ObjectBlock, shininess) == 160 && offsetof(ObjectBlock, lattice_mapping_mode) == 176 &&
+              sizeof(ObjectBlock) == 192, "ObjectBlock is not std140");
+
+// UniformBlockBuffer - a uniform buffer of count Blocks, each at an offset aligned to
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, with a copy of the contents last uploaded to each,
+// so that a block is uploaded only when its contents change
+template <class Block>
+struct UniformBlockBuffer {
+    GLuint         buffer;
+    GLintptr       stride;    // bytes from one block to the next
+    vector<Block>  uploaded;
+    vector<bool>   valid;     // uploaded[i] holds the contents of block i
+
+    void create(int count) {
+        GLint alignment;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        stride = (sizeof(Block) + alignment - 1) / alignment * alignment;
+        uploaded.resize(count);
+        valid.assign(count, false);
+
+        glGenBuffers(1, &buffer);
+        gl_state.bindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, stride * count, NULL, GL_DYNAMIC_DRAW);
+    }
+
+    // Uploads block i, unless it already holds these contents
+    void update(int i, const Block& block) {
+        if (valid[i] && memcmp(&uploaded[i], &block, sizeof(Block)) == 0)
+            return;
+        gl_state.bindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, stride * i, sizeof(Block), &block);
+        uploaded[i] = block;
+        valid[i] = true;
+    }
+
+    // Binds block i to binding point
+    void bind(GLuint binding, int i) const {
+        gl_state.bindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, stride * i, sizeof(Block));
+    }
+};
+
+UniformBlockBuffer<LightingBlock>  lighting_buffer;
+UniformBlockBuffer<FogBlock>       fog_buffer;
+UniformBlockBuffer<ObjectBlock>    object_buffer;   // NUM_OBJECTS blocks
 
 // Projection transformation parameters
 GLfloat  fovy = 45.0;  // Field-of-view in Y direction angle (in degrees)
@@ -120,18 +313,97 @@ GLfloat speed = 0.02f;  // Adjust speed to match rolling effect; 0.02f is ideal.
 point4 position = positions[0];  // Start at point A
 vec4 direction; // Direction of the sphere rolling
 vec4 rotation_axis; // Rotation axis vector of the sphere roling
-mat4 M = mat4(1.0f); // Accumulated matrix M for the rotation of the Sphere
-mat4 R; // Rotation matrix of the Sphere
+quat Q; // Accumulated rotation of the Sphere, as a unit quaternion (updated in idle())
+affine3x4 sphere_model; // Translate(position) * R * M of the Sphere (R: this frame's rotation while rolling, M: Q), set up once per frame in display()
+
+// Welded (indexed) smooth sphere: shared vertices closer than this are stored once
+const GLfloat sphere_weld_epsilon = 1.0e-5f;
+
+// Spheres of at least this many triangles are streamed into the VBOs with bounded memory (see loadSphereWorker())
+const int sphere_stream_min_triangles = 1000000;
+
+// Store the sphere buffers with quantized vertices (QuantizedPoint and OctahedralNormal, 10 bytes per vertex
+// planar, 12 interleaved) instead of point4 and vec3 (28 bytes per vertex); vshader53.glsl decodes them
+const bool sphere_quantized_vertices = true;
+
+// Store the sphere and plane buffers interleaved (all attributes of a vertex next to each other)
+// instead of planar (all positions, then all normals, ...), so that a vertex fetch reads one run of memory
+const bool interleaved_vertices = true;
+
+// Directory of the linked shader programs (see SetProgramCache()), so that later runs load them instead of
+// compiling them; NULL to compile them in every run
+const char* const program_cache_directory = "shader-cache";
+
+// SphereBuffers - the vertex (and index) buffers of one sphere, with the counts needed to draw it.
+// Both shading modes draw the same buffer, with its smooth normals: flat shading takes the face
+// normals from the derivatives of the eye position instead (see fshader53.glsl).
+struct SphereBuffers {
+    GLuint   vertex_buffer, index_buffer;  // index_buffer is 0 if the sphere is not welded
+    GLuint   vao;                          // vertex array of vertex_buffer (and index_buffer)
+    GLenum   index_type;
+    int      num_vertices;         // vertices of the triangle soup = indices of the welded sphere
+    int      num_unique_vertices;  // vertices of vertex_buffer
+    GLfloat  radius;
+    GLfloat  position_scale;       // QuantizedPoint positions scaled by this (the radius), or 0 for point4 positions
+    bool     octahedral_normals;   // OctahedralNormal normals, or vec3
+    VertexFormat  format;          // of vertex_buffer (see setSphereVertexFormat())
+};
 
-// Sphere vertices data for points and normals
-vector<point4> sphere_points;
-vector<vec3> sphere_smooth_normals;
-vector<vec3> sphere_flat_normals;
+// Sphere currently drawn: its level-of-detail chain, coarsest level first, the last level being the
+// loaded sphere (a single low-resolution placeholder until the sphere file is loaded, see startSphereLoad())
+vector<SphereBuffers> sphere_lods;
+int sphere_lod = 0;                             // level drawn in the current frame (see selectSphereLod())
+int sphere_lod_reported = -1;                   // level last reported by display()
+const int sphere_lod_max_level = 6;             // coarser levels: icospheres of 20 * 4^level (at most 81920) triangles
+const GLfloat sphere_lod_pixels_per_triangle = 4.0f;  // screen area (in pixels) a visible triangle should cover
+const GLfloat sphere_lod_hysteresis = 0.25f;    // margin before switching to a coarser level, to avoid flicker
+int sphere_vertices_per_frame = 0;              // sphere vertices processed (by the vertex shader) in the current frame
+int window_height = 512;                        // viewport height in pixels, for the projected radius of the sphere
+
+// StagedChunk - a copy of a streamed SphereMeshChunk waiting for its upload on the GL thread
+struct StagedChunk {
+    int             first_triangle;
+    int             triangle_count;
+    vector<point4>  points;
+    vector<vec3>    smooth_normals;
+};
+
+// SphereLoad - the state of the sphere file being loaded on a worker thread
+struct SphereLoad {
+    string              file_name;
+    bool                streamed;        // streamed in chunks (large files), or loaded whole and welded
+    thread              worker;
+
+    mutex               lock;            // guards the fields up to "stopped"
+    condition_variable  chunk_taken;     // signalled when the GL thread has taken the queued chunks (or stops the load)
+    int                 triangle_count;  // streamed: -1 until known
+    deque<StagedChunk>  chunks;          // streamed: chunks waiting for their upload
+    bool                done;
+    bool                ok;
+    bool                stopped;         // set by stopSphereLoad(): the worker gives up as soon as it can
+
+    SphereMesh          mesh;            // loaded whole: the sphere and its welded smooth sphere
+    WeldedSphereMesh    welded;
+    SphereBuffers       buffers;         // the buffers being filled (swapped in once complete)
+
+    vector<SphereMesh>        lod_meshes;   // the coarser levels of detail and their welded smooth spheres
+    vector<WeldedSphereMesh>  lod_welded;
+};
+
+SphereLoad* sphere_load = NULL;              // NULL once the sphere file is loaded
+const int sphere_placeholder_level = 1;      // icosphere of 80 triangles drawn meanwhile
+const size_t sphere_load_max_chunks = 4;     // streamed chunks the worker may queue ahead of the uploads
+const int sphere_load_poll_interval = 1;     // ms between the GL thread's checks of the worker
+
+// Startup latency (ms since the sphere file name was entered), reported by display()
+int t_sphere_load_start = 0;
+bool report_full_quality = false;
+bool first_frame_reported = false;
 
 // Sets up the axes' vertices points and colors with the corresponding data
 const int axes_num_vertices = 6;
 
-point4 axes_points[axes_num_vertices] = {
+constexpr point4 axes_points[axes_num_vertices] = {
     point4(0.0f, 0.02f, 0.0f, 1.0f),
     point4(5.0f, 0.02f, 0.0f, 1.0f),  // X-axis
     point4(0.0f, 0.0f, 0.0f, 1.0f),
@@ -141,7 +413,7 @@ point4 axes_points[axes_num_vertices] = {
 };
 
 // Disable Lighting when you draw it, Use dummy unit vectors since we are disabling lighting and it doesnt matter
-vec3 axes_normals[axes_num_vertices] = {
+constexpr vec3 axes_normals[axes_num_vertices] = {
     vec3(0.0f, 1.0f, 0.0f),
     vec3(0.0f, 1.0f, 0.0f),
     vec3(0.0f, 1.0f, 0.0f),
@@ -154,7 +426,7 @@ vec3 axes_normals[axes_num_vertices] = {
 // Sets up the plane's vertices points and colors with the corresponding data
 const int plane_num_vertices = 6;
 
-point4 plane_points[plane_num_vertices] = {
+constexpr point4 plane_points[plane_num_vertices] = {
     point4(105.0f, 0.0f, 108.0f, 1.0f),
     point4(105.0f, 0.0f, -104.0f, 1.0f),
     point4(-105.0f, 0.0f, -104.0f, 1.0f),
@@ -163,7 +435,7 @@ point4 plane_points[plane_num_vertices] = {
     point4(105.0f, 0.0f, 108.0f, 1.0f)
 };
 
-vec3 plane_normals[plane_num_vertices] = {
+constexpr vec3 plane_normals[plane_num_vertices] = {
     vec3(0.0f, 1.0f, 0.0f),
     vec3(0.0f, 1.0f, 0.0f),
     vec3(0.0f, 1.0f, 0.0f),
@@ -172,7 +444,7 @@ vec3 plane_normals[plane_num_vertices] = {
     vec3(0.0f, 1.0f, 0.0f),
 };
 
-vec2 plane_tex_coords[6] = {
+constexpr vec2 plane_tex_coords[6] = {
   vec2(6.0f, 5.0f),  // for a
   vec2(6.0f, 0.0f),  // for b
   vec2(0.0f, 0.0f),  // for c
@@ -185,7 +457,7 @@ vec2 plane_tex_coords[6] = {
 /*----- Shader Lighting Parameters -----*/
 color4 global_ambient = color4(1.0f, 1.0f, 1.0f, 1.0f);
 
-point4 init_light_position(-14.0f, 12.0f, -3.0f, 1.0f);
+constexpr point4 init_light_position(-14.0f, 12.0f, -3.0f, 1.0f);
 
 // In World frame.
 // Needs to transform it to Eye Frame
@@ -219,7 +491,21 @@ float  material_shininess = 0.0f;
 
 mat3 normal_matrix;
 
-mat4 N = computeShadowMatrix(init_light_position);
+//----------------------------------------------------------------------
+// computeShadowMatrix(light_position):
+// Set up shadow matrix based on light_position in world frame.
+// constexpr, so that N below is built at compile time.
+//----------------------------------------------------------------------
+constexpr mat4 computeShadowMatrix(const vec4& light_position) {
+    return mat4(
+        vec4(light_position.y, -light_position.x, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.0f, -light_position.z, light_position.y, 0.0f),
+        vec4(0.0f, -1.0f, 0.0f, light_position.y)
+    );
+}
+
+constexpr mat4 N = computeShadowMatrix(init_light_position);
 
 int previous_lighting_flag = lighting_flag;
 int previous_wireframe_flag = wireframe_flag;
@@ -250,6 +536,7 @@ float t_max = 4.0f;
 /*---  Set up and pass on Model-View matrix to the shader ---*/
     // eye is a global variable of vec4 set to init_eye and updated by keyboard()
 mat4 mv;
+affine3x4 view; // LookAt(eye, at, up), set up once per frame in display(); converted to mat4 only for upload
 vec4 at(0.0f, 0.0f, 0.0f, 1.0f);
 vec4 up(0.0f, 1.0f, 0.0f, 0.0f);
 
@@ -258,186 +545,155 @@ mat4 p;
 
 
 //----------------------------------------------------------------------
-// computeShadowMatrix(vec4 light_position):
-// Set up shadow matrix based on light_position in world frame.
-//----------------------------------------------------------------------
-mat4 computeShadowMatrix(vec4 light_position) {
-    return mat4(
-        vec4(light_position.y, -light_position.x, 0.0f, 0.0f),
-        vec4(0.0f, 0.0f, 0.0f, 0.0f),
-        vec4(0.0f, -light_position.z, light_position.y, 0.0f),
-        vec4(0.0f, -1.0f, 0.0f, light_position.y)
-    );
-}
-
-//----------------------------------------------------------------------
-// setupLightingUniformVars(mat4 mv):
-// Set up lighting parameters that are uniform variables in shader.
+// setupLightingBlock():
+// Set up the Lighting uniform block for the current frame, with the
+// positional light and the spotlight transformed to the eye frame by view.
 //
-// Note: "LightPosition" and "SpotlightDirection" in shader must be in the Eye Frame.
-//       So we use parameter "mv", the model-view matrix, to transform
-//       light_position and spotlight_direction to the Eye Frame.
 //----------------------------------------------------------------------
-void setupLightingUniformVars(mat4 mv)
+void setupLightingBlock()
 {
-    glUniform4fv(glGetUniformLocation(program, "GlobalAmbient"),
-        1, global_ambient);
+    if (light_source_flag == 1) {
+        light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f);  // Positional Light Set
+        light_diffuse = color4(1.0f, 1.0f, 1.0f, 1.0f);
+        light_specular = color4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    else {
+        light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f); // Positional Light Removed
+        light_diffuse = color4(0.0f, 0.0f, 0.0f, 1.0f);
+        light_specular = color4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
 
-    // The Light Position needs to be in Eye Frame
-    vec4 light_position_eyeFrame = mv * light_position;
-    glUniform4fv(glGetUniformLocation(program, "LightPosition"), 1, light_position_eyeFrame);
+    mat4 eye_frame = view;
 
-    glUniform4fv(glGetUniformLocation(program, "LightAmbient"),
-        1, light_ambient);
-    glUniform4fv(glGetUniformLocation(program, "LightDiffuse"),
-        1, light_diffuse);
-    glUniform4fv(glGetUniformLocation(program, "LightSpecular"),
-        1, light_specular);
+    LightingBlock block;
+    block.global_ambient = global_ambient;
 
     // The Light Direction already in Eye Frame
-    glUniform4fv(glGetUniformLocation(program, "LightDirection"), 1, light_direction); 
-    glUniform4fv(glGetUniformLocation(program, "DirLightAmbient"), 1, dir_light_ambient);
-    glUniform4fv(glGetUniformLocation(program, "DirLightDiffuse"), 1, dir_light_diffuse);
-    glUniform4fv(glGetUniformLocation(program, "DirLightSpecular"), 1, dir_light_specular);
-
-    glUniform4fv(glGetUniformLocation(program, "MaterialAmbient"),
-        1, material_ambient);
-    glUniform4fv(glGetUniformLocation(program, "MaterialDiffuse"),
-        1, material_diffuse);
-    glUniform4fv(glGetUniformLocation(program, "MaterialSpecular"),
-        1, material_specular);
-
-    glUniformMatrix3fv(glGetUniformLocation(program, "NormalMatrix"),
-        1, GL_TRUE, normal_matrix);
-
-    glUniform1i(glGetUniformLocation(program, "IsAxesEnabled"), axes_flag);
-    glUniform1i(glGetUniformLocation(program, "IsPlaneEnabled"), plane_flag);
-    glUniform1i(glGetUniformLocation(program, "IsWireframeEnabled"), wireframe_flag);
-    glUniform1i(glGetUniformLocation(program, "IsShadowEnabled"), shadow_flag);
-    glUniform1i(glGetUniformLocation(program, "IsLightingEnabled"), lighting_flag);
-    glUniform1i(glGetUniformLocation(program, "IsFlatShadingEnabled"), flat_shading_flag);
-    glUniform1i(glGetUniformLocation(program, "IsSmoothShadingEnabled"), smooth_shading_flag);
-    glUniform1i(glGetUniformLocation(program, "IsSpotlight"), spot_light_flag);
+    block.light_direction = light_direction;
+    block.dir_light_ambient = dir_light_ambient;
+    block.dir_light_diffuse = dir_light_diffuse;
+    block.dir_light_specular = dir_light_specular;
+
+    // The Light Position needs to be in Eye Frame
+    block.light_position = eye_frame * light_position;
+    block.light_ambient = light_ambient;
+    block.light_diffuse = light_diffuse;
+    block.light_specular = light_specular;
 
     // The Spotlight (spotlight_direction) needs to be in Eye Frame
-    vec3 spotlight_direction_eyeFrame = upperLeftMat3(mv) * spotlight_direction;
-    glUniform3fv(glGetUniformLocation(program, "SpotlightDirection"),
-        1, spotlight_direction_eyeFrame); // Convert to eye frame -> Normalize in vertex Shader
-    glUniform1f(glGetUniformLocation(program, "SpotlightExponent"),
-        spotlight_exponent);
-    glUniform1f(glGetUniformLocation(program, "SpotlightCutoff"),
-        spotlight_cutoff_radians);
-
-    glUniform1f(glGetUniformLocation(program, "ConstAtt"),
-        const_att);
-    glUniform1f(glGetUniformLocation(program, "LinearAtt"),
-        linear_att);
-    glUniform1f(glGetUniformLocation(program, "QuadAtt"),
-        quad_att);
-
-    glUniform1f(glGetUniformLocation(program, "Shininess"),
-        material_shininess);
+    block.spotlight_direction = upperLeftMat3(eye_frame) * spotlight_direction; // Normalized in vertex Shader
+    block.spotlight_exponent = spotlight_exponent;
+    block.spotlight_cutoff = spotlight_cutoff_radians;
+
+    block.const_att = const_att;
+    block.linear_att = linear_att;
+    block.quad_att = quad_att;
+
+    lighting_buffer.update(0, block);
 }
 
 //----------------------------------------------------------------------
-// SetupTextureUniformVars():
-// Set up texture parameters that are uniform variables in shader.
+// setupFogBlock():
+// Set up the Fog uniform block for the current frame.
 //
 //----------------------------------------------------------------------
-void setupTextureUniformVars()
+void setupFogBlock()
 {
-    glUniform4fv(glGetUniformLocation(program, "FogColor"), 1, fog_color);
-    glUniform1i(glGetUniformLocation(program, "FogType"), fog_type);
-    glUniform1f(glGetUniformLocation(program, "FogStart"), fog_start);
-    glUniform1f(glGetUniformLocation(program, "FogEnd"), fog_end);
-    glUniform1f(glGetUniformLocation(program, "FogDensity"), fog_density);
-
-    glUniform1i(glGetUniformLocation(program, "IsTextureMappedGround"), texture_mapped_ground_flag);
+    FogBlock block;
+    block.fog_color = fog_color;
+    block.fog_start = fog_start;
+    block.fog_end = fog_end;
+    block.fog_density = fog_density;
+    block.padding = 0;
+
+    fog_buffer.update(0, block);
+}
 
-    glUniform1i(glGetUniformLocation(program, "IsEyeSpace"), eye_space_flag);
-    glUniform1i(glGetUniformLocation(program, "TextureMappedSphereFlag"), texture_mapped_sphere_flag);
-    glUniform1i(glGetUniformLocation(program, "SphereMappingMode"), sphere_mapping_mode_flag);
+//----------------------------------------------------------------------
+// setupProgramVariant(program):
+// Bind the uniform blocks and the samplers of a newly compiled variant
+// of programs.
+//
+//----------------------------------------------------------------------
+void setupProgramVariant(const ShaderProgram<NUM_UNIFORMS, NUM_ATTRIBUTES>& program)
+{
+    BindUniformBlocks(program, uniform_block_names, NUM_UNIFORM_BLOCKS);
 
-    glUniform1i(glGetUniformLocation(program, "IsLatticeOn"), lattice_on_flag);
-    glUniform1i(glGetUniformLocation(program, "LatticeMappingMode"), lattice_mapping_mode_flag);
+    gl_state.useProgram(program);
+    gl_state.uniform1i(program.uniform(UNIFORM_TEXTURE_1D), 0);  // Texture unit 0
+    gl_state.uniform1i(program.uniform(UNIFORM_TEXTURE_2D), 1);  // Texture unit 1
 }
 
-//----------------------------------------------------------------------------
-// findRadius(): 
-// Finds the max radius of a sphere file whose vertices' points have been inserted into sphere_points up until this point
-// 
-//----------------------------------------------------------------------------
-void findRadius() {
-    float max_radius = 0.0f;
-    for (point4 sp : sphere_points) {
-        max_radius = max(sqrt(sp.x * sp.x + sp.y * sp.y + sp.z * sp.z), max_radius);
-    }
-    sphere_radius = max_radius;
+//----------------------------------------------------------------------
+// useProgramVariant(object, position_scale, octahedral_normals):
+// Use the variant of programs for the next draw of object with the current
+// flags (compiled now if it is the first draw with them), and set its
+// Projection matrix. An option is only on where the shaders would have
+// taken its path, so that flags without effect do not make new variants.
+//
+//----------------------------------------------------------------------
+void useProgramVariant(int object, GLfloat position_scale, bool octahedral_normals)
+{
+    bool lit = (lighting_flag == 1);
+    bool wireframe = (wireframe_flag == 1);
+    bool shaded = lit && !wireframe;  // shade() is called
+
+    int options[NUM_SHADER_OPTIONS];
+    options[OPTION_LIGHTING] = lit;
+    options[OPTION_WIREFRAME] = wireframe;
+    options[OPTION_FLAT_SHADING] = shaded && object == OBJECT_SPHERE && flat_shading_flag == 1 && smooth_shading_flag != 1;
+    options[OPTION_SPOTLIGHT] = shaded && spot_light_flag == 1;
+    options[OPTION_UNLIT_COLOR] = (lit || axes_flag || plane_flag) ? 0 : shadow_flag ? 1 : wireframe ? 2 : 0;
+    options[OPTION_BLENDING_SHADOW] = (object == OBJECT_SHADOW && blending_shadow_flag == 1);
+    options[OPTION_LATTICE] = !wireframe && lattice_on_flag == 1;
+    options[OPTION_GROUND_TEXTURE] = (texture_mapped_ground_flag == 1);
+    options[OPTION_SPHERE_TEXTURE] = wireframe ? 0 : texture_mapped_sphere_flag;
+    options[OPTION_FOG_TYPE] = fog_type;
+    options[OPTION_QUANTIZED_POSITION] = (position_scale != 0.0f);
+    options[OPTION_OCTAHEDRAL_NORMAL] = shaded && !options[OPTION_FLAT_SHADING] && octahedral_normals;
+
+    const ShaderProgram<NUM_UNIFORMS, NUM_ATTRIBUTES>& program = programs.get(options);
+    gl_state.useProgram(program);
+    gl_state.uniformMatrix4fv(program.uniform(UNIFORM_PROJECTION), GL_TRUE, p); // GL_TRUE: matrix is row-major
 }
 
-//----------------------------------------------------------------------------
-// readSphereFile(fileName): 
-// Reads a file in the appropriate vertex format to populate sphere_points and sphere_colors.
+//----------------------------------------------------------------------
+// setupObjectBlock(object, mv, position_scale, octahedral_normals):
+// Set up the Object uniform block of object from mv, normal_matrix, the
+// material and the current flags, bind it and use the program variant of
+// the flags for the next draw. position_scale and octahedral_normals give
+// the vertex format of the object as its vertex array.
 //
-//----------------------------------------------------------------------------
-void readSphereFile(const string fileName) 
+//----------------------------------------------------------------------
+void setupObjectBlock(int object, const mat4& mv, GLfloat position_scale = 0.0f, bool octahedral_normals = false)
 {
-        vector<point4> points;
-        vector<vec3> smooth_normals;
-        vector<vec3> flat_normals;
-        ifstream file(fileName);
-    
-        if (!file) {
-            cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
-            return;
-        }
-    
-        // Triangle count from file
-        int triangleCount;
-        file >> triangleCount;
-    
-        // Initialize coordinate variables for each triangle
-        float x, y, z;
-        
-        // Vertices in the Triangle (Should be 3)
-        int n;
-    
-        for (int i = 0; i < triangleCount; i++) {
-            file >> n;
-    
-            if (n != 3) {
-                cerr << "Error: Expected triangle but found a different shape, with a vertex count of: " << n << "\n";
-                continue;
-            }
-
-            point3 vertices[3];
-            
-            for (int j = 0; j < 3; j++) {
-                file >> x >> y >> z;
-                points.push_back(point4(x, y, z, 1.0f));
-                
-                // Compute per-vertex normal for smooth shading
-                vec3 normal = normalize(vec3(x, y, z));
-                smooth_normals.push_back(normal);
-
-                vertices[j] = point3(x, y, z);
-            }
-
-            // Compute face normal for flat shading
-            vec3 u = vec3(vertices[1]) - vec3(vertices[0]);
-            vec3 v = vec3(vertices[2]) - vec3(vertices[0]);
-            vec3 normal = normalize(cross(u, v));
-
-            for (int j = 0; j < 3; j++) {
-                flat_normals.push_back(normal);
-            }
+    ObjectBlock block;
+    for (int i = 0; i < 4; i++)
+        block.model_view[i] = mv[i];
 
-        }
+    // The normal matrix is only used for lighting; keep it fixed otherwise, so that
+    // the block of an unlit object does not change from frame to frame
+    for (int i = 0; i < 3; i++)
+        block.normal_matrix[i] = (lighting_flag == 1) ? vec4(normal_matrix[i], 0.0f)
+                                                      : vec4(i == 0, i == 1, i == 2, 0.0f);
+
+    block.material_ambient = material_ambient;
+    block.material_diffuse = material_diffuse;
+    block.material_specular = material_specular;
+    block.shininess = material_shininess;
 
-        sphere_points = points;
-        sphere_smooth_normals = smooth_normals;
-        sphere_flat_normals = flat_normals;
-        file.close();
+    block.position_scale = position_scale;
+
+    block.is_eye_space = eye_space_flag;
+    block.sphere_mapping_mode = sphere_mapping_mode_flag;
+    block.lattice_mapping_mode = lattice_mapping_mode_flag;
+    for (int i = 0; i < 3; i++)
+        block.padding[i] = 0;
+
+    object_buffer.update(object, block);
+    object_buffer.bind(BLOCK_OBJECT, object);
+
+    useProgramVariant(object, position_scale, octahedral_normals);
 }
 
 //----------------------------------------------------------------------------
@@ -461,21 +717,391 @@ void populateFireworks() {
     }
 }
 
+//----------------------------------------------------------------------------
+// setSphereVertexFormat(buffers, position_scale, octahedral_normals):
+//   set the vertex format of the sphere buffer of buffers: QuantizedPoint
+//   positions scaled by position_scale (point4 positions if 0), and
+//   OctahedralNormal (or vec3) normals, interleaved or planar.
+//
+//----------------------------------------------------------------------------
+void setSphereVertexFormat(SphereBuffers& buffers, GLfloat position_scale, bool octahedral_normals)
+{
+    buffers.position_scale = position_scale;
+    buffers.octahedral_normals = octahedral_normals;
+
+    buffers.format = VertexFormat(interleaved_vertices);
+    if (position_scale != 0.0f)  // 3 normalized GLshorts (w defaults to 1.0), decoded in vshader53.glsl
+        buffers.format.add<QuantizedPoint>(ATTRIBUTE_POSITION);
+    else
+        buffers.format.add<point4>(ATTRIBUTE_POSITION);
+    if (octahedral_normals)      // 2 normalized GLshorts, decoded in vshader53.glsl
+        buffers.format.add<OctahedralNormal>(ATTRIBUTE_NORMAL);
+    else
+        buffers.format.add<vec3>(ATTRIBUTE_NORMAL);
+}
+
+//----------------------------------------------------------------------------
+// uploadSphereVertices(buffers, block_vertices, first_vertex, num_vertices, points, normals):
+//   upload num_vertices points and normals at first_vertex of the vertex
+//   buffer of buffers (whose planar blocks hold block_vertices vertices),
+//   quantized if the vertex format of buffers says so.
+//
+//----------------------------------------------------------------------------
+void uploadSphereVertices(const SphereBuffers& buffers, GLsizeiptr block_vertices, GLintptr first_vertex,
+                          GLsizeiptr num_vertices, const point4* points, const vec3* normals)
+{
+    const void* values[2] = { points, normals };
+    vector<QuantizedPoint> quantized;
+    vector<OctahedralNormal> encoded;
+
+    if (buffers.position_scale != 0.0f) {
+        quantized.resize(num_vertices);
+        quantizeSpherePoints(points, num_vertices, buffers.position_scale, quantized.data());
+        values[0] = quantized.data();
+    }
+    if (buffers.octahedral_normals) {
+        encoded.resize(num_vertices);
+        encodeOctahedralNormals(normals, num_vertices, encoded.data());
+        values[1] = encoded.data();
+    }
+
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    buffers.format.upload(block_vertices, first_vertex, num_vertices, values);
+}
+
+//----------------------------------------------------------------------------
+// createSphereVertexArray(buffers, block_vertices):
+//   create and bind the vertex array of the vertex buffer of buffers (planar
+//   blocks of block_vertices vertices) in the vertex format of buffers.
+//
+//----------------------------------------------------------------------------
+void createSphereVertexArray(SphereBuffers& buffers, GLsizeiptr block_vertices)
+{
+    glGenVertexArrays(1, &buffers.vao);
+    gl_state.bindVertexArray(buffers.vao);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    buffers.format.setAttributes(block_vertices);
+}
+
+//----------------------------------------------------------------------------
+// createSphereBuffers(buffers, mesh, welded):
+//   create the welded (indexed) sphere buffer of a whole sphere mesh from its
+//   welded sphere. It is drawn with both shading modes, so the triangle soup
+//   of mesh is not uploaded.
+//
+//----------------------------------------------------------------------------
+void createSphereBuffers(SphereBuffers& buffers, const SphereMesh& mesh, const WeldedSphereMesh& welded)
+{
+    buffers.num_vertices = mesh.num_vertices;
+    buffers.num_unique_vertices = welded.points.size();
+    buffers.index_type = welded.index_type;
+    buffers.radius = mesh.radius;
+    setSphereVertexFormat(buffers, sphere_quantized_vertices ? mesh.radius : 0.0f, sphere_quantized_vertices);
+
+    // Create and initialize a vertex buffer object for the sphere, to be used in display(), add the unique welded.points and welded.normals data to the buffer.
+    glGenBuffers(1, &buffers.vertex_buffer);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, buffers.format.bufferSize(buffers.num_unique_vertices), NULL, GL_STATIC_DRAW);
+    uploadSphereVertices(buffers, buffers.num_unique_vertices, 0, buffers.num_unique_vertices,
+                         welded.points.data(), welded.normals.data());
+    createSphereVertexArray(buffers, buffers.num_unique_vertices);
+
+    // Create and initialize an element buffer object with the indices of the welded sphere
+    // (bound while its vertex array is, which keeps it).
+    glGenBuffers(1, &buffers.index_buffer);
+    gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, welded.indexDataSize(), welded.indexData(), GL_STATIC_DRAW);
+}
+
+//----------------------------------------------------------------------------
+// allocateSphereBuffers(buffers, triangle_count):
+//   create the sphere buffer of a streamed sphere at its full size;
+//   uploadSphereChunk() fills it in. (The streamed sphere is not welded and
+//   is drawn with glDrawArrays(). Its radius is only known once the whole
+//   file is read, so only its normals can be quantized.)
+//
+//----------------------------------------------------------------------------
+void allocateSphereBuffers(SphereBuffers& buffers, int triangle_count)
+{
+    buffers.num_vertices = 3 * triangle_count;
+    buffers.num_unique_vertices = buffers.num_vertices;
+    buffers.index_buffer = 0;
+    buffers.index_type = GL_UNSIGNED_INT;
+    setSphereVertexFormat(buffers, 0.0f, sphere_quantized_vertices);
+
+    glGenBuffers(1, &buffers.vertex_buffer);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, buffers.format.bufferSize(buffers.num_vertices), NULL, GL_STATIC_DRAW);
+
+    createSphereVertexArray(buffers, buffers.num_vertices);
+}
+
+//----------------------------------------------------------------------------
+// uploadSphereChunk(buffers, chunk):
+//   upload a streamed chunk at its final offset in the sphere buffer.
+//
+//----------------------------------------------------------------------------
+void uploadSphereChunk(const SphereBuffers& buffers, const StagedChunk& chunk)
+{
+    GLintptr first_vertex = 3 * (GLintptr) chunk.first_triangle;
+    GLsizeiptr num_vertices = 3 * (GLsizeiptr) chunk.triangle_count;
+
+    uploadSphereVertices(buffers, buffers.num_vertices, first_vertex, num_vertices,
+                         chunk.points.data(), chunk.smooth_normals.data());
+}
+
+//----------------------------------------------------------------------------
+// deleteSphereBuffers(buffers):
+//   delete the buffer and vertex array objects of buffers.
+//
+//----------------------------------------------------------------------------
+void deleteSphereBuffers(SphereBuffers& buffers)
+{
+    gl_state.deleteVertexArrays(1, &buffers.vao);
+    buffers.vao = 0;
+    gl_state.deleteBuffers(1, &buffers.vertex_buffer);
+    if (buffers.index_buffer != 0)
+        gl_state.deleteBuffers(1, &buffers.index_buffer);
+    buffers.vertex_buffer = buffers.index_buffer = 0;
+}
+
+//----------------------------------------------------------------------------
+// useSphereLods(lods):
+//   make the level-of-detail chain lods (coarsest level first) the sphere
+//   drawn by drawSphereObj(), deleting the buffers of the sphere drawn so
+//   far. Called between two frames on the GL thread, so the whole sphere
+//   is swapped at once.
+//
+//----------------------------------------------------------------------------
+void useSphereLods(vector<SphereBuffers>& lods)
+{
+    for (SphereBuffers& buffers : sphere_lods)
+        deleteSphereBuffers(buffers);
+
+    sphere_lods.swap(lods);
+    sphere_lod = sphere_lods.size() - 1;
+    sphere_lod_reported = -1;
+    sphere_radius = sphere_lods.back().radius;
+}
+
+//----------------------------------------------------------------------------
+// buildSphereLods(load, triangle_count, radius):
+//   generate (on the worker thread) the coarser levels of detail of a
+//   loaded sphere of triangle_count triangles: icospheres of the same
+//   radius with 20, 80, 320, ... triangles, fewer than the loaded sphere.
+//
+//----------------------------------------------------------------------------
+void buildSphereLods(SphereLoad* load, int triangle_count, GLfloat radius)
+{
+    for (int level = 0; level <= sphere_lod_max_level && (20 << (2 * level)) < triangle_count; level++) {
+        load->lod_meshes.push_back(SphereMesh());
+        load->lod_welded.push_back(WeldedSphereMesh());
+        generateIcosphere(level, load->lod_meshes.back(), radius);
+        weldSphereMesh(load->lod_meshes.back(), sphere_weld_epsilon, load->lod_welded.back());
+    }
+}
+
+//----------------------------------------------------------------------------
+// loadSphereWorker(load):
+//   body of the worker thread that loads the sphere file of load: either
+//   the whole mesh (see loadSphereMesh()) welded into an indexed smooth
+//   sphere, or chunk by chunk (see streamSphereFile()), queueing at most
+//   sphere_load_max_chunks chunks for pollSphereLoad() to upload.
+//   Returns early once stopSphereLoad() has stopped the load.
+//   No GL calls are made here.
+//
+//----------------------------------------------------------------------------
+void loadSphereWorker(SphereLoad* load)
+{
+    auto stopped = [&]() {
+        lock_guard<mutex> guard(load->lock);
+        return load->stopped;
+    };
+    bool ok;
+
+    if (!load->streamed) {
+        ok = loadSphereMesh(load->file_name, load->mesh) && !stopped();
+        if (ok) {
+            // Weld the shared vertices of the smooth shading sphere so that each one is stored (and transformed) only once
+            weldSphereMesh(load->mesh, sphere_weld_epsilon, load->welded);
+        }
+    }
+    else {
+        auto begin = [&](int triangle_count) {
+            lock_guard<mutex> guard(load->lock);
+            load->triangle_count = triangle_count;
+        };
+
+        auto chunk = [&](const SphereMeshChunk& c) {
+            size_t num_vertices = 3 * (size_t) c.triangle_count;
+            StagedChunk staged;
+            staged.first_triangle = c.first_triangle;
+            staged.triangle_count = c.triangle_count;
+            staged.points.assign(c.points, c.points + num_vertices);
+            staged.smooth_normals.assign(c.smooth_normals, c.smooth_normals + num_vertices);
+
+            // Wait for the GL thread to catch up, so that memory use stays bounded
+            unique_lock<mutex> guard(load->lock);
+            load->chunk_taken.wait(guard, [&]() { return load->chunks.size() < sphere_load_max_chunks || load->stopped; });
+            if (load->stopped)
+                return false;
+            load->chunks.push_back(move(staged));
+            return true;
+        };
+
+        ok = streamSphereFile(load->file_name, begin, chunk, load->mesh.radius);
+        load->mesh.triangle_count = load->triangle_count;
+    }
+
+    if (ok && !stopped())
+        buildSphereLods(load, load->mesh.triangle_count, load->mesh.radius);
+
+    lock_guard<mutex> guard(load->lock);
+    load->done = true;
+    load->ok = ok;
+}
+
+//----------------------------------------------------------------------------
+// pollSphereLoad(value):
+//   GLUT timer callback on the GL thread while the sphere file is loaded:
+//   uploads the chunks queued by the worker and, once the whole sphere is
+//   in its buffers, swaps it in place of the placeholder.
+//
+//----------------------------------------------------------------------------
+void pollSphereLoad(int value)
+{
+    SphereLoad* load = sphere_load;
+
+    deque<StagedChunk> chunks;
+    int triangle_count;
+    bool done;
+    {
+        lock_guard<mutex> guard(load->lock);
+        chunks.swap(load->chunks);
+        triangle_count = load->triangle_count;
+        done = load->done;
+    }
+    load->chunk_taken.notify_one();
+
+    if (load->streamed) {
+        if (triangle_count >= 0 && load->buffers.vertex_buffer == 0)
+            allocateSphereBuffers(load->buffers, triangle_count);
+        for (const StagedChunk& chunk : chunks)
+            uploadSphereChunk(load->buffers, chunk);
+    }
+
+    if (!done) {
+        glutTimerFunc(sphere_load_poll_interval, pollSphereLoad, 0);
+        return;
+    }
+
+    load->worker.join();
+
+    if (load->ok) {
+        if (!load->streamed) {
+            createSphereBuffers(load->buffers, load->mesh, load->welded);
+            // The sphere data now lives in the VBOs; drop the CPU-side copy / mapping.
+            releaseSphereMesh(load->mesh);
+        }
+        load->buffers.radius = load->mesh.radius;
+
+        // The coarser levels of detail, then the loaded sphere
+        vector<SphereBuffers> lods(load->lod_meshes.size());
+        for (size_t i = 0; i < lods.size(); i++) {
+            createSphereBuffers(lods[i], load->lod_meshes[i], load->lod_welded[i]);
+            releaseSphereMesh(load->lod_meshes[i]);
+        }
+        lods.push_back(load->buffers);
+        useSphereLods(lods);
+        report_full_quality = true;
+
+        cout << "Loaded " << sphere_lods.back().num_vertices / 3 << " sphere triangles from " << load->file_name
+             << (load->streamed ? " (streamed)" : "") << " in " << glutGet(GLUT_ELAPSED_TIME) - t_sphere_load_start
+             << " ms; peak memory " << peakMemoryUsage() / 1.0e6 << " MB\n";
+    }
+    else {
+        deleteSphereBuffers(load->buffers);
+        cerr << "Error: Sphere file could not be loaded, keeping the placeholder sphere: " << load->file_name << "\n";
+    }
+
+    delete load;
+    sphere_load = NULL;
+    glutPostRedisplay();
+}
+
+//----------------------------------------------------------------------------
+// startSphereLoad(fileName):
+//   show a low-resolution placeholder sphere right away and start loading
+//   the sphere file (or generating the icosphere) fileName on a worker
+//   thread; pollSphereLoad() swaps it in once it is ready.
+//   Very large spheres are streamed chunk by chunk into the VBOs, so that they
+//   are never held in memory whole.
+//
+//----------------------------------------------------------------------------
+void startSphereLoad(const string& fileName)
+{
+    t_sphere_load_start = glutGet(GLUT_ELAPSED_TIME);
+
+    SphereMesh placeholder_mesh;
+    WeldedSphereMesh placeholder_welded;
+    vector<SphereBuffers> placeholder(1);
+    generateIcosphere(sphere_placeholder_level, placeholder_mesh);
+    weldSphereMesh(placeholder_mesh, sphere_weld_epsilon, placeholder_welded);
+    createSphereBuffers(placeholder[0], placeholder_mesh, placeholder_welded);
+    useSphereLods(placeholder);
+
+    sphere_load = new SphereLoad();
+    sphere_load->file_name = fileName;
+    sphere_load->streamed = sphereFileTriangleCount(fileName) >= sphere_stream_min_triangles;
+    sphere_load->triangle_count = -1;
+    sphere_load->done = false;
+    sphere_load->ok = false;
+    sphere_load->stopped = false;
+    sphere_load->buffers = SphereBuffers();
+    sphere_load->worker = thread(loadSphereWorker, sphere_load);
+
+    glutTimerFunc(sphere_load_poll_interval, pollSphereLoad, 0);
+}
+
+//----------------------------------------------------------------------------
+// stopSphereLoad():
+//   registered with atexit() by main(), so that it runs on every exit (the
+//   quit key and menu entry, and GLUT closing the window): stops the sphere
+//   file load in progress, if any, and waits for its worker thread to
+//   finish, so that the worker is not left running while the static
+//   objects are destroyed. A streamed load stops at its next chunk, a
+//   whole-file load after its read.
+//
+//----------------------------------------------------------------------------
+void stopSphereLoad()
+{
+    if (sphere_load == NULL)
+        return;
+
+    {
+        lock_guard<mutex> guard(sphere_load->lock);
+        sphere_load->stopped = true;
+    }
+    sphere_load->chunk_taken.notify_one();
+    if (sphere_load->worker.joinable())
+        sphere_load->worker.join();
+}
+
 //----------------------------------------------------------------------------
 // OpenGL initialization
 //
 void init()
 {
-    //readSphereFile("sphere.8.txt");    // Uncomment this line to read from "sphere.8.txt" file within the project directory.
-    //readSphereFile("sphere.128.txt");  // Uncomment this line to read from "sphere.128.txt" file within the project directory.
-    //readSphereFile("sphere.256.txt");  // Uncomment this line to read from "sphere.256.txt" file within the project directory.
-    //readSphereFile("sphere.1024.txt"); // Uncomment this line to read from "sphere.1024.txt" file within the project directory.
-    cout << "Enter Name of Sphere File (.txt extension) \n";
+    //startSphereLoad("sphere.8.txt");    // Uncomment this line to read from "sphere.8.txt" file within the project directory.
+    //startSphereLoad("sphere.128.txt");  // Uncomment this line to read from "sphere.128.txt" file within the project directory.
+    //startSphereLoad("sphere.256.txt");  // Uncomment this line to read from "sphere.256.txt" file within the project directory.
+    //startSphereLoad("sphere.1024.txt"); // Uncomment this line to read from "sphere.1024.txt" file within the project directory.
+    cout << "Enter Name of Sphere File (.txt extension), or icosphere.<level> to generate one \n";
     string inputFile;
     cin >> inputFile;
-    readSphereFile(inputFile);
 
-    findRadius();
+    // Draw a placeholder sphere while the sphere file is loaded in the background
+    startSphereLoad(inputFile);
 
     populateFireworks();
 
@@ -485,8 +1111,8 @@ void init()
     glGenTextures(1, &tex_1D);
     glGenTextures(1, &tex_2D);
 
-    glActiveTexture(GL_TEXTURE0);  // Set the active texture unit to be 0 
-    glBindTexture(GL_TEXTURE_1D, tex_1D);
+    gl_state.activeTexture(GL_TEXTURE0);  // Set the active texture unit to be 0 
+    gl_state.bindTexture(GL_TEXTURE_1D, tex_1D);
 
     glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, stripeImageWidth, 0, GL_RGBA, GL_UNSIGNED_BYTE, stripeImage);
 
@@ -498,8 +1124,8 @@ void init()
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-    glActiveTexture(GL_TEXTURE1);  // Set the active texture unit to be 1 
-    glBindTexture(GL_TEXTURE_2D, tex_2D);
+    gl_state.activeTexture(GL_TEXTURE1);  // Set the active texture unit to be 1 
+    gl_state.bindTexture(GL_TEXTURE_2D, tex_2D);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ImageWidth, ImageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, Image);
 
@@ -512,162 +1138,163 @@ void init()
     // Modulate mode for combining texture color with lighting/color
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
-    // Create and initialize a vertex buffer object for smooth shading sphere, to be used in display(), add the sphere_points and sphere_smooth_normals data to the buffer.
-    glGenBuffers(1, &sphere_smooth_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, sphere_smooth_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sphere_points.size() * sizeof(point4) + sphere_smooth_normals.size() * sizeof(vec3), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sphere_points.size() * sizeof(point4), sphere_points.data()); 
-    glBufferSubData(GL_ARRAY_BUFFER, sphere_points.size() * sizeof(point4), sphere_smooth_normals.size() * sizeof(vec3), sphere_smooth_normals.data());
-
-    // Create and initialize a vertex buffer object for flat shading sphere, to be used in display(), add the sphere_points and sphere_flat_normals data to the buffer.
-    glGenBuffers(1, &sphere_flat_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, sphere_flat_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sphere_points.size() * sizeof(point4) + sphere_flat_normals.size() * sizeof(vec3), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sphere_points.size() * sizeof(point4), sphere_points.data());
-    glBufferSubData(GL_ARRAY_BUFFER, sphere_points.size() * sizeof(point4), sphere_flat_normals.size() * sizeof(vec3), sphere_flat_normals.data());
-
     // Create and initialize a vertex buffer object for axes, to be used in display(), add the axes_points and axes_colors data to the buffer.
     glGenBuffers(1, &axes_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, axes_buffer);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, axes_buffer);
     glBufferData(GL_ARRAY_BUFFER, axes_num_vertices * sizeof(point4) + axes_num_vertices * sizeof(vec3), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, axes_num_vertices * sizeof(point4), axes_points);
     glBufferSubData(GL_ARRAY_BUFFER, axes_num_vertices * sizeof(point4), axes_num_vertices * sizeof(vec3), axes_normals);
 
-    // Create and initialize a vertex buffer object for plane, to be used in display(), add the plane_points and plane_colors data to the buffer.
+    // and its vertex array object, used by drawObj()
+    glGenVertexArrays(1, &axes_vao);
+    gl_state.bindVertexArray(axes_vao);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+    glEnableVertexAttribArray(ATTRIBUTE_NORMAL);
+    glVertexAttribPointer(ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(axes_num_vertices * sizeof(point4)));
+
+    // Create and initialize a vertex buffer object for plane, to be used in display(), add the plane_points, plane_normals and plane_tex_coords data to the buffer.
+    plane_format = VertexFormat(interleaved_vertices);
+    plane_format.add<point4>(ATTRIBUTE_POSITION).add<vec3>(ATTRIBUTE_NORMAL).add<vec2>(ATTRIBUTE_TEX_COORD);
+    const void* plane_values[] = { plane_points, plane_normals, plane_tex_coords };
     glGenBuffers(1, &plane_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, plane_buffer);
-    glBufferData(GL_ARRAY_BUFFER, plane_num_vertices * sizeof(point4) + plane_num_vertices * sizeof(vec3) + plane_num_vertices * sizeof(vec2), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, plane_num_vertices * sizeof(point4), plane_points);
-    glBufferSubData(GL_ARRAY_BUFFER, plane_num_vertices * sizeof(point4), plane_num_vertices * sizeof(vec3), plane_normals);
-    glBufferSubData(GL_ARRAY_BUFFER, plane_num_vertices * sizeof(point4) + plane_num_vertices * sizeof(vec3), plane_num_vertices * sizeof(vec2), plane_tex_coords);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, plane_buffer);
+    glBufferData(GL_ARRAY_BUFFER, plane_format.bufferSize(plane_num_vertices), NULL, GL_STATIC_DRAW);
+    plane_format.upload(plane_num_vertices, 0, plane_num_vertices, plane_values);
+
+    // and its vertex array object
+    glGenVertexArrays(1, &plane_vao);
+    gl_state.bindVertexArray(plane_vao);
+    plane_format.setAttributes(plane_num_vertices);
 
     // Create and initialize a vertex buffer object for fireworks, to be used in display(), add the fireworks_velocities and fireworks_colors data to the buffer.
     glGenBuffers(1, &fireworks_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, fireworks_buffer);
+    gl_state.bindBuffer(GL_ARRAY_BUFFER, fireworks_buffer);
     glBufferData(GL_ARRAY_BUFFER, fireworks_particle_count * sizeof(vec3) + fireworks_particle_count * sizeof(vec3), NULL, GL_STATIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, fireworks_velocities.size() * sizeof(vec3), fireworks_velocities.data());
     glBufferSubData(GL_ARRAY_BUFFER, fireworks_velocities.size() * sizeof(vec3), fireworks_colors.size() * sizeof(vec3), fireworks_colors.data());
 
-    // Load shaders and create a shader program (to be used in display())
-    program = InitShader("vshader53.glsl", "fshader53.glsl");
-    fireworks_program = InitShader("fireworksVShader.glsl", "fireworksFShader.glsl");
+    // and its vertex array object, used by drawFireworksObj()
+    glGenVertexArrays(1, &fireworks_vao);
+    gl_state.bindVertexArray(fireworks_vao);
+    glEnableVertexAttribArray(FIREWORKS_ATTRIBUTE_VELOCITY);
+    glVertexAttribPointer(FIREWORKS_ATTRIBUTE_VELOCITY, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+    glEnableVertexAttribArray(FIREWORKS_ATTRIBUTE_COLOR);
+    glVertexAttribPointer(FIREWORKS_ATTRIBUTE_COLOR, 3, GL_FLOAT, GL_FALSE, 0,
+                          BUFFER_OFFSET(fireworks_particle_count * sizeof(vec3)));
+    gl_state.bindVertexArray(0);
+
+    // Load shaders and create the fireworks shader program (to be used in display()); the
+    // variants of programs are compiled as they are first drawn with. Both are loaded from
+    // the program cache instead if they are in it.
+    SetProgramCache(program_cache_directory);
+    fireworks_program = InitShader("fireworksVShader.glsl", "fireworksFShader.glsl",
+                                   fireworks_uniform_names, fireworks_attribute_names);
+
+    // Create the uniform buffers of the uniform blocks of programs; the frame-constant
+    // blocks stay bound, the Object block is bound per draw by setupObjectBlock()
+    lighting_buffer.create(1);
+    fog_buffer.create(1);
+    object_buffer.create(NUM_OBJECTS);
+    gl_state.bindBufferBase(GL_UNIFORM_BUFFER, BLOCK_LIGHTING, lighting_buffer.buffer);
+    gl_state.bindBufferBase(GL_UNIFORM_BUFFER, BLOCK_FOG, fog_buffer.buffer);
 
     t_start = glutGet(GLUT_ELAPSED_TIME);
 
-    glEnable( GL_DEPTH_TEST );
+    gl_state.enable( GL_DEPTH_TEST );
 
     // Sets background color to sky blue
     glClearColor(0.529, 0.807, 0.92, 0.0);
 }
 
 //----------------------------------------------------------------------------
-// drawObj(buffer, offset, num_vertices, mode, line_width):
-//   draw the object that is associated with the vertex buffer object "buffer"
-//   having "num_vertices" vertices, a "mode" for the glDrawArrays() function, and a "line_width" 
-//   for the same glDrawArrays() function.
+// drawObj(vao, offset, count, mode, line_width, index_type):
+//   draw the object whose vertex buffer(s) are set up in the vertex array object "vao":
+//   "count" vertices starting at vertex "offset" with glDrawArrays() in "mode", with lines
+//   of "line_width".
+//   With an "index_type" other than GL_NONE, the object is drawn with glDrawElements()
+//   instead, using "count" indices of that type of the element buffer of "vao", starting
+//   at index "offset".
+//   The vertex format of the sphere's vertex arrays (quantized or not) must match the one
+//   the program variant was selected with (see setupObjectBlock()).
 //
 //----------------------------------------------------------------------------
-void drawObj(GLuint buffer, int offset, int num_vertices, GLenum mode, GLfloat line_width)
+void drawObj(GLuint vao, int offset, int count, GLenum mode, GLfloat line_width, GLenum index_type = GL_NONE)
 {
-    glLineWidth(line_width);
-    //--- Activate the vertex buffer object to be drawn ---//
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-
-    /*----- Set up vertex attribute arrays for each vertex attribute -----*/
-    GLuint vPosition = glGetAttribLocation(program, "vPosition");
-    glEnableVertexAttribArray(vPosition);
-    glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0,
-			  BUFFER_OFFSET(0) );
-
-    GLuint vNormal = glGetAttribLocation(program, "vNormal"); 
-    glEnableVertexAttribArray(vNormal);
-    glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0,
-			  BUFFER_OFFSET(sizeof(point4) * num_vertices) ); 
-
-    /* Draw a sequence of geometric objs (triangles) from the vertex buffer
-       (using the attributes specified in each enabled vertex attribute array) */
-    glDrawArrays(mode, offset, num_vertices);
+    gl_state.lineWidth(line_width);
+    gl_state.bindVertexArray(vao);
 
-    /*--- Disable each vertex attribute array being enabled ---*/
-    glDisableVertexAttribArray(vPosition);
-    glDisableVertexAttribArray(vNormal);
-    glLineWidth(1.0);
+    if (index_type != GL_NONE) {
+        GLsizeiptr index_size = (index_type == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        glDrawElements(mode, count, index_type, BUFFER_OFFSET(index_size * offset));
+    }
+    else
+        glDrawArrays(mode, offset, count);
 }
 
 //----------------------------------------------------------------------------
-// drawPlaneObj(buffer, offset, num_vertices, mode, line_width):
-//   draw the plane object that is associated with the vertex buffer object "buffer"
-//   having "num_vertices" vertices, a "mode" for the glDrawArrays() function, and a "line_width" 
-//   for the same glDrawArrays() function.
+// selectSphereLod():
+//   select the level of detail of the sphere for the current frame from its
+//   projected radius in pixels (from sphere_radius, its distance to the eye
+//   and the Perspective() parameters): the coarsest level whose visible
+//   triangles cover at most sphere_lod_pixels_per_triangle pixels each.
+//   A finer level is selected as soon as it is needed, a coarser one only
+//   once it has sphere_lod_hysteresis more triangles than needed.
 //
 //----------------------------------------------------------------------------
-void drawPlaneObj(GLuint buffer, int offset, int num_vertices, GLenum mode, GLfloat line_width)
+void selectSphereLod()
 {
-    glLineWidth(line_width);
-    //--- Activate the vertex buffer object to be drawn ---//
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-
-    /*----- Set up vertex attribute arrays for each vertex attribute -----*/
-    GLuint vPosition = glGetAttribLocation(program, "vPosition");
-    glEnableVertexAttribArray(vPosition);
-    glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0,
-        BUFFER_OFFSET(0));
-
-    GLuint vNormal = glGetAttribLocation(program, "vNormal");
-    glEnableVertexAttribArray(vNormal);
-    glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0,
-        BUFFER_OFFSET(sizeof(point4) * num_vertices));
-
-    GLuint vTexCoord = glGetAttribLocation(program, "vTexCoord");
-    glEnableVertexAttribArray(vTexCoord);
-    glVertexAttribPointer(vTexCoord, 2, GL_FLOAT, GL_FALSE, 0,
-        BUFFER_OFFSET(sizeof(point4) * num_vertices + sizeof(vec3) * num_vertices));
-    // the offset is the (total) size of the previous vertex attribute array(s)
-
-  /* Draw a sequence of geometric objs (triangles) from the vertex buffer
-     (using the attributes specified in each enabled vertex attribute array) */
-    glDrawArrays(mode, offset, num_vertices);
+    vec3 to_eye(eye.x - position.x, eye.y - position.y, eye.z - position.z);
+    GLfloat distance = length(to_eye);
+    int finest = sphere_lods.size() - 1;
+
+    if (distance <= sphere_radius) {
+        sphere_lod = finest;  // the eye is inside the sphere
+        return;
+    }
+
+    // Radius of the sphere's silhouette on the screen
+    GLfloat projected_radius = sphere_radius / sqrt(distance * distance - sphere_radius * sphere_radius)
+                               / tan(0.5f * fovy * DegreesToRadians) * (0.5f * window_height);
+
+    // The visible half of the triangles covers the silhouette disc
+    GLfloat needed_triangles = 2.0f * M_PI * projected_radius * projected_radius / sphere_lod_pixels_per_triangle;
+
+    while (sphere_lod < finest && sphere_lods[sphere_lod].num_vertices / 3 < needed_triangles)
+        sphere_lod++;
+    while (sphere_lod > 0 && sphere_lods[sphere_lod - 1].num_vertices / 3 >= needed_triangles * (1.0f + sphere_lod_hysteresis))
+        sphere_lod--;
+}
+
+//----------------------------------------------------------------------------
+// drawSphereObj():
+//   draw the selected level of detail of the sphere, indexed unless it is
+//   streamed, and count the vertices it sends through the vertex shader.
+//   The shading mode (smooth or flat) is an option of its program variant.
+//
+//----------------------------------------------------------------------------
+void drawSphereObj()
+{
+    const SphereBuffers& sphere = sphere_lods[sphere_lod];
 
-    /*--- Disable each vertex attribute array being enabled ---*/
-    glDisableVertexAttribArray(vPosition);
-    glDisableVertexAttribArray(vNormal);
-    glDisableVertexAttribArray(vTexCoord);
-    glLineWidth(1.0);
+    drawObj(sphere.vao, 0, sphere.num_vertices, GL_TRIANGLES, 1.0,
+            (sphere.index_buffer != 0) ? sphere.index_type : GL_NONE);
+    sphere_vertices_per_frame += sphere.num_unique_vertices;
 }
 
 //----------------------------------------------------------------------------
-// drawFireworksObj(buffer, offset, num_vertices, mode, point_size):
-//   draw the fireworks object that is associated with the vertex buffer object "buffer"
-//   having "num_vertices" vertices, a "mode" for the glDrawArrays() function, and a "point_size" 
+// drawFireworksObj(vao, offset, num_vertices, mode, point_size):
+//   draw the fireworks object whose vertex buffer is set up in the vertex array object "vao":
+//   "num_vertices" vertices, a "mode" for the glDrawArrays() function, and a "point_size" 
 //   for the same glDrawArrays() function.
 //
 //----------------------------------------------------------------------------
-void drawFireworksObj(GLuint buffer, int offset, int num_vertices, GLenum mode, GLfloat point_size)
+void drawFireworksObj(GLuint vao, int offset, int num_vertices, GLenum mode, GLfloat point_size)
 {
-    glPointSize(point_size);
-    //--- Activate the vertex buffer object to be drawn ---//
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-
-    /*----- Set up vertex attribute arrays for each vertex attribute -----*/
-    GLuint vVelocity = glGetAttribLocation(fireworks_program, "vVelocity");
-    glEnableVertexAttribArray(vVelocity);
-    glVertexAttribPointer(vVelocity, 3, GL_FLOAT, GL_FALSE, 0,
-        BUFFER_OFFSET(0));
-
-    GLuint vColor = glGetAttribLocation(fireworks_program, "vColor");
-    glEnableVertexAttribArray(vColor);
-    glVertexAttribPointer(vColor, 3, GL_FLOAT, GL_FALSE, 0,
-        BUFFER_OFFSET(sizeof(vec3) * num_vertices));
-    // the offset is the (total) size of the previous vertex attribute array(s)
-
-  /* Draw a sequence of geometric objs (triangles) from the vertex buffer
-     (using the attributes specified in each enabled vertex attribute array) */
-    glDrawArrays(mode, offset, num_vertices);
+    gl_state.pointSize(point_size);
+    gl_state.bindVertexArray(vao);
 
-    /*--- Disable each vertex attribute array being enabled ---*/
-    glDisableVertexAttribArray(vVelocity);
-    glDisableVertexAttribArray(vColor);
-    glPointSize(1.0);
+    glDrawArrays(mode, offset, num_vertices);
 }
 
 //----------------------------------------------------------------------------
@@ -686,12 +1313,12 @@ void storeCurrentFlagStates() {
 }
 
 //----------------------------------------------------------------------------
-// drawAxes(model_view): 
-// Sets up the model_view matrix, the relevant flags, 
-// the color attributes, and draws the axes.
+// drawAxes(): 
+// Sets up the Object blocks of the axes with the model_view matrix,
+// the relevant flags and the color attributes, and draws the axes.
 // 
 //----------------------------------------------------------------------------
-void drawAxes(GLuint model_view) {
+void drawAxes() {
     axes_flag = 1;
     wireframe_flag = 0;
     lighting_flag = 0;
@@ -699,24 +1326,21 @@ void drawAxes(GLuint model_view) {
     texture_mapped_sphere_flag = 0;
     lattice_on_flag = 0;
 
-    mv = LookAt(eye, at, up);
-    glUniformMatrix4fv(model_view, 1, GL_TRUE, mv); // GL_TRUE: matrix is row-major
+    mv = view;
 
-    setupTextureUniformVars();
-
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    gl_state.polygonMode(GL_LINE);
 
     material_diffuse = color4(1.0, 0.0, 0.0, 1.0);
-    setupLightingUniformVars(mv);
-    drawObj(axes_buffer, 0, 2, GL_LINES, 2.0);  // draw the x-axis
+    setupObjectBlock(OBJECT_X_AXIS, mv);
+    drawObj(axes_vao, 0, 2, GL_LINES, 2.0);  // draw the x-axis
 
     material_diffuse = color4(1.0, 0.0, 1.0, 1.0);
-    setupLightingUniformVars(mv);
-    drawObj(axes_buffer, 2, 2, GL_LINES, 2.0);  // draw the y-axis
+    setupObjectBlock(OBJECT_Y_AXIS, mv);
+    drawObj(axes_vao, 2, 2, GL_LINES, 2.0);  // draw the y-axis
 
     material_diffuse = color4(0.0, 0.0, 1.0, 1.0);
-    setupLightingUniformVars(mv);
-    drawObj(axes_buffer, 4, 2, GL_LINES, 2.0);  // draw the z-axis
+    setupObjectBlock(OBJECT_Z_AXIS, mv);
+    drawObj(axes_vao, 4, 2, GL_LINES, 2.0);  // draw the z-axis
 
     axes_flag = 0;
     lighting_flag = previous_lighting_flag;
@@ -728,20 +1352,20 @@ void drawAxes(GLuint model_view) {
 }
 
 //----------------------------------------------------------------------------
-// drawPlane(model_view): 
-// Sets up the model_view and the normal_matrix matrices, the relevant flags, 
-// the relevant texture mapping (if applicable), and draws the plane.
+// drawPlane(): 
+// Sets up the Object block of the plane with the model_view and the normal_matrix
+// matrices and the relevant flags, the relevant texture mapping (if applicable),
+// and draws the plane.
 // 
 //----------------------------------------------------------------------------
-void drawPlane(GLuint model_view) {
+void drawPlane() {
     plane_flag = 1;
     wireframe_flag = 0;
     shadow_flag = 0;
     texture_mapped_sphere_flag = 0;
     lattice_on_flag = 0;
 
-    mv = LookAt(eye, at, up);
-    glUniformMatrix4fv(model_view, 1, GL_TRUE, mv); // GL_TRUE: matrix is row-major
+    mv = view;
     
     if (lighting_flag == 1) {
         material_ambient = vec4(0.2f, 0.2f, 0.2f, 1.0f);
@@ -749,41 +1373,28 @@ void drawPlane(GLuint model_view) {
         material_specular = vec4(0.0f, 0.0f, 0.0f, 1.0f);
         material_shininess = 0.0f;
 
-        // Normal Matrix Calculation
-        normal_matrix = NormalMatrix(mv, 1);
-
-        if (light_source_flag == 1) {
-            light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f);  // Positional Light Set
-            light_diffuse = color4(1.0f, 1.0f, 1.0f, 1.0f);
-            light_specular = color4(1.0f, 1.0f, 1.0f, 1.0f);
-        }
-        else {
-            light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f); // Positional Light Removed
-            light_diffuse = color4(0.0f, 0.0f, 0.0f, 1.0f);
-            light_specular = color4(0.0f, 0.0f, 0.0f, 1.0f);
-        }
+        // Normal Matrix Calculation (the view is rigid)
+        normal_matrix = NormalMatrix(mv, TransformRigid);
     }
     else {
         material_diffuse = vec4(0.0f, 1.0f, 0.0f, 1.0f);
     }
 
-    setupLightingUniformVars(mv);  // mv needs to be LookAt
+    setupObjectBlock(OBJECT_PLANE, mv);
 
     if (texture_mapped_ground_flag == 1) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, tex_2D);
+        gl_state.enable(GL_TEXTURE_2D);
+        gl_state.bindTexture(GL_TEXTURE_2D, tex_2D);
     }
     else {
-        glDisable(GL_TEXTURE_2D);
+        gl_state.disable(GL_TEXTURE_2D);
     }
 
-    setupTextureUniformVars();
-
     if (plane_flag == 1) // Filled floor
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        gl_state.polygonMode(GL_FILL);
     else              // Wireframe floor
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    drawPlaneObj(plane_buffer, 0, plane_num_vertices, GL_TRIANGLES, 1.0);  // draw the plane
+        gl_state.polygonMode(GL_LINE);
+    drawObj(plane_vao, 0, plane_num_vertices, GL_TRIANGLES, 1.0);  // draw the plane
 
     plane_flag = 0;
     wireframe_flag = previous_wireframe_flag;
@@ -793,52 +1404,38 @@ void drawPlane(GLuint model_view) {
 }
 
 //----------------------------------------------------------------------------
-// drawShadow(model_view): 
-// Sets up the model_view and the normal_matrix matrices, the relevant flags, 
-// the relevant blending attributes (if applicable), and draws the shadow.
+// drawShadow(): 
+// Sets up the Object block of the shadow with the model_view matrix (the shadow
+// is never lit, so it needs no normal_matrix) and the relevant flags, the relevant
+// blending attributes (if applicable), and draws the shadow.
 // 
 //----------------------------------------------------------------------------
-void drawShadow(GLuint model_view) {
+void drawShadow() {
     lighting_flag = 0;
     texture_mapped_ground_flag = 0;
     texture_mapped_sphere_flag = 0;
 
     if (blending_shadow_flag == 1) {
-        glUniform1i(glGetUniformLocation(program, "IsBlendingShadowEnabled"), blending_shadow_flag);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl_state.enable(GL_BLEND);
+        gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
 
     if (shadow_flag == 1 && eye.y > 0.0f) {
-        mv = LookAt(eye, at, up) * N * Translate(position.x, position.y, position.z) * (rolling_status ? R : 1) * M;
-
-        glUniformMatrix4fv(model_view, 1, GL_TRUE, mv); // GL_TRUE: matrix is row-major
-
-        // Set up the Normal Matrix from the model-view matrix
-        normal_matrix = NormalMatrix(mv, 1);
-        glUniformMatrix3fv(glGetUniformLocation(program, "NormalMatrix"),
-            1, GL_TRUE, normal_matrix);
+        mv = mat4(view) * N * sphere_model;  // (the shadow is not lit: no normal_matrix)
 
         if (wireframe_flag != 1) // Filled sphere
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            gl_state.polygonMode(GL_FILL);
         else              // Wireframe sphere
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-        setupLightingUniformVars(mv);  // mv needs to be LookAt
+            gl_state.polygonMode(GL_LINE);
 
-        setupTextureUniformVars();
-
-        if (smooth_shading_flag == 1)
-            drawObj(sphere_smooth_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the smooth sphere
-        else if (flat_shading_flag == 1)
-            drawObj(sphere_flat_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the flat sphere
-        else
-            drawObj(sphere_smooth_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the smooth sphere (By Default...) 
+        selectSphereLod();
+        setupObjectBlock(OBJECT_SHADOW, mv, sphere_lods[sphere_lod].position_scale,
+                         sphere_lods[sphere_lod].octahedral_normals);
+        drawSphereObj();  // draw the smooth or flat sphere
     }
 
     if (blending_shadow_flag == 1) {
-        glUniform1i(glGetUniformLocation(program, "IsBlendingShadowEnabled"), 0);
-        glDisable(GL_BLEND);
+        gl_state.disable(GL_BLEND);
     }
 
     lighting_flag = previous_lighting_flag;
@@ -847,18 +1444,17 @@ void drawShadow(GLuint model_view) {
 }
 
 //----------------------------------------------------------------------------
-// drawSphere(model_view): 
-// Sets up the model_view and the normal_matrix matrices, the relevant flags, 
-// the relevant texture (if applicable), and draws the sphere.
+// drawSphere(): 
+// Sets up the Object block of the sphere with the model_view and the normal_matrix
+// matrices and the relevant flags, the relevant texture (if applicable), and draws
+// the sphere.
 // 
 //----------------------------------------------------------------------------
-void drawSphere(GLuint model_view) {
+void drawSphere() {
     shadow_flag = 0;
     texture_mapped_ground_flag = 0;
 
-    mv = LookAt(eye, at, up) * Translate(position.x, position.y, position.z) * (rolling_status ? R : 1) * M;
-
-    glUniformMatrix4fv(model_view, 1, GL_TRUE, mv); // GL_TRUE: matrix is row-major
+    mv = view * sphere_model;
 
     if (lighting_flag == 1) {
         material_ambient = vec4(0.2f, 0.2f, 0.2f, 1.0f);
@@ -866,53 +1462,38 @@ void drawSphere(GLuint model_view) {
         material_specular = vec4(1.0f, 0.84f, 0.0f, 1.0f);
         material_shininess = 125.0f;
 
-        // Normal Matrix Calculation
-        normal_matrix = NormalMatrix(mv, 1);
-
-        if (light_source_flag == 1) {
-            light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f);  // Positional Light Set
-            light_diffuse = color4(1.0f, 1.0f, 1.0f, 1.0f);
-            light_specular = color4(1.0f, 1.0f, 1.0f, 1.0f);
-        }
-        else {
-            light_ambient = color4(0.0f, 0.0f, 0.0f, 1.0f); // Positional Light Removed
-            light_diffuse = color4(0.0f, 0.0f, 0.0f, 1.0f);
-            light_specular = color4(0.0f, 0.0f, 0.0f, 1.0f);
-        }
+        // Normal Matrix Calculation (view and sphere_model are rigid)
+        normal_matrix = NormalMatrix(mv, TransformRigid);
     }
     else {
         material_diffuse = vec4(1.0, 0.84, 0.0, 1.0); // Wireframe color (yellow)
     }
-    setupLightingUniformVars(LookAt(eye, at, up));  // Lighting model_view is irrelevant to the model_view transformation of the sphere...
+
+    selectSphereLod();
+    setupObjectBlock(OBJECT_SPHERE, mv, sphere_lods[sphere_lod].position_scale,
+                     sphere_lods[sphere_lod].octahedral_normals);
 
     if (texture_mapped_sphere_flag == 1) {
-        glEnable(GL_TEXTURE_1D);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_1D, tex_1D);
+        gl_state.enable(GL_TEXTURE_1D);
+        gl_state.activeTexture(GL_TEXTURE0);
+        gl_state.bindTexture(GL_TEXTURE_1D, tex_1D);
     }
     else if (texture_mapped_sphere_flag == 2) {
-        glEnable(GL_TEXTURE_2D);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, tex_2D);
+        gl_state.enable(GL_TEXTURE_2D);
+        gl_state.activeTexture(GL_TEXTURE1);
+        gl_state.bindTexture(GL_TEXTURE_2D, tex_2D);
     }
     else {
-        glDisable(GL_TEXTURE_1D);
-        glDisable(GL_TEXTURE_2D);
+        gl_state.disable(GL_TEXTURE_1D);
+        gl_state.disable(GL_TEXTURE_2D);
     }
 
-    setupTextureUniformVars();
-
     if (wireframe_flag != 1) // Filled sphere
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        gl_state.polygonMode(GL_FILL);
     else              // Wireframe sphere
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        gl_state.polygonMode(GL_LINE);
 
-    if (smooth_shading_flag == 1)
-        drawObj(sphere_smooth_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the smooth sphere
-    else if (flat_shading_flag == 1)
-        drawObj(sphere_flat_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the flat sphere
-    else
-        drawObj(sphere_smooth_buffer, 0, sphere_points.size(), GL_TRIANGLES, 1.0);  // draw the smooth sphere (By Default...) 
+    drawSphereObj();  // draw the smooth or flat sphere
 
     shadow_flag = previous_shadow_flag;
     texture_mapped_ground_flag = previous_texture_mapped_ground_flag;
@@ -926,25 +1507,25 @@ void drawSphere(GLuint model_view) {
 // 
 //----------------------------------------------------------------------------
 void drawFireworks() {
-    glUseProgram(fireworks_program);
+    gl_state.useProgram(fireworks_program);
 
-    GLuint fireworks_model_view = glGetUniformLocation(fireworks_program, "ModelView");
-    GLuint fireworks_projection = glGetUniformLocation(fireworks_program, "Projection");
+    GLuint fireworks_model_view = fireworks_program.uniform(FIREWORKS_UNIFORM_MODEL_VIEW);
+    GLuint fireworks_projection = fireworks_program.uniform(FIREWORKS_UNIFORM_PROJECTION);
 
-    glUniformMatrix4fv(fireworks_projection, 1, GL_TRUE, p); // GL_TRUE: matrix is row-major
-    glUniformMatrix4fv(fireworks_model_view, 1, GL_TRUE, LookAt(eye, at, up)); // GL_TRUE: matrix is row-major
+    gl_state.uniformMatrix4fv(fireworks_projection, GL_TRUE, p); // GL_TRUE: matrix is row-major
+    gl_state.uniformMatrix4fv(fireworks_model_view, GL_TRUE, mat4(view)); // GL_TRUE: matrix is row-major
 
     /* -- Fireworks particle time setting -- */
     t_now = glutGet(GLUT_ELAPSED_TIME);
     float t = 0.001f * (t_now - t_start);
     if (t > t_max) t_start = t_now;
 
-    glUniform3fv(glGetUniformLocation(fireworks_program, "StartPos"), 1, vec3(0.0f, 0.1f, 0.0f));
-    glUniform1f(glGetUniformLocation(fireworks_program, "CurrentTime"), t);
+    gl_state.uniform3fv(fireworks_program.uniform(FIREWORKS_UNIFORM_START_POS), vec3(0.0f, 0.1f, 0.0f));
+    gl_state.uniform1f(fireworks_program.uniform(FIREWORKS_UNIFORM_CURRENT_TIME), t);
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+    gl_state.polygonMode(GL_POINT);
 
-    drawFireworksObj(fireworks_buffer, 0, fireworks_particle_count, GL_POINTS, 3.0f);
+    drawFireworksObj(fireworks_vao, 0, fireworks_particle_count, GL_POINTS, 3.0f);
 }
 
 //----------------------------------------------------------------------------
@@ -955,69 +1536,60 @@ void drawFireworks() {
 //----------------------------------------------------------------------------
 void display(void)
 {
-    GLuint  model_view;  // model-view matrix uniform shader variable location
-    GLuint  projection;  // projection matrix uniform shader variable location
-
-    GLuint  fireworks_model_view;  // model-view matrix uniform shader variable location
-    GLuint  fireworks_projection;  // projection matrix uniform shader variable location
-
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    glUseProgram(program); // Use the shader program
+    sphere_vertices_per_frame = 0;
+    gl_state.endFrame();  // count the calls of this frame only, not those of the sphere loading in between
 
-    model_view = glGetUniformLocation(program, "ModelView" );  
-    projection = glGetUniformLocation(program, "Projection" );
-    
-    glUniform1i(glGetUniformLocation(program, "Texture_1D"), 0);  // Texture unit 0
-    glUniform1i(glGetUniformLocation(program, "Texture_2D"), 1);  // Texture unit 1
-
-    /*---  Set up and pass on Projection matrix to the shader ---*/
+    /*---  Set up the Projection matrix (passed on to the program variant of each draw by setupObjectBlock()) ---*/
     p = Perspective(fovy, aspect, zNear, zFar);
-    glUniformMatrix4fv(projection, 1, GL_TRUE, p); // GL_TRUE: matrix is row-major
 
-    /*---  Set up and pass on ViewMatrix to the shader ---*/
-    mv = LookAt(eye, at, up);
-    glUniformMatrix4fv(model_view, 1, GL_TRUE, mv);
+    /*---  Set up the ViewMatrix and the frame-constant uniform blocks (lighting in the eye frame, fog) ---*/
+    view = AffineLookAt(eye, at, up);
+    mv = view;
+    setupLightingBlock();
+    setupFogBlock();
 
-    /*--- Set up the Rotation Matrix for the Sphere ---*/
-    R = Rotate(rotation_angle, rotation_axis.x, rotation_axis.y, rotation_axis.z);
+    /*--- Set up the Model Matrix of the Sphere: Translate(position) * R * M ---*/
+    quat orientation = rolling_status ? Quaternion(rotation_angle, rotation_axis.x, rotation_axis.y, rotation_axis.z) * Q : Q;
+    sphere_model = AffineTranslateRotate(position, orientation);
 
     // Store the current flag states of the program
     storeCurrentFlagStates();
 
     /*----- Set up and draw the axes -----*/
-    drawAxes(model_view);
+    drawAxes();
 
     /* ------------------------------------------------------------- */
     // Critical Section: Start  (Updated for HW 4; Blended Shadow)
     // 1. Disable Writing to  Z-Buffer
-    glDepthMask(GL_FALSE);
+    gl_state.depthMask(GL_FALSE);
 
     /*----- Set up and draw the plane -----*/
-    drawPlane(model_view);
+    drawPlane();
     /* ----------------------------------------------------------*/
 
     /*----- Set up and draw the shadow rendering -----*/
-    drawShadow(model_view);
+    drawShadow();
     /* ----------------------------------------------------------*/
 
     // 2. Enable Writing to Z-Buffer
-    glDepthMask(GL_TRUE);
+    gl_state.depthMask(GL_TRUE);
 
     // 3. Disable Writing to Frame Buffer
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    gl_state.colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
     /*----- Set up and draw the plane -----*/
-    drawPlane(model_view);
+    drawPlane();
     /* ----------------------------------------------------------*/
 
     // 4. Enable Writing to Frame Buffer
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    gl_state.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     // Critical Section: End
     /* ------------------------------------------------------------- */
     
     /*----- Set up the drawing for the sphere -----*/
-    drawSphere(model_view);
+    drawSphere();
 
     /*----- Set up and draw the fireworks, if enabled -----*/
     if (fireworks_flag == 1) {
@@ -1025,6 +1597,48 @@ void display(void)
     }
 
     glutSwapBuffers();
+
+    // Report the startup latency: first frame (placeholder sphere) and first frame of the loaded sphere
+    if (!first_frame_reported) {
+        cout << "Time to first frame: " << glutGet(GLUT_ELAPSED_TIME) - t_sphere_load_start << " ms\n";
+
+        // Cold start: all programs compiled; warm start: all loaded from the program cache
+        ProgramCounts program_counts = GetProgramCounts();
+        cout << "Shader programs to first frame: " << program_counts.compiled << " compiled in "
+             << program_counts.compile_ms << " ms, " << program_counts.loaded << " loaded from the program cache in "
+             << program_counts.load_ms << " ms\n";
+        first_frame_reported = true;
+    }
+    if (report_full_quality) {
+        cout << "Time to full quality: " << glutGet(GLUT_ELAPSED_TIME) - t_sphere_load_start << " ms\n";
+        report_full_quality = false;
+    }
+
+    // Report the level of detail of the sphere whenever it changes
+    if (sphere_lod != sphere_lod_reported) {
+        cout << "Sphere level of detail " << sphere_lod << " of " << sphere_lods.size() - 1 << ": "
+             << sphere_lods[sphere_lod].num_vertices / 3 << " triangles, "
+             << sphere_vertices_per_frame << " sphere vertices processed per frame\n";
+        sphere_lod_reported = sphere_lod;
+    }
+
+    // Report the GL state calls of the frame (issued, and dropped as redundant) whenever they change
+    GLStateCounts gl_state_counts = gl_state.endFrame();
+    if (gl_state_counts != gl_state_reported) {
+        cout << "GL state calls per frame: " << gl_state_counts.issued << " issued, "
+             << gl_state_counts.elided << " elided\n";
+        gl_state_reported = gl_state_counts;
+    }
+
+    // Report the shader program variants drawn with in the frame whenever they change
+    vector<unsigned> program_variants = programs.endFrame();
+    if (program_variants != program_variants_reported) {
+        cout << "Shader variants per frame: " << program_variants.size() << " of " << programs.numCompiled()
+             << " compiled (in " << programs.compileMilliseconds() << " ms)\n";
+        for (size_t i = 0; i < program_variants.size(); i++)
+            cout << "    " << programs.name(program_variants[i]) << "\n";
+        program_variants_reported = program_variants;
+    }
 }
 
 
@@ -1043,8 +1657,8 @@ void setNewDirection() {
 
 //----------------------------------------------------------------------------
 // idle(): 
-// Updates the position and rotation angle of the sphere, computes rotation matrix R, 
-// updates M based on R, and invokes new direction when reaching the end of the rolling segment.
+// Updates the position and rotation angle of the sphere, accumulates the rotation
+// into the quaternion Q, and invokes new direction when reaching the end of the rolling segment.
 //
 //----------------------------------------------------------------------------
 void idle(void) {
@@ -1053,8 +1667,8 @@ void idle(void) {
     rotation_angle += (GLfloat) ((distance / (2 * M_PI * sphere_radius)) * 360.0);
     if (rotation_angle > 4.0f) rotation_angle = 0.0f; // Limits rotation angle to slow down the speed of rotation on the sphere
     
-    mat4 R = Rotate(rotation_angle, rotation_axis.x, rotation_axis.y, rotation_axis.z); // Create R Matrix and update M with it.
-    M = R * M;
+    // Rotate Q by the rotation angle, and remove the rounding drift off unit length
+    Q = renormalize(Quaternion(rotation_angle, rotation_axis.x, rotation_axis.y, rotation_axis.z) * Q);
 
     // Check if the sphere reaches the next point
     vec4 nextPosition = positions[(current_segment + 1) % 3];
@@ -1321,6 +1935,7 @@ void reshape(int width, int height)
 {
     glViewport(0, 0, width, height);
     aspect = (GLfloat) width  / (GLfloat) height;
+    window_height = height;
     glutPostRedisplay();
 }
 
@@ -1363,6 +1978,7 @@ int main( int argc, char **argv )
     glutKeyboardFunc(keyboard);
     glutMouseFunc(mouse);
 
+    atexit(stopSphereLoad);  // join the sphere load worker however the program exits
     init();
 
     setNewDirection();  // Initialize the first movement direction
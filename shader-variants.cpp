@@ -0,0 +1,39 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- shader-variants.cpp ---
+//
+//   The #define lines and names of the variants of a ShaderVariants (see
+//   shader-variants.h).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "shader-variants.h"
+
+using namespace std;
+
+namespace Angel {
+
+string ShaderDefines( const ShaderOption options[], int num_options, const int values[] )
+{
+    string defines;
+    for (int i = 0; i < num_options; i++)
+	defines += string("#define ") + options[i].name + " " + to_string(values[i]) + "\n";
+    return defines;
+}
+
+string ShaderVariantName( const ShaderOption options[], int num_options, const int values[] )
+{
+    string name;
+    for (int i = 0; i < num_options; i++) {
+	if (values[i] == 0)
+	    continue;
+	if (!name.empty())
+	    name += " ";
+	name += options[i].name;
+	if (options[i].num_values > 2)
+	    name += "=" + to_string(values[i]);
+    }
+    return name.empty() ? "none" : name;
+}
+
+}  // namespace Angel
@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- shader-variants.h ---
+//
+//   Programs specialized on a set of options. Instead of branching at run
+//   time on uniform flags, the shaders test #defines (#if LIGHTING, #if
+//   FOG_TYPE == 2, ...), and each combination of option values in use is
+//   compiled into a program of its own that holds only the code of its
+//   paths.
+//
+//   A ShaderVariants keeps the programs compiled so far, keyed by their
+//   option values. get() returns the program of a combination, compiling
+//   it (or loading it from the program cache, see SetProgramCache()) the
+//   first time it is asked for, so that only the combinations that are
+//   drawn with are ever compiled. endFrame() returns the combinations
+//   used since its last call, for a report of the variants in use.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SHADER_VARIANTS_H__
+#define __SHADER_VARIANTS_H__
+
+#include "Angel-yjc.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Angel {
+
+//  An option of a ShaderVariants: the #define name of the shaders, with the
+//  values 0 .. num_values - 1 (0 or 1 for an on/off flag)
+struct ShaderOption {
+    const char*  name;
+    int          num_values;
+};
+
+//  The #define lines of the values[0 .. num_options - 1] of options. Every
+//  option is defined, as 0 if it is off, since #if cannot test an
+//  undefined name.
+std::string ShaderDefines( const ShaderOption options[], int num_options, const int values[] );
+
+//  The options whose value is not 0, e.g. "LIGHTING FOG_TYPE=2" ("none" if
+//  all of them are 0)
+std::string ShaderVariantName( const ShaderOption options[], int num_options, const int values[] );
+
+template <int NumUniforms, int NumAttributes>
+class ShaderVariants {
+public:
+    typedef ShaderProgram<NumUniforms, NumAttributes>  Program;
+
+    //  Called once with each new program, e.g. to bind its uniform blocks and
+    //  samplers
+    typedef void (*SetupFunction)( const Program& program );
+
+    //  The variants of the shader files, with the uniform and attribute
+    //  names of InitShader() and the options of the shaders; nothing is
+    //  compiled yet
+    template <int NumOptions>
+    ShaderVariants( const char* vertexShaderFile, const char* fragmentShaderFile,
+		    const char* const (&uniform_names)[NumUniforms],
+		    const char* const (&attribute_names)[NumAttributes],
+		    const ShaderOption (&options)[NumOptions], SetupFunction setup = NULL )
+	: vertex_shader_file(vertexShaderFile), fragment_shader_file(fragmentShaderFile),
+	  uniform_names(&uniform_names), attribute_names(&attribute_names),
+	  options(options, options + NumOptions), setup(setup), compile_ms(0.0) {}
+
+    int numOptions() const { return int(options.size()); }
+
+    //  The key of the option values values[0 .. numOptions() - 1]
+    unsigned key( const int values[] ) const
+	{
+	    unsigned k = 0;
+	    for (int i = 0; i < numOptions(); i++)
+		k = k * options[i].num_values + values[i];
+	    return k;
+	}
+
+    //  The program of the option values values[0 .. numOptions() - 1],
+    //  compiled now if it is the first time these values are asked for
+    const Program& get( const int values[] )
+	{
+	    unsigned k = key( values );
+	    typename std::map<unsigned, Variant>::iterator v = variants.find( k );
+	    if (v == variants.end())
+		v = variants.insert( std::make_pair(k, compile(values)) ).first;
+
+	    if (!v->second.used) {
+		v->second.used = true;
+		used.push_back( k );
+	    }
+	    return v->second.program;
+	}
+
+    //  The keys of the variants got since the last call, in increasing
+    //  order, then start collecting those of the next frame
+    std::vector<unsigned> endFrame()
+	{
+	    std::vector<unsigned> keys;
+	    keys.swap( used );
+	    for (size_t i = 0; i < keys.size(); i++)
+		variants[keys[i]].used = false;
+	    std::sort( keys.begin(), keys.end() );
+	    return keys;
+	}
+
+    //  The options of the variant of key k that are on (see ShaderVariantName())
+    std::string name( unsigned k ) const
+	{
+	    std::vector<int> values( numOptions() );
+	    for (int i = numOptions() - 1; i >= 0; i--) {
+		values[i] = k % options[i].num_values;
+		k /= options[i].num_values;
+	    }
+	    return ShaderVariantName( options.data(), numOptions(), values.data() );
+	}
+
+    //  The variants compiled (or loaded) so far, and the time it took
+    int numCompiled() const { return int(variants.size()); }
+    double compileMilliseconds() const { return compile_ms; }
+
+private:
+    struct Variant {
+	Program  program;
+	bool     used;    // got since the last endFrame()
+    };
+
+    Variant compile( const int values[] )
+	{
+	    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	    int loaded = GetProgramCounts().loaded;
+
+	    std::string defines = ShaderDefines( options.data(), numOptions(), values );
+	    Variant v;
+	    v.program = InitShader( vertex_shader_file, fragment_shader_file, *uniform_names,
+				    *attribute_names, defines.c_str() );
+	    v.used = false;
+	    if (setup != NULL)
+		setup( v.program );
+
+	    double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	    compile_ms += ms;
+	    printf("%s shader variant %s in %.1f ms\n\n",
+		   (GetProgramCounts().loaded > loaded) ? "Loaded" : "Compiled",
+		   ShaderVariantName( options.data(), numOptions(), values ).c_str(), ms);
+	    return v;
+	}
+
+    const char*                          vertex_shader_file;
+    const char*                          fragment_shader_file;
+    const char* const                  (*uniform_names)[NumUniforms];
+    const char* const                  (*attribute_names)[NumAttributes];
+    std::vector<ShaderOption>            options;
+    SetupFunction                        setup;
+
+    std::map<unsigned, Variant>          variants;
+    std::vector<unsigned>                used;    // keys got since the last endFrame()
+    double                               compile_ms;
+};
+
+}  // namespace Angel
+
+#endif // __SHADER_VARIANTS_H__
@@ -0,0 +1,1272 @@
+/************************************************************
+ * File: sphere-mesh.cpp
+
+ * Loading of the sphere triangle mesh for rotate-sphere-texture.cpp.
+
+ * The text sphere file (sphere.N.txt) is parsed once and converted into
+   a binary mesh cache "<fileName>.mesh" (see "sphere-mesh.h" for the layout).
+   Every later run memory-maps the cache and the position and normal blocks
+   are handed straight to glBufferData() with no per-vertex parsing.
+**************************************************************/
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/resource.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SPHERE_MESH_SSE2
+#  include <emmintrin.h>
+#endif
+
+#include "sphere-mesh.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+SphereMesh::SphereMesh() :
+    triangle_count(0), num_vertices(0), radius(0.0f),
+    points(NULL), smooth_normals(NULL),
+    map_base(NULL), map_size(0)
+#ifdef _WIN32
+    , map_file(NULL), map_handle(NULL)
+#endif
+{}
+
+//----------------------------------------------------------------------------
+// findRadius(points):
+// Finds the max radius of a sphere file, i.e., the maximum distance of
+// any of its vertices' points to the origin.
+//
+//----------------------------------------------------------------------------
+static GLfloat findRadius(const vector<point4>& points) {
+    float max_radius = 0.0f;
+    for (const point4& sp : points) {
+        max_radius = max(sqrt(sp.x * sp.x + sp.y * sp.y + sp.z * sp.z), max_radius);
+    }
+    return max_radius;
+}
+
+//----------------------------------------------------------------------------
+// readSphereFile(fileName, points, smooth_normals):
+// Reads a file in the appropriate vertex format to populate the points
+// and their per-vertex (smooth) normals.
+//
+//----------------------------------------------------------------------------
+bool readSphereFile(const string& fileName, vector<point4>& points, vector<vec3>& smooth_normals)
+{
+        ifstream file(fileName);
+
+        if (!file) {
+            cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
+            return false;
+        }
+
+        // Triangle count from file
+        int triangleCount;
+        file >> triangleCount;
+
+        points.reserve(3 * triangleCount);
+        smooth_normals.reserve(3 * triangleCount);
+
+        // Initialize coordinate variables for each triangle
+        float x, y, z;
+
+        // Vertices in the Triangle (Should be 3)
+        int n;
+
+        for (int i = 0; i < triangleCount; i++) {
+            file >> n;
+
+            if (!file) {  // malformed or out of range number, or truncated file
+                cerr << "Error: Sphere file has no valid triangle " << i << ": " << fileName << "\n";
+                return false;
+            }
+
+            if (n != 3) {  // rejected, like the streaming loader does
+                cerr << "Error: Expected triangle but found a different shape, with a vertex count of: " << n << "\n";
+                return false;
+            }
+
+            for (int j = 0; j < 3; j++) {
+                file >> x >> y >> z;
+                if (!file) {
+                    cerr << "Error: Sphere file has no valid triangle " << i << ": " << fileName << "\n";
+                    return false;
+                }
+                points.push_back(point4(x, y, z, 1.0f));
+
+                // Compute per-vertex normal for smooth shading
+                vec3 normal = normalize(vec3(x, y, z));
+                smooth_normals.push_back(normal);
+            }
+        }
+
+        file.close();
+        return true;
+}
+
+//----------------------------------------------------------------------------
+// attachArrays(mesh, base):
+// Points the position and normal arrays of mesh into the cache image at base
+// (the header followed by the points and smooth normal blocks).
+//
+//----------------------------------------------------------------------------
+static void attachArrays(SphereMesh& mesh, const char* base)
+{
+    const SphereMeshHeader* header = (const SphereMeshHeader*) base;
+
+    mesh.triangle_count = header->triangle_count;
+    mesh.num_vertices = 3 * header->triangle_count;
+    mesh.radius = header->radius;
+
+    const char* data = base + sizeof(SphereMeshHeader);
+    mesh.points = (const point4*) data;
+    mesh.smooth_normals = (const vec3*) (data + mesh.num_vertices * sizeof(point4));
+}
+
+//----------------------------------------------------------------------------
+// cacheImageSize(triangle_count):
+// Returns the size in bytes of a cache file holding triangle_count triangles.
+//
+//----------------------------------------------------------------------------
+static size_t cacheImageSize(uint64_t triangle_count)
+{
+    return sizeof(SphereMeshHeader) + 3 * triangle_count * (sizeof(point4) + sizeof(vec3));
+}
+
+//----------------------------------------------------------------------------
+// initCacheImage(mesh, triangle_count):
+// Allocates mesh.storage for triangle_count triangles, fills in the header
+// (the source file fields are left to the caller) and attaches the arrays.
+//
+//----------------------------------------------------------------------------
+static SphereMeshHeader* initCacheImage(SphereMesh& mesh, uint32_t triangle_count)
+{
+    mesh.storage.assign(cacheImageSize(triangle_count), 0);
+
+    SphereMeshHeader* header = (SphereMeshHeader*) mesh.storage.data();
+    memcpy(header->magic, SphereMeshMagic, sizeof(SphereMeshMagic));
+    header->version = SphereMeshVersion;
+    header->triangle_count = triangle_count;
+
+    attachArrays(mesh, mesh.storage.data());
+    return header;
+}
+
+//----------------------------------------------------------------------------
+// buildCacheImage(points, smooth_normals, mesh):
+// Lays out the arrays produced by readSphereFile() in mesh.storage as the
+// cache file holds them.
+//
+//----------------------------------------------------------------------------
+static void buildCacheImage(const vector<point4>& points, const vector<vec3>& smooth_normals, SphereMesh& mesh)
+{
+    SphereMeshHeader* header = initCacheImage(mesh, (uint32_t) (points.size() / 3));
+    header->radius = findRadius(points);
+    mesh.radius = header->radius;
+
+    memcpy((void*) mesh.points, points.data(), points.size() * sizeof(point4));
+    memcpy((void*) mesh.smooth_normals, smooth_normals.data(), smooth_normals.size() * sizeof(vec3));
+}
+
+//----------------------------------------------------------------------------
+//
+//  Fused ingest kernel
+//
+//  The parsers only store the points; ingestSphereTriangles() then derives
+//  the smooth normals and the radius from them in a single pass. With SSE2,
+//  4 triangles are processed at a time: vertex j of the 4 triangles is
+//  transposed into x, y and z registers, so that every lane evaluates
+//  exactly the same float operations as normalize() and findRadius() (the
+//  results are bit-identical to readSphereFile()).
+//
+
+#ifdef SPHERE_MESH_SSE2
+// Loads vertex j of 4 consecutive triangles (p points to that of the first) as x, y, z lanes
+static inline void loadVertices(const float* p, __m128& x, __m128& y, __m128& z)
+{
+    __m128 r0 = _mm_loadu_ps(p);
+    __m128 r1 = _mm_loadu_ps(p + 12);
+    __m128 r2 = _mm_loadu_ps(p + 24);
+    __m128 r3 = _mm_loadu_ps(p + 36);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    x = r0;  y = r1;  z = r2;
+}
+
+// Normalizes the 4 vectors (x, y, z) as normalize() does; returns their lengths
+static inline __m128 normalize4(__m128& x, __m128& y, __m128& z)
+{
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), length);
+    x = _mm_mul_ps(x, r);
+    y = _mm_mul_ps(y, r);
+    z = _mm_mul_ps(z, r);
+    return length;
+}
+
+// Stores the x, y, z lanes of v at p
+static inline void store3(float* p, __m128 v)
+{
+    _mm_storel_pi((__m64*) p, v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+#endif
+
+//----------------------------------------------------------------------------
+// ingestSphereTriangles(points, triangle_count, smooth_normals, radius):
+// Computes the per-vertex (smooth) normals of triangle_count triangles from
+// their points, and raises radius to the maximum distance of a point to the
+// origin.
+//
+//----------------------------------------------------------------------------
+void ingestSphereTriangles(const point4* points, size_t triangle_count,
+                           vec3* smooth_normals, GLfloat& radius)
+{
+    size_t k = 0;
+
+#ifdef SPHERE_MESH_SSE2
+    __m128 max_length = _mm_set1_ps(radius);
+
+    for (; k + 4 <= triangle_count; k += 4) {
+        const float* p = (const float*) (points + 3 * k);
+        float* smooth = (float*) (smooth_normals + 3 * k);
+
+        // Vertices a, b, c of the 4 triangles
+        __m128 ax, ay, az, bx, by, bz, cx, cy, cz;
+        loadVertices(p, ax, ay, az);
+        loadVertices(p + 4, bx, by, bz);
+        loadVertices(p + 8, cx, cy, cz);
+
+        // Vertex normals: normalize(point); their lengths give the radius
+        max_length = _mm_max_ps(normalize4(ax, ay, az), max_length);
+        max_length = _mm_max_ps(normalize4(bx, by, bz), max_length);
+        max_length = _mm_max_ps(normalize4(cx, cy, cz), max_length);
+
+        // Back to one (x, y, z, 0) register per triangle
+        __m128 zero = _mm_setzero_ps();
+        __m128 aw = zero, bw = zero, cw = zero;
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+        _MM_TRANSPOSE4_PS(cx, cy, cz, cw);
+        __m128 a[4] = { ax, ay, az, aw }, b[4] = { bx, by, bz, bw };
+        __m128 c[4] = { cx, cy, cz, cw };
+
+        // In address order, so that the 4th lane of each 16-byte store is overwritten by the next one
+        for (int t = 0; t < 4; t++) {
+            _mm_storeu_ps(smooth + 9 * t, a[t]);
+            _mm_storeu_ps(smooth + 9 * t + 3, b[t]);
+            store3(smooth + 9 * t + 6, c[t]);
+        }
+    }
+
+    float lengths[4];
+    _mm_storeu_ps(lengths, max_length);
+    radius = max(max(lengths[0], lengths[1]), max(lengths[2], lengths[3]));
+#endif
+
+    // The remaining triangles (all of them without SSE2)
+    for (; k < triangle_count; k++) {
+        const point4* vertices = points + 3 * k;
+
+        for (int j = 0; j < 3; j++) {
+            vec3 point(vertices[j].x, vertices[j].y, vertices[j].z);
+            smooth_normals[3 * k + j] = normalize(point);   // per-vertex normal for smooth shading
+
+            radius = max(sqrt(point.x * point.x + point.y * point.y + point.z * point.z), radius);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+//
+//  Chunked multithreaded text parser
+//
+//  The whole file is read in one go and split into line-aligned chunks of
+//  about ParseChunkSize bytes. The worker threads first count the numbers
+//  (tokens) in each chunk; a prefix sum then tells every chunk which
+//  triangle it starts at, since each triangle is exactly 10 tokens
+//  ("3" followed by 3 x 3 coordinates). In the second pass every chunk
+//  parses its triangles with std::from_chars straight into the cache image.
+//
+
+const size_t ParseChunkSize = 1 << 20;
+const int    TokensPerTriangle = 10;
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+static inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isSpace(*p)) ++p;
+    return p;
+}
+
+//----------------------------------------------------------------------------
+// parseNumber(p, end, value):
+// Parses the number token at p into value, accepting a leading '+' as
+// operator >> does (from_chars does not). Returns the position behind it,
+// or NULL if the token is not a number, is out of range for value, or has
+// trailing characters.
+//
+//----------------------------------------------------------------------------
+template <typename T>
+static inline const char* parseNumber(const char* p, const char* end, T& value) {
+    if (p < end && *p == '+' && (p + 1 == end || p[1] != '-')) ++p;
+    from_chars_result result = from_chars(p, end, value);
+    if (result.ec != errc() || (result.ptr < end && !isSpace(*result.ptr)))
+        return NULL;
+    return result.ptr;
+}
+
+//----------------------------------------------------------------------------
+// storePoints(v, points):
+// Stores the 9 coordinates v of a triangle as its 3 points.
+//
+//----------------------------------------------------------------------------
+static inline void storePoints(const float v[9], point4* points)
+{
+    for (int j = 0; j < 3; j++) {
+        points[j] = point4(v[3 * j], v[3 * j + 1], v[3 * j + 2], 1.0f);
+    }
+}
+
+//----------------------------------------------------------------------------
+// parallelFor(count, func):
+// Runs func(i) for i = 0, ..., count - 1 on a pool of worker threads that
+// pull the indices from a shared counter.
+//
+//----------------------------------------------------------------------------
+template <typename Func>
+static void parallelFor(size_t count, Func func)
+{
+    size_t num_threads = max(1u, thread::hardware_concurrency());
+    num_threads = min(num_threads, count);
+
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+            func(i);
+    };
+
+    vector<thread> pool;
+    for (size_t t = 1; t < num_threads; t++)
+        pool.push_back(thread(worker));
+    worker();
+    for (thread& t : pool)
+        t.join();
+}
+
+//----------------------------------------------------------------------------
+// readWholeFile(fileName, text):
+// Reads the whole file into text in a single call.
+//
+//----------------------------------------------------------------------------
+static bool readWholeFile(const string& fileName, vector<char>& text)
+{
+    ifstream file(fileName, ios::binary | ios::ate);
+    if (!file)
+        return false;
+
+    streamoff size = file.tellg();
+    file.seekg(0);
+    text.resize((size_t) size);
+    return (bool) file.read(text.data(), size);
+}
+
+//----------------------------------------------------------------------------
+// parseSphereFile(fileName, mesh):
+// Parses the text sphere file with the chunked multithreaded parser into
+// the cache image held in mesh.storage (see "sphere-mesh.h").
+// Files that are not pure triangle lists are handed to readSphereFile().
+//
+//----------------------------------------------------------------------------
+bool parseSphereFile(const string& fileName, SphereMesh& mesh)
+{
+    vector<char> text;
+    if (!readWholeFile(fileName, text)) {
+        cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
+        return false;
+    }
+
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    // Triangle count from file
+    int triangleCount = 0;
+    const char* p = parseNumber(skipSpace(begin, end), end, triangleCount);
+    if (p == NULL || triangleCount < 0) {
+        cerr << "Error: Sphere file has no triangle count: " << fileName << "\n";
+        return false;
+    }
+
+    // Split the rest of the file into line-aligned chunks
+    vector<const char*> chunks;
+    chunks.push_back(p);
+    while (end - chunks.back() > (ptrdiff_t) ParseChunkSize) {
+        const char* cut = (const char*) memchr(chunks.back() + ParseChunkSize, '\n',
+                                               end - chunks.back() - ParseChunkSize);
+        if (cut == NULL) break;
+        chunks.push_back(cut + 1);
+    }
+    chunks.push_back(end);
+    size_t num_chunks = chunks.size() - 1;
+
+    // Pass 1: count the tokens of each chunk
+    vector<size_t> first_token(num_chunks + 1, 0);
+    parallelFor(num_chunks, [&](size_t c) {
+        size_t tokens = 0;
+        for (const char* q = skipSpace(chunks[c], chunks[c + 1]); q < chunks[c + 1];
+             q = skipSpace(skipToken(q, chunks[c + 1]), chunks[c + 1]))
+            tokens++;
+        first_token[c + 1] = tokens;
+    });
+    for (size_t c = 0; c < num_chunks; c++)
+        first_token[c + 1] += first_token[c];
+
+    if (first_token[num_chunks] < (size_t) triangleCount * TokensPerTriangle) {
+        cerr << "Error: Sphere file is truncated: " << fileName << "\n";
+        return false;
+    }
+
+    initCacheImage(mesh, (uint32_t) triangleCount);
+    point4* out_points = (point4*) mesh.points;
+    vec3* out_smooth = (vec3*) mesh.smooth_normals;
+
+    // Pass 2: parse the triangles that start in each chunk
+    vector<GLfloat> chunk_radius(num_chunks, 0.0f);
+    atomic<bool> malformed(false);  // a record that is not 3 vertices of valid numbers
+    parallelFor(num_chunks, [&](size_t c) {
+        size_t k = (first_token[c] + TokensPerTriangle - 1) / TokensPerTriangle;
+        const char* q = skipSpace(chunks[c], end);
+        for (size_t skip = k * TokensPerTriangle - first_token[c]; skip > 0; skip--)
+            q = skipSpace(skipToken(q, end), end);
+
+        size_t first = k;
+        for (; k < (size_t) triangleCount && k * TokensPerTriangle < first_token[c + 1]; k++) {
+            // Vertices in the Triangle (Should be 3)
+            int n = 0;
+            q = parseNumber(q, end, n);
+            if (q == NULL || n != 3) {
+                malformed = true;
+                return;
+            }
+
+            float v[9];
+            for (int j = 0; j < 9; j++) {
+                q = parseNumber(skipSpace(q, end), end, v[j]);
+                if (q == NULL) {
+                    malformed = true;
+                    return;
+                }
+            }
+            q = skipSpace(q, end);
+
+            storePoints(v, out_points + 3 * k);
+        }
+
+        // Normals and radius of the chunk's triangles while their points are still in the cache
+        ingestSphereTriangles(out_points + 3 * first, k - first, out_smooth + 3 * first, chunk_radius[c]);
+    });
+
+    if (malformed) {
+        // Fall back to the stream parser, which reports the bad record
+        vector<point4> points;
+        vector<vec3> smooth_normals;
+        if (!readSphereFile(fileName, points, smooth_normals))
+            return false;
+        buildCacheImage(points, smooth_normals, mesh);
+        return true;
+    }
+
+    SphereMeshHeader* header = (SphereMeshHeader*) mesh.storage.data();
+    for (size_t c = 0; c < num_chunks; c++)
+        header->radius = max(header->radius, chunk_radius[c]);
+    mesh.radius = header->radius;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// statSourceFile(fileName, header):
+// Records the size and modification time of the text sphere file in header,
+// so that a stale cache (text file edited after conversion) is detected.
+//
+//----------------------------------------------------------------------------
+static bool statSourceFile(const string& fileName, SphereMeshHeader& header)
+{
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0)
+        return false;
+
+    header.source_size = (uint64_t) st.st_size;
+    header.source_mtime = (int64_t) st.st_mtime;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// unmapSphereCache(mesh):
+// Releases the memory mapping of the cache file (if any) held by mesh.
+//
+//----------------------------------------------------------------------------
+static void unmapSphereCache(SphereMesh& mesh)
+{
+#ifdef _WIN32
+    if (mesh.map_base != NULL) UnmapViewOfFile(mesh.map_base);
+    if (mesh.map_handle != NULL) CloseHandle((HANDLE) mesh.map_handle);
+    if (mesh.map_file != NULL) CloseHandle((HANDLE) mesh.map_file);
+    mesh.map_handle = NULL;
+    mesh.map_file = NULL;
+#else
+    if (mesh.map_base != NULL) munmap(mesh.map_base, mesh.map_size);
+#endif
+    mesh.map_base = NULL;
+    mesh.map_size = 0;
+}
+
+//----------------------------------------------------------------------------
+// validCacheHeader(header, source, file_size):
+// Returns true if header is the header of an up-to-date cache file of
+// file_size bytes built from the text file described by source.
+//
+//----------------------------------------------------------------------------
+static bool validCacheHeader(const SphereMeshHeader& header, const SphereMeshHeader& source, size_t file_size)
+{
+    return memcmp(header.magic, SphereMeshMagic, sizeof(SphereMeshMagic)) == 0 &&
+           header.version == SphereMeshVersion &&
+           header.source_size == source.source_size &&
+           header.source_mtime == source.source_mtime &&
+           file_size == cacheImageSize(header.triangle_count);
+}
+
+//----------------------------------------------------------------------------
+// mapSphereCache(cacheName, source, mesh):
+// Memory-maps the binary cache file cacheName into mesh. The cache is only
+// accepted if its header matches the text file described by source;
+// otherwise false is returned and the text file must be converted again.
+//
+//----------------------------------------------------------------------------
+static bool mapSphereCache(const string& cacheName, const SphereMeshHeader& source, SphereMesh& mesh)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(cacheName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+
+    HANDLE handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* base = (handle != NULL) ? MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+    mesh.map_file = file;
+    mesh.map_handle = handle;
+    mesh.map_base = base;
+    mesh.map_size = (size_t) size.QuadPart;
+#else
+    int fd = open(cacheName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* base = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) base = NULL;
+    }
+    close(fd); // The mapping stays valid after the descriptor is closed
+
+    mesh.map_base = base;
+    mesh.map_size = (base != NULL) ? (size_t) st.st_size : 0;
+#endif
+
+    if (mesh.map_base == NULL) {
+        unmapSphereCache(mesh);
+        return false;
+    }
+
+    // Validate the header against the text file and the size of the mapping
+    if (mesh.map_size < sizeof(SphereMeshHeader) ||
+        !validCacheHeader(*(const SphereMeshHeader*) mesh.map_base, source, mesh.map_size)) {
+        unmapSphereCache(mesh);
+        return false;
+    }
+
+    attachArrays(mesh, (const char*) mesh.map_base);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// convertSphereFile(fileName, cacheName, source, mesh):
+// Parses the text sphere file into the cache image in mesh.storage and
+// writes it out to cacheName for the next run.
+//
+//----------------------------------------------------------------------------
+static bool convertSphereFile(const string& fileName, const string& cacheName,
+                              const SphereMeshHeader& source, SphereMesh& mesh)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    if (!parseSphereFile(fileName, mesh))
+        return false;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Parsed " << mesh.triangle_count << " triangles (" << source.source_size / 1.0e6
+         << " MB) in " << 1000.0 * seconds << " ms\n";
+
+    SphereMeshHeader* header = (SphereMeshHeader*) mesh.storage.data();
+    header->source_size = source.source_size;
+    header->source_mtime = source.source_mtime;
+
+    ofstream cache(cacheName, ios::binary | ios::trunc);
+    if (!cache.write(mesh.storage.data(), mesh.storage.size())) {
+        // Not fatal: the mesh is still usable from memory for this run
+        cerr << "Warning: Sphere cache could not be written: " << cacheName << "\n";
+        cache.close();
+        remove(cacheName.c_str());
+    }
+    else {
+        cout << "Converted " << fileName << " into binary mesh cache " << cacheName << "\n";
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+//
+//  Bounded-memory streaming load
+//
+//  Spheres too large to be held in memory are read through a window of
+//  StreamTextSize bytes that slides over the text file. Only the tokens in
+//  front of the last whitespace in the window are known to be complete; the
+//  triangles parsed from them are gathered into a staging chunk of
+//  SphereStreamChunkTriangles triangles, which is handed to the caller and
+//  written to its place in the binary cache before the next one is parsed.
+//  An up-to-date cache is read back chunk by chunk in the same way.
+//
+
+const size_t StreamTextSize = 1 << 20;
+
+//----------------------------------------------------------------------------
+// sphereFileTriangleCount(fileName):
+// Returns the triangle count on the first line of the sphere file, or -1.
+//
+//----------------------------------------------------------------------------
+int sphereFileTriangleCount(const string& fileName)
+{
+    ifstream file(fileName);
+
+    int triangleCount;
+    if (!(file >> triangleCount) || triangleCount < 0)
+        return -1;
+    return triangleCount;
+}
+
+//----------------------------------------------------------------------------
+// cacheChunkOffsets(triangle_count, first_triangle, offsets):
+// Computes the file offsets of the points and smooth normals of triangle
+// first_triangle in the cache of a triangle_count triangle mesh.
+//
+//----------------------------------------------------------------------------
+static void cacheChunkOffsets(uint64_t triangle_count, uint64_t first_triangle, streamoff offsets[2])
+{
+    uint64_t num_vertices = 3 * triangle_count;
+    uint64_t first_vertex = 3 * first_triangle;
+
+    offsets[0] = sizeof(SphereMeshHeader) + first_vertex * sizeof(point4);
+    offsets[1] = sizeof(SphereMeshHeader) + num_vertices * sizeof(point4) + first_vertex * sizeof(vec3);
+}
+
+//----------------------------------------------------------------------------
+// writeCacheChunk(cache, triangle_count, chunk):
+// Writes the arrays of chunk to their places in the cache file.
+//
+//----------------------------------------------------------------------------
+static bool writeCacheChunk(ofstream& cache, uint64_t triangle_count, const SphereMeshChunk& chunk)
+{
+    streamoff offsets[2];
+    cacheChunkOffsets(triangle_count, chunk.first_triangle, offsets);
+
+    size_t num_vertices = 3 * (size_t) chunk.triangle_count;
+    cache.seekp(offsets[0]).write((const char*) chunk.points, num_vertices * sizeof(point4));
+    cache.seekp(offsets[1]).write((const char*) chunk.smooth_normals, num_vertices * sizeof(vec3));
+    return (bool) cache;
+}
+
+//----------------------------------------------------------------------------
+// refillWindow(file, text, p, end, cut):
+// Moves the unparsed text [p, end) to the front of the window and fills the
+// rest of it from file. cut is set behind the last whitespace (or to end at
+// the end of the file): every token before cut is complete.
+// Returns false if no more complete tokens could be read.
+//
+//----------------------------------------------------------------------------
+static bool refillWindow(ifstream& file, vector<char>& text, const char*& p, const char*& end, const char*& cut)
+{
+    size_t tail = end - p;
+    size_t complete = cut - p;
+    if (tail == text.size())
+        return false;  // a single token larger than the window
+
+    memmove(text.data(), p, tail);
+    file.read(text.data() + tail, text.size() - tail);
+    size_t count = (size_t) file.gcount();
+
+    p = text.data();
+    end = p + tail + count;
+    cut = end;
+    if (!file.eof()) {
+        while (cut > p && !isSpace(cut[-1])) --cut;
+    }
+    return cut > p + complete;  // more complete tokens than before
+}
+
+//----------------------------------------------------------------------------
+// parseTriangleTokens(q, cut, n, v):
+// Parses the vertex count n and the 9 coordinates v of the triangle at q.
+// Returns the position behind it, or NULL if the triangle does not end
+// before cut (n is set to 0 on a malformed or out of range number).
+//
+//----------------------------------------------------------------------------
+static const char* parseTriangleTokens(const char* q, const char* cut, int& n, float v[9])
+{
+    q = skipSpace(q, cut);
+    if (q == cut)
+        return NULL;
+
+    const char* next = parseNumber(q, cut, n);
+    if (next == NULL) {
+        n = 0;
+        return q;
+    }
+    q = next;
+
+    for (int j = 0; j < 9; j++) {
+        q = skipSpace(q, cut);
+        if (q == cut)
+            return NULL;
+
+        next = parseNumber(q, cut, v[j]);
+        if (next == NULL) {
+            n = 0;
+            return q;
+        }
+        q = next;
+    }
+    return q;
+}
+
+//----------------------------------------------------------------------------
+// streamSphereCache(cacheName, source, begin, chunk, staged, radius, valid):
+// Reads the cache file cacheName chunk by chunk into the staging arrays of
+// staged. valid is set to false (and nothing is read) if the cache is
+// missing or stale.
+//
+//----------------------------------------------------------------------------
+static bool streamSphereCache(const string& cacheName, const SphereMeshHeader& source,
+                              const function<void (int)>& begin,
+                              const function<bool (const SphereMeshChunk&)>& chunk,
+                              SphereMeshChunk& staged, GLfloat& radius, bool& valid)
+{
+    valid = false;
+
+    ifstream cache(cacheName, ios::binary | ios::ate);
+    if (!cache)
+        return false;
+
+    size_t file_size = (size_t) cache.tellg();
+    cache.seekg(0);
+
+    SphereMeshHeader header;
+    if (file_size < sizeof(SphereMeshHeader) || !cache.read((char*) &header, sizeof(header)) ||
+        !validCacheHeader(header, source, file_size))
+        return false;
+
+    valid = true;
+    radius = header.radius;
+    begin((int) header.triangle_count);
+
+    for (uint32_t first = 0; first < header.triangle_count; first += staged.triangle_count) {
+        staged.first_triangle = (int) first;
+        staged.triangle_count = (int) min((uint32_t) SphereStreamChunkTriangles, header.triangle_count - first);
+
+        streamoff offsets[2];
+        cacheChunkOffsets(header.triangle_count, first, offsets);
+
+        size_t num_vertices = 3 * (size_t) staged.triangle_count;
+        cache.seekg(offsets[0]).read((char*) staged.points, num_vertices * sizeof(point4));
+        cache.seekg(offsets[1]).read((char*) staged.smooth_normals, num_vertices * sizeof(vec3));
+        if (!cache) {
+            cerr << "Error: Sphere cache could not be read: " << cacheName << "\n";
+            return false;
+        }
+
+        if (!chunk(staged))
+            return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// streamSphereText(fileName, cacheName, source, begin, chunk, staged, radius):
+// Parses the text sphere file through the sliding window, one staging chunk
+// at a time, and writes each chunk to the cache file cacheName as well.
+//
+//----------------------------------------------------------------------------
+static bool streamSphereText(const string& fileName, const string& cacheName, const SphereMeshHeader& source,
+                             const function<void (int)>& begin,
+                             const function<bool (const SphereMeshChunk&)>& chunk,
+                             SphereMeshChunk& staged, GLfloat& radius)
+{
+    ifstream file(fileName, ios::binary);
+    vector<char> text(StreamTextSize);
+    const char* p = text.data();
+    const char* end = p;
+    const char* cut = p;
+
+    if (!file || !refillWindow(file, text, p, end, cut)) {
+        cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
+        return false;
+    }
+
+    // Triangle count from file
+    int triangleCount = 0;
+    p = parseNumber(skipSpace(p, cut), cut, triangleCount);
+    if (p == NULL || triangleCount < 0) {
+        cerr << "Error: Sphere file has no triangle count: " << fileName << "\n";
+        return false;
+    }
+
+    begin(triangleCount);
+
+    // The header is written last, so an interrupted conversion leaves no valid cache
+    SphereMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    ofstream cache(cacheName, ios::binary | ios::trunc);
+    bool cache_ok = (bool) cache.write((const char*) &header, sizeof(header));
+
+    radius = 0.0f;
+    staged.first_triangle = 0;
+    staged.triangle_count = 0;
+    while (staged.first_triangle + staged.triangle_count < triangleCount) {
+        // Vertices in the Triangle (Should be 3)
+        int n = 0;
+        float v[9];
+        const char* next = parseTriangleTokens(p, cut, n, v);
+        if (next == NULL) {
+            if (refillWindow(file, text, p, end, cut))
+                continue;
+            cerr << "Error: Sphere file is truncated: " << fileName << "\n";
+            cache.close();
+            remove(cacheName.c_str());
+            return false;
+        }
+        if (n != 3) {
+            cerr << "Error: Expected triangle but found a different shape, with a vertex count of: " << n << "\n";
+            cache.close();
+            remove(cacheName.c_str());
+            return false;
+        }
+        p = next;
+
+        storePoints(v, (point4*) staged.points + 3 * (size_t) staged.triangle_count);
+
+        if (++staged.triangle_count == SphereStreamChunkTriangles ||
+            staged.first_triangle + staged.triangle_count == triangleCount) {
+            ingestSphereTriangles(staged.points, staged.triangle_count, (vec3*) staged.smooth_normals, radius);
+            if (!chunk(staged)) {
+                cache.close();
+                remove(cacheName.c_str());
+                return false;
+            }
+            if (cache_ok)
+                cache_ok = writeCacheChunk(cache, triangleCount, staged);
+
+            staged.first_triangle += staged.triangle_count;
+            staged.triangle_count = 0;
+        }
+    }
+
+    memcpy(header.magic, SphereMeshMagic, sizeof(SphereMeshMagic));
+    header.version = SphereMeshVersion;
+    header.triangle_count = (uint32_t) triangleCount;
+    header.radius = radius;
+    header.source_size = source.source_size;
+    header.source_mtime = source.source_mtime;
+    if (cache_ok)
+        cache_ok = (bool) cache.seekp(0).write((const char*) &header, sizeof(header));
+    cache.close();
+
+    if (!cache_ok) {
+        // Not fatal: the chunks have already been handed out
+        cerr << "Warning: Sphere cache could not be written: " << cacheName << "\n";
+        remove(cacheName.c_str());
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// streamSphereFile(fileName, begin, chunk, radius, staging_bytes):
+// Loads the sphere chunk by chunk from its binary cache if that is up to
+// date, otherwise from the text file; see "sphere-mesh.h".
+//
+//----------------------------------------------------------------------------
+bool streamSphereFile(const string& fileName, const function<void (int)>& begin,
+                      const function<bool (const SphereMeshChunk&)>& chunk,
+                      GLfloat& radius, size_t* staging_bytes)
+{
+    SphereMeshHeader source;
+    if (!statSourceFile(fileName, source)) {
+        cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
+        return false;
+    }
+
+    // The only per-mesh memory: one chunk of points and normals (plus the text window)
+    vector<point4> points(3 * SphereStreamChunkTriangles);
+    vector<vec3> smooth_normals(3 * SphereStreamChunkTriangles);
+    SphereMeshChunk staged = { 0, 0, points.data(), smooth_normals.data() };
+    size_t staged_bytes = 3 * SphereStreamChunkTriangles * (sizeof(point4) + sizeof(vec3));
+
+    string cacheName = fileName + ".mesh";
+    bool cached;
+    bool ok = streamSphereCache(cacheName, source, begin, chunk, staged, radius, cached);
+    if (!cached) {
+        ok = streamSphereText(fileName, cacheName, source, begin, chunk, staged, radius);
+        staged_bytes += StreamTextSize;
+    }
+    if (!ok)
+        return false;
+
+    if (staging_bytes != NULL)
+        *staging_bytes = staged_bytes;
+    return true;
+}
+
+//----------------------------------------------------------------------------
+//
+//  Procedural icosphere
+//
+//  The 12 vertices and 20 faces (counter-clockwise seen from outside) of the
+//  regular icosahedron; each face is subdivided "level" times into 4 faces
+//  whose new vertices are pushed out onto the unit sphere.
+//
+
+const GLfloat IcoT = 1.6180339887f;  // golden ratio
+
+const point3 IcoVertices[12] = {
+    point3(-1.0f,  IcoT,  0.0f), point3( 1.0f,  IcoT,  0.0f), point3(-1.0f, -IcoT,  0.0f), point3( 1.0f, -IcoT,  0.0f),
+    point3( 0.0f, -1.0f,  IcoT), point3( 0.0f,  1.0f,  IcoT), point3( 0.0f, -1.0f, -IcoT), point3( 0.0f,  1.0f, -IcoT),
+    point3( IcoT,  0.0f, -1.0f), point3( IcoT,  0.0f,  1.0f), point3(-IcoT,  0.0f, -1.0f), point3(-IcoT,  0.0f,  1.0f)
+};
+
+const int IcoFaces[20][3] = {
+    { 0, 11,  5 }, { 0,  5,  1 }, { 0,  1,  7 }, { 0,  7, 10 }, { 0, 10, 11 },
+    { 1,  5,  9 }, { 5, 11,  4 }, { 11, 10, 2 }, { 10, 7,  6 }, { 7,  1,  8 },
+    { 3,  9,  4 }, { 3,  4,  2 }, { 3,  2,  6 }, { 3,  6,  8 }, { 3,  8,  9 },
+    { 4,  9,  5 }, { 2,  4, 11 }, { 6,  2, 10 }, { 8,  6,  7 }, { 9,  8,  1 }
+};
+
+const int MaxIcosphereLevel = 12;  // 20 * 4^12 = 335M triangles
+
+//----------------------------------------------------------------------------
+// subdivideFace(a, b, c, level, radius, mesh, k):
+// Writes the 4^level triangles of the unit-sphere face (a, b, c), scaled to
+// radius, into the arrays of mesh, starting at triangle k. The smooth
+// normals are the unit positions themselves.
+//
+//----------------------------------------------------------------------------
+static void subdivideFace(const point3& a, const point3& b, const point3& c, int level,
+                          GLfloat radius, SphereMesh& mesh, size_t& k)
+{
+    if (level > 0) {
+        point3 ab = normalize(a + b);
+        point3 bc = normalize(b + c);
+        point3 ca = normalize(c + a);
+        subdivideFace(a, ab, ca, level - 1, radius, mesh, k);
+        subdivideFace(ab, b, bc, level - 1, radius, mesh, k);
+        subdivideFace(ca, bc, c, level - 1, radius, mesh, k);
+        subdivideFace(ab, bc, ca, level - 1, radius, mesh, k);
+        return;
+    }
+
+    point4* points = (point4*) mesh.points + 3 * k;
+    vec3* smooth_normals = (vec3*) mesh.smooth_normals + 3 * k;
+
+    const point3* vertices[3] = { &a, &b, &c };
+    for (int j = 0; j < 3; j++) {
+        points[j] = point4(*vertices[j] * radius, 1.0f);
+        smooth_normals[j] = *vertices[j];
+    }
+    k++;
+}
+
+//----------------------------------------------------------------------------
+// generateIcosphere(level, mesh, radius):
+// Generates an icosphere of 20 * 4^level triangles straight into the
+// cache image held in mesh.storage (the same layout as parseSphereFile()),
+// one base face of the icosahedron per worker thread.
+//
+//----------------------------------------------------------------------------
+bool generateIcosphere(int level, SphereMesh& mesh, GLfloat radius)
+{
+    releaseSphereMesh(mesh);
+
+    if (level < 0 || level > MaxIcosphereLevel) {
+        cerr << "Error: Icosphere level must be between 0 and " << MaxIcosphereLevel << ": " << level << "\n";
+        return false;
+    }
+
+    size_t face_triangles = (size_t) 1 << (2 * level);
+    SphereMeshHeader* header = initCacheImage(mesh, (uint32_t) (20 * face_triangles));
+    header->radius = radius;  // every vertex lies on the sphere
+    mesh.radius = header->radius;
+
+    parallelFor(20, [&](size_t f) {
+        size_t k = f * face_triangles;
+        subdivideFace(normalize(IcoVertices[IcoFaces[f][0]]), normalize(IcoVertices[IcoFaces[f][1]]),
+                      normalize(IcoVertices[IcoFaces[f][2]]), level, radius, mesh, k);
+    });
+
+    cout << "Generated icosphere of level " << level << " (" << mesh.triangle_count << " triangles)\n";
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// loadSphereMesh(fileName, mesh):
+// Loads the sphere from the binary cache of fileName if it is present and
+// up to date, otherwise converts the text file and creates the cache.
+// A fileName of the form "icosphere.<level>" generates an icosphere instead.
+//
+//----------------------------------------------------------------------------
+bool loadSphereMesh(const string& fileName, SphereMesh& mesh)
+{
+    releaseSphereMesh(mesh);
+
+    // "icosphere.<level>" is generated instead of read from a file
+    int level;
+    char extra;
+    if (sscanf(fileName.c_str(), "icosphere.%d%c", &level, &extra) == 1)
+        return generateIcosphere(level, mesh);
+
+    SphereMeshHeader source;
+    if (!statSourceFile(fileName, source)) {
+        cerr << "Error: Sphere file could not be opened: " << fileName << "\n";
+        return false;
+    }
+
+    string cacheName = fileName + ".mesh";
+
+    if (mapSphereCache(cacheName, source, mesh)) {
+        cout << "Loaded binary mesh cache " << cacheName << "\n";
+        return true;
+    }
+
+    return convertSphereFile(fileName, cacheName, source, mesh);
+}
+
+//----------------------------------------------------------------------------
+// weldSphereMesh(mesh, epsilon, welded):
+// Welds the triangle soup of mesh into an indexed mesh. Vertices are hashed
+// by the epsilon-sized grid cell they fall in; a vertex is merged with an
+// earlier one if both lie within epsilon of each other in each coordinate,
+// so besides its own cell only the 26 neighbouring cells need to be searched.
+// (The smooth normal only depends on the position, so it is welded as well.)
+//
+//----------------------------------------------------------------------------
+void weldSphereMesh(const SphereMesh& mesh, GLfloat epsilon, WeldedSphereMesh& welded)
+{
+    welded.points.clear();
+    welded.normals.clear();
+    welded.indices16.clear();
+    welded.indices32.clear();
+
+    vector<GLuint> indices(mesh.num_vertices);
+    unordered_map<uint64_t, GLuint> cells;  // grid cell --> first unique vertex in it
+    vector<GLuint> next_in_cell;            // chains the unique vertices of a cell
+    const GLuint none = ~0u;
+
+    cells.reserve(mesh.num_vertices / 4);
+
+    // 21 bits per cell coordinate; wrap-around only costs extra comparisons.
+    auto cellKey = [](int64_t cx, int64_t cy, int64_t cz) {
+        return ((uint64_t) (cx & 0x1FFFFF) << 42) | ((uint64_t) (cy & 0x1FFFFF) << 21) | (uint64_t) (cz & 0x1FFFFF);
+    };
+
+    for (int i = 0; i < mesh.num_vertices; i++) {
+        const point4& p = mesh.points[i];
+        int64_t cx = (int64_t) floor(p.x / epsilon);
+        int64_t cy = (int64_t) floor(p.y / epsilon);
+        int64_t cz = (int64_t) floor(p.z / epsilon);
+
+        GLuint found = none;
+        for (int dx = -1; dx <= 1 && found == none; dx++)
+            for (int dy = -1; dy <= 1 && found == none; dy++)
+                for (int dz = -1; dz <= 1 && found == none; dz++) {
+                    unordered_map<uint64_t, GLuint>::const_iterator cell = cells.find(cellKey(cx + dx, cy + dy, cz + dz));
+                    if (cell == cells.end()) continue;
+
+                    for (GLuint u = cell->second; u != none; u = next_in_cell[u]) {
+                        const point4& q = welded.points[u];
+                        if (fabs(p.x - q.x) <= epsilon && fabs(p.y - q.y) <= epsilon && fabs(p.z - q.z) <= epsilon) {
+                            found = u;
+                            break;
+                        }
+                    }
+                }
+
+        if (found == none) {
+            found = (GLuint) welded.points.size();
+            welded.points.push_back(p);
+            welded.normals.push_back(mesh.smooth_normals[i]);
+
+            // Push the new vertex to the front of its cell's chain
+            unordered_map<uint64_t, GLuint>::iterator cell = cells.find(cellKey(cx, cy, cz));
+            if (cell == cells.end()) {
+                next_in_cell.push_back(none);
+                cells[cellKey(cx, cy, cz)] = found;
+            }
+            else {
+                next_in_cell.push_back(cell->second);
+                cell->second = found;
+            }
+        }
+        indices[i] = found;
+    }
+
+    // Use 16-bit indices whenever they are wide enough
+    if (welded.points.size() <= 65536) {
+        welded.index_type = GL_UNSIGNED_SHORT;
+        welded.indices16.assign(indices.begin(), indices.end());
+    }
+    else {
+        welded.index_type = GL_UNSIGNED_INT;
+        welded.indices32.swap(indices);
+    }
+
+    size_t soup_size = mesh.num_vertices * (sizeof(point4) + sizeof(vec3));
+    size_t welded_size = welded.points.size() * (sizeof(point4) + sizeof(vec3)) + welded.indexDataSize();
+    cout << "Welded " << mesh.num_vertices << " sphere vertices into " << welded.points.size()
+         << " unique vertices (ratio " << (mesh.num_vertices > 0 ? (double) welded.points.size() / mesh.num_vertices : 0.0)
+         << ", " << (welded.index_type == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices): smooth buffer "
+         << soup_size << " --> " << welded_size << " bytes, "
+         << (long long) soup_size - (long long) welded_size << " bytes saved\n";
+}
+
+//----------------------------------------------------------------------------
+//
+//  Quantized vertices
+//
+//  Components are rounded to the nearest of the 65535 normalized GLshort
+//  values c / 32767, c = -32767 ... 32767, so the position error is at most
+//  radius / 65534 per coordinate and the octahedral normal error below
+//  0.004 degrees.
+//
+
+static inline GLshort quantizeSnorm16(GLfloat f)
+{
+    f = min(max(f, -1.0f), 1.0f);
+    return (GLshort) lrintf(f * 32767.0f);
+}
+
+//----------------------------------------------------------------------------
+// quantizeSpherePoints(points, count, radius, quantized):
+// Quantizes the x, y, z of count points to normalized GLshorts of x / radius,
+// y / radius and z / radius (all within [-1, 1] as radius is the maximum
+// distance of a point to the origin).
+//
+//----------------------------------------------------------------------------
+void quantizeSpherePoints(const point4* points, size_t count, GLfloat radius, QuantizedPoint* quantized)
+{
+    GLfloat scale = (radius > 0.0f) ? 1.0f / radius : 0.0f;
+
+    for (size_t i = 0; i < count; i++) {
+        quantized[i].x = quantizeSnorm16(points[i].x * scale);
+        quantized[i].y = quantizeSnorm16(points[i].y * scale);
+        quantized[i].z = quantizeSnorm16(points[i].z * scale);
+    }
+}
+
+//----------------------------------------------------------------------------
+// encodeOctahedralNormals(normals, count, encoded):
+// Projects each unit normal onto the octahedron |x| + |y| + |z| = 1 and keeps
+// its x, y; normals of the lower half (z < 0) are first folded outwards over
+// the diagonals, so that the whole sphere maps onto the square [-1, 1]^2.
+// octahedralDecode() in vshader53.glsl inverts this.
+//
+//----------------------------------------------------------------------------
+void encodeOctahedralNormals(const vec3* normals, size_t count, OctahedralNormal* encoded)
+{
+    for (size_t i = 0; i < count; i++) {
+        const vec3& n = normals[i];
+        GLfloat l1 = fabs(n.x) + fabs(n.y) + fabs(n.z);
+        GLfloat u = (l1 > 0.0f) ? n.x / l1 : 0.0f;
+        GLfloat v = (l1 > 0.0f) ? n.y / l1 : 0.0f;
+
+        if (n.z < 0.0f) {
+            GLfloat folded_u = (1.0f - fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            GLfloat folded_v = (1.0f - fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u = folded_u;
+            v = folded_v;
+        }
+
+        encoded[i].u = quantizeSnorm16(u);
+        encoded[i].v = quantizeSnorm16(v);
+    }
+}
+
+//----------------------------------------------------------------------------
+// releaseSphereMesh(mesh):
+// Unmaps / frees the vertex arrays of mesh; the counts and radius are kept.
+//
+//----------------------------------------------------------------------------
+void releaseSphereMesh(SphereMesh& mesh)
+{
+    unmapSphereCache(mesh);
+    vector<char>().swap(mesh.storage);
+
+    mesh.points = NULL;
+    mesh.smooth_normals = NULL;
+}
+
+//----------------------------------------------------------------------------
+// peakMemoryUsage():
+// Returns the peak resident memory (working set) of the process in bytes.
+//
+//----------------------------------------------------------------------------
+size_t peakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#  ifdef __APPLE__
+    return (size_t) usage.ru_maxrss;         // bytes on macOS
+#  else
+    return (size_t) usage.ru_maxrss * 1024;  // kilobytes on Linux
+#  endif
+#endif
+}
@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- sphere-mesh.h ---
+//
+//   Loading of the sphere triangle mesh (sphere.N.txt) as a triangle soup
+//   of points and smooth normals.
+//
+//   The text file is converted on first load into a binary mesh cache
+//   ("<fileName>.mesh"):
+//
+//       SphereMeshHeader
+//       point4 points[num_vertices]
+//       vec3   smooth_normals[num_vertices]
+//
+//   Later loads memory-map the cache instead of parsing the text again.
+//   The sphere VBOs are built from these arrays, not copied from them:
+//   weldSphereMesh() merges the shared vertices into an indexed mesh, which
+//   is then quantized (quantizeSpherePoints(), encodeOctahedralNormals())
+//   and interleaved as the vertex format asks. Streamed spheres upload the
+//   soup chunk by chunk. Flat shading takes its face normals from the
+//   fragment shader, so none are stored.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SPHERE_MESH_H__
+#define __SPHERE_MESH_H__
+
+#include "Angel-yjc.h"
+#include "vertex-format.h"
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef Angel::vec4  point4;
+typedef Angel::vec3  point3;
+
+//----------------------------------------------------------------------------
+//
+//  Binary mesh cache header (native byte order, 32 bytes so that the
+//  point4 block that follows stays 16-byte aligned).
+//
+
+const char     SphereMeshMagic[4] = { 'S', 'P', 'H', 'M' };
+const uint32_t SphereMeshVersion  = 2;  // 2: no flat normals
+
+struct SphereMeshHeader {
+    char     magic[4];        // "SPHM"
+    uint32_t version;         // SphereMeshVersion
+    uint32_t triangle_count;  // number of triangles; num_vertices = 3 * triangle_count
+    GLfloat  radius;          // max distance of a vertex to the origin
+    uint64_t source_size;     // size of the text file the cache was built from
+    int64_t  source_mtime;    // modification time of that text file
+};
+
+//----------------------------------------------------------------------------
+//
+//  SphereMesh - the loaded sphere, either memory-mapped from the binary
+//  cache or (on the first load) held in "storage" with the same layout.
+//
+
+struct SphereMesh {
+    int      triangle_count;
+    int      num_vertices;
+    GLfloat  radius;
+
+    const point4*  points;
+    const vec3*    smooth_normals;
+
+    // Backing memory for the arrays above
+    std::vector<char>  storage;      // in-memory image when not mapped
+    void*              map_base;     // memory-mapped cache file, or NULL
+    size_t             map_size;
+#ifdef _WIN32
+    void*              map_file;     // HANDLEs of the file and its mapping
+    void*              map_handle;
+#endif
+
+    SphereMesh();
+};
+
+//----------------------------------------------------------------------------
+//
+//  WeldedSphereMesh - the smooth-shaded sphere as an indexed mesh: every
+//  vertex shared by several triangles of the (triangle soup) SphereMesh is
+//  stored once and referenced through a 16-bit or 32-bit index buffer.
+//
+
+struct WeldedSphereMesh {
+    std::vector<point4>    points;      // unique vertices
+    std::vector<vec3>      normals;     // their smooth normals
+    std::vector<GLushort>  indices16;   // used if there are at most 65536 unique vertices
+    std::vector<GLuint>    indices32;   // used otherwise
+    GLenum                 index_type;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+    int num_indices() const
+	{ return index_type == GL_UNSIGNED_SHORT ? (int) indices16.size() : (int) indices32.size(); }
+
+    const void* indexData() const
+	{ return index_type == GL_UNSIGNED_SHORT ? (const void*) indices16.data() : (const void*) indices32.data(); }
+
+    size_t indexDataSize() const
+	{ return index_type == GL_UNSIGNED_SHORT ? indices16.size() * sizeof(GLushort) : indices32.size() * sizeof(GLuint); }
+};
+
+//----------------------------------------------------------------------------
+//
+//  Quantized sphere vertices: 10 bytes per vertex planar, 12 interleaved
+//  (each attribute 4-byte aligned), instead of the 28 bytes of a point4 and
+//  a vec3. Both are drawn as normalized GL_SHORT attributes
+//  (decoded to [-1, 1] by the vertex fetch) and decoded by vshader53.glsl:
+//   - QuantizedPoint: x, y, z divided by the sphere radius (w is implied 1.0)
+//   - OctahedralNormal: the unit normal projected onto the octahedron
+//     |x| + |y| + |z| = 1, whose lower half is folded over the upper half
+//
+
+struct QuantizedPoint {
+    GLshort  x, y, z;
+};
+
+struct OctahedralNormal {
+    GLshort  u, v;
+};
+
+namespace Angel {
+
+template <> struct VertexAttributeType<QuantizedPoint> {
+    static const GLint      size = 3;
+    static const GLenum     type = GL_SHORT;
+    static const GLboolean  normalized = GL_TRUE;
+};
+
+template <> struct VertexAttributeType<OctahedralNormal> {
+    static const GLint      size = 2;
+    static const GLenum     type = GL_SHORT;
+    static const GLboolean  normalized = GL_TRUE;
+};
+
+}  // namespace Angel
+
+//----------------------------------------------------------------------------
+//
+//  SphereMeshChunk - a run of consecutive triangles handed out by
+//  streamSphereFile(); the arrays hold 3 * triangle_count vertices that
+//  belong at vertex 3 * first_triangle of the full mesh.
+//
+
+const int SphereStreamChunkTriangles = 16384;  // 16384 * 3 * 28 bytes = 1.4 MB of staging
+
+struct SphereMeshChunk {
+    int            first_triangle;
+    int            triangle_count;
+    const point4*  points;
+    const vec3*    smooth_normals;
+};
+
+//  Load the sphere from fileName, using (and if needed creating) the
+//  binary cache "<fileName>.mesh". Returns false if nothing could be loaded.
+//  fileName "icosphere.<level>" generates the sphere with generateIcosphere().
+bool loadSphereMesh( const std::string& fileName, SphereMesh& mesh );
+
+//  Generate an icosphere of the given radius (a unit icosphere by default)
+//  by subdividing each face of an icosahedron "level" times: 20 * 4^level
+//  triangles, in the same layout as a loaded sphere file, with analytic
+//  smooth normals.
+bool generateIcosphere( int level, SphereMesh& mesh, GLfloat radius = 1.0f );
+
+//  Unmap / free the vertex arrays of mesh (the counts and radius are kept).
+//  Call this once the data has been uploaded to the VBOs.
+void releaseSphereMesh( SphereMesh& mesh );
+
+//  Weld the vertices of mesh that lie within epsilon of each other (in each
+//  coordinate) into welded, and report the unique-vertex ratio and the
+//  bytes saved in the smooth sphere buffer.
+void weldSphereMesh( const SphereMesh& mesh, GLfloat epsilon, WeldedSphereMesh& welded );
+
+//  Quantize count points of a sphere of the given radius (the maximum
+//  distance of a point to the origin) to QuantizedPoint.
+void quantizeSpherePoints( const point4* points, size_t count, GLfloat radius, QuantizedPoint* quantized );
+
+//  Octahedral-encode count unit normals to OctahedralNormal.
+void encodeOctahedralNormals( const vec3* normals, size_t count, OctahedralNormal* encoded );
+
+//  Returns the triangle count on the first line of the sphere file fileName
+//  (without reading the rest of it), or -1 if it cannot be read.
+int sphereFileTriangleCount( const std::string& fileName );
+
+//  Bounded-memory load of very large spheres: reads the binary cache of
+//  fileName (or parses the text file and writes the cache) in chunks of at
+//  most SphereStreamChunkTriangles triangles, so that the whole mesh is
+//  never held in memory. begin(triangle_count) is called once before the
+//  first chunk (e.g. to allocate the VBOs), then chunk() once per chunk in
+//  order; if chunk() returns false the load stops there and false is
+//  returned. A record that is not a triangle of 3 vertices of valid
+//  numbers fails the whole load (and leaves no cache), as it does in the
+//  text parsers below. radius receives the sphere radius, staging_bytes
+//  (if given) the memory used for text and chunk staging.
+bool streamSphereFile( const std::string& fileName, const std::function<void (int)>& begin,
+                       const std::function<bool (const SphereMeshChunk&)>& chunk,
+                       GLfloat& radius, size_t* staging_bytes = NULL );
+
+//  Peak resident memory of the process so far, in bytes (0 if unknown).
+size_t peakMemoryUsage();
+
+//  Fused ingest kernel used by the parsers: computes the smooth normals of
+//  triangle_count triangles from their points in one (SSE2) pass and raises
+//  radius to the maximum distance of a point to the origin.
+void ingestSphereTriangles( const point4* points, size_t triangle_count,
+                            vec3* smooth_normals, GLfloat& radius );
+
+//  The text parsers used to build the cache (also used by bench/); both
+//  return false on the first record that is not a valid triangle:
+//   - readSphereFile(): the original single-threaded ifstream parser
+//   - parseSphereFile(): chunked multithreaded std::from_chars parser that
+//     writes the cache image into mesh.storage
+bool readSphereFile( const std::string& fileName, std::vector<point4>& points,
+                     std::vector<vec3>& smooth_normals );
+bool parseSphereFile( const std::string& fileName, SphereMesh& mesh );
+
+#endif // __SPHERE_MESH_H__
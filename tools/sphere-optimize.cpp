@@ -0,0 +1,322 @@
+/************************************************************
+ * File: sphere-optimize.cpp
+
+ * Offline mesh optimizer for sphere files (sphere.N.txt, or any triangle
+   soup in the same format). The mesh is
+     1. welded into an indexed mesh (weldSphereMesh() in "sphere-mesh.cpp"),
+     2. reordered triangle by triangle for the post-transform vertex cache
+        with Tom Forsyth's "Linear-Speed Vertex Cache Optimisation",
+     3. reordered vertex by vertex in the order the triangles first use them,
+        so that the vertex fetch walks the buffer front to back.
+
+ * The result is written as a sphere file again: its triangles in the
+   optimized order, each welded vertex written with the exact bits of its
+   representative. The renderer loads it like any other sphere file, and its
+   weldSphereMesh() (which numbers vertices in order of first use) rebuilds
+   exactly the optimized index buffer; this is checked after writing.
+
+ * The average cache miss ratio (ACMR, transformed vertices per triangle) and
+   the average transform to vertex ratio (ATVR, transformed vertices per
+   unique vertex, 1.0 at best) are reported for the file order and the
+   optimized order, on a simulated FIFO cache of cache_size entries.
+
+ * Only spheres that the renderer welds benefit: files of 1,000,000 triangles
+   or more are streamed into the VBOs as a triangle soup and drawn without
+   an index buffer, so the new order gives them no vertex cache reuse (a
+   warning is printed for them).
+
+ * Usage: sphere-optimize <input sphere file> <output sphere file> [cache_size]   (default 16)
+**************************************************************/
+
+#include "../sphere-mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+// Welding tolerance of the renderer (see sphere_weld_epsilon in rotate-sphere-texture.cpp)
+const GLfloat weld_epsilon = 1.0e-5f;
+
+// Spheres the renderer streams unwelded (see sphere_stream_min_triangles in rotate-sphere-texture.cpp)
+const int stream_min_triangles = 1000000;
+
+//----------------------------------------------------------------------------
+// indexBuffer(welded):
+// Returns the indices of welded as 32-bit indices.
+//
+//----------------------------------------------------------------------------
+static vector<GLuint> indexBuffer(const WeldedSphereMesh& welded)
+{
+    if (welded.index_type == GL_UNSIGNED_SHORT)
+        return vector<GLuint>(welded.indices16.begin(), welded.indices16.end());
+    return welded.indices32;
+}
+
+//----------------------------------------------------------------------------
+// transformedVertices(indices, num_vertices, cache_size):
+// Returns the number of vertices a FIFO post-transform cache of cache_size
+// entries transforms to draw indices. (A vertex is in the cache if fewer
+// than cache_size misses happened since it was last transformed.)
+//
+//----------------------------------------------------------------------------
+static size_t transformedVertices(const vector<GLuint>& indices, size_t num_vertices, int cache_size)
+{
+    vector<size_t> transformed_at(num_vertices, 0);  // miss count after the vertex was transformed, 0 = never
+    size_t misses = 0;
+
+    for (GLuint v : indices) {
+        if (transformed_at[v] == 0 || misses - transformed_at[v] >= (size_t) cache_size) {
+            misses++;
+            transformed_at[v] = misses;
+        }
+    }
+    return misses;
+}
+
+//----------------------------------------------------------------------------
+//
+//  Forsyth vertex cache optimization
+//
+//  Triangles are emitted greedily: the next triangle is the one with the
+//  highest sum of vertex scores among the triangles of the vertices in a
+//  simulated LRU cache. A vertex scores high if it was used by one of the
+//  last triangles (it is still in the cache) and if few of its triangles
+//  remain (so that it can leave the cache for good).
+//
+
+const int ForsythCacheSize = 32;
+const float ForsythCacheDecayPower = 1.5f;
+const float ForsythLastTriangleScore = 0.75f;
+const float ForsythValenceBoostScale = 2.0f;
+const float ForsythValenceBoostPower = 0.5f;
+
+static float vertexScore(int cache_position, int remaining_triangles)
+{
+    if (remaining_triangles == 0)
+        return -1.0f;  // not needed any more
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3)  // used by the last triangle: the same score for all three
+            score = ForsythLastTriangleScore;
+        else
+            score = pow(1.0f - (cache_position - 3) / (float) (ForsythCacheSize - 3), ForsythCacheDecayPower);
+    }
+
+    return score + ForsythValenceBoostScale * pow((float) remaining_triangles, -ForsythValenceBoostPower);
+}
+
+//----------------------------------------------------------------------------
+// optimizeVertexCache(indices, num_vertices):
+// Returns the triangles of indices in Forsyth's order.
+//
+//----------------------------------------------------------------------------
+static vector<GLuint> optimizeVertexCache(const vector<GLuint>& indices, size_t num_vertices)
+{
+    size_t triangle_count = indices.size() / 3;
+
+    // The triangles of each vertex (in vertex_triangles[first[v] ... first[v] + remaining[v]))
+    vector<int> remaining(num_vertices, 0);
+    vector<size_t> first(num_vertices + 1, 0);
+    for (GLuint v : indices)
+        remaining[v]++;
+    for (size_t v = 0; v < num_vertices; v++)
+        first[v + 1] = first[v] + remaining[v];
+
+    vector<GLuint> vertex_triangles(indices.size());
+    vector<size_t> filled(first.begin(), first.end() - 1);
+    for (size_t t = 0; t < triangle_count; t++)
+        for (int j = 0; j < 3; j++)
+            vertex_triangles[filled[indices[3 * t + j]]++] = (GLuint) t;
+
+    vector<int> cache_position(num_vertices, -1);
+    vector<float> vertex_score(num_vertices);
+    for (size_t v = 0; v < num_vertices; v++)
+        vertex_score[v] = vertexScore(-1, remaining[v]);
+
+    vector<float> triangle_score(triangle_count);
+    vector<bool> emitted(triangle_count, false);
+    for (size_t t = 0; t < triangle_count; t++)
+        triangle_score[t] = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] + vertex_score[indices[3 * t + 2]];
+
+    vector<GLuint> cache, new_cache;
+    vector<GLuint> optimized;
+    optimized.reserve(indices.size());
+
+    size_t next_unemitted = 0;  // triangles before it are all emitted
+    long long best = triangle_count > 0 ? 0 : -1;
+    for (size_t t = 1; t < triangle_count; t++)
+        if (triangle_score[t] > triangle_score[best])
+            best = t;
+
+    while (best >= 0) {
+        // Emit the best triangle and remove it from the triangle lists of its vertices
+        emitted[best] = true;
+        for (int j = 0; j < 3; j++) {
+            GLuint v = indices[3 * best + j];
+            optimized.push_back(v);
+
+            GLuint* triangles = &vertex_triangles[first[v]];
+            GLuint* last = triangles + remaining[v] - 1;
+            *find(triangles, last + 1, (GLuint) best) = *last;
+            remaining[v]--;
+        }
+
+        // Move its vertices to the front of the LRU cache
+        new_cache.assign(indices.begin() + 3 * best, indices.begin() + 3 * best + 3);
+        for (GLuint v : cache)
+            if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2])
+                new_cache.push_back(v);
+        for (size_t i = ForsythCacheSize; i < new_cache.size(); i++)
+            cache_position[new_cache[i]] = -1;  // pushed out
+        for (size_t i = 0; i < new_cache.size(); i++) {
+            GLuint v = new_cache[i];
+            if (i < (size_t) ForsythCacheSize)
+                cache_position[v] = (int) i;
+
+            // Rescore the vertex and its remaining triangles
+            float delta = vertexScore(cache_position[v], remaining[v]) - vertex_score[v];
+            vertex_score[v] += delta;
+            for (int k = 0; k < remaining[v]; k++)
+                triangle_score[vertex_triangles[first[v] + k]] += delta;
+        }
+        if (new_cache.size() > (size_t) ForsythCacheSize)
+            new_cache.resize(ForsythCacheSize);
+        cache.swap(new_cache);
+
+        // The next triangle: the best one touching the cache, else the first one not emitted yet
+        best = -1;
+        for (GLuint v : cache)
+            for (int k = 0; k < remaining[v]; k++) {
+                GLuint t = vertex_triangles[first[v] + k];
+                if (best < 0 || triangle_score[t] > triangle_score[best])
+                    best = t;
+            }
+        if (best < 0) {
+            while (next_unemitted < triangle_count && emitted[next_unemitted])
+                next_unemitted++;
+            if (next_unemitted < triangle_count)
+                best = next_unemitted;
+        }
+    }
+
+    return optimized;
+}
+
+//----------------------------------------------------------------------------
+// optimizeVertexFetch(indices, num_vertices, remap):
+// Renumbers the vertices in the order indices first uses them; remap[new]
+// receives the old number of each vertex.
+//
+//----------------------------------------------------------------------------
+static void optimizeVertexFetch(vector<GLuint>& indices, size_t num_vertices, vector<GLuint>& remap)
+{
+    const GLuint none = ~0u;
+    vector<GLuint> new_index(num_vertices, none);
+    remap.clear();
+
+    for (GLuint& v : indices) {
+        if (new_index[v] == none) {
+            new_index[v] = (GLuint) remap.size();
+            remap.push_back(v);
+        }
+        v = new_index[v];
+    }
+}
+
+//----------------------------------------------------------------------------
+// writeSphereFile(fileName, points, indices):
+// Writes the indexed triangles as a sphere file, with every coordinate
+// printed with enough digits to be read back to the same float.
+//
+//----------------------------------------------------------------------------
+static bool writeSphereFile(const char* fileName, const vector<point4>& points, const vector<GLuint>& indices)
+{
+    FILE* fp = fopen(fileName, "w");
+    if (fp == NULL) {
+        cerr << "Error: Sphere file could not be created: " << fileName << "\n";
+        return false;
+    }
+
+    fprintf(fp, "%d\n", (int) (indices.size() / 3));
+    for (size_t i = 0; i < indices.size(); i++) {
+        const point4& p = points[indices[i]];
+        if (i % 3 == 0)
+            fprintf(fp, "3\n");
+        fprintf(fp, "%.9g %.9g %.9g\n", p.x, p.y, p.z);
+    }
+
+    bool ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok)
+        cerr << "Error: Sphere file could not be written: " << fileName << "\n";
+    return ok;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <input sphere file> <output sphere file> [cache_size]\n";
+        return EXIT_FAILURE;
+    }
+    const char* input = argv[1];
+    const char* output = argv[2];
+    int cache_size = (argc > 3) ? atoi(argv[3]) : 16;
+    if (cache_size < 1) {
+        cerr << "Error: cache_size must be at least 1: " << argv[3] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    SphereMesh mesh;
+    if (!parseSphereFile(input, mesh) || mesh.triangle_count == 0) {
+        cerr << "Error: No triangles could be read from " << input << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (mesh.triangle_count >= stream_min_triangles)
+        cerr << "Warning: " << input << " has " << mesh.triangle_count << " triangles; the renderer streams spheres of "
+             << stream_min_triangles << " or more without an index buffer, so the optimized order does not apply to it\n";
+
+    WeldedSphereMesh welded;
+    weldSphereMesh(mesh, weld_epsilon, welded);
+    vector<GLuint> indices = indexBuffer(welded);
+    size_t num_vertices = welded.points.size();
+    size_t before = transformedVertices(indices, num_vertices, cache_size);
+
+    vector<GLuint> optimized = optimizeVertexCache(indices, num_vertices);
+    vector<GLuint> remap;
+    optimizeVertexFetch(optimized, num_vertices, remap);
+    size_t after = transformedVertices(optimized, num_vertices, cache_size);
+
+    vector<point4> points(remap.size());
+    for (size_t i = 0; i < remap.size(); i++)
+        points[i] = welded.points[remap[i]];
+
+    printf("%-12s  %8s  %8s   (FIFO cache of %d vertices)\n", "", "ACMR", "ATVR", cache_size);
+    printf("%-12s  %8.3f  %8.3f\n", "file order", before / (double) mesh.triangle_count, before / (double) num_vertices);
+    printf("%-12s  %8.3f  %8.3f\n", "optimized", after / (double) mesh.triangle_count, after / (double) num_vertices);
+
+    if (!writeSphereFile(output, points, optimized))
+        return EXIT_FAILURE;
+
+    // The renderer must rebuild the optimized index buffer from the written file
+    SphereMesh written;
+    WeldedSphereMesh rewelded;
+    cout.setstate(ios::failbit);
+    bool read = parseSphereFile(output, written);
+    if (read)
+        weldSphereMesh(written, weld_epsilon, rewelded);
+    cout.clear();
+
+    if (!read || indexBuffer(rewelded) != optimized || rewelded.points.size() != points.size()) {
+        cerr << "Error: " << output << " does not load back as the optimized mesh\n";
+        return EXIT_FAILURE;
+    }
+
+    printf("Wrote %d triangles, %d vertices in vertex cache order to %s\n",
+           mesh.triangle_count, (int) points.size(), output);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- transform-batch.cpp ---
+//
+//   Batched SoA transforms of points and normals (see transform-batch.h).
+//
+//   Each kernel evaluates, lane by lane, exactly the float operations of the
+//   scalar code (mat4 * vec4, mat3 * vec3, normalize()) in the same order,
+//   so the SIMD lanes and the scalar tail both agree with the one-at-a-time
+//   results bit for bit.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "transform-batch.h"
+
+using namespace std;
+
+namespace Angel {
+
+// SIMD square root and division for normalize() (not in ARMv7 NEON)
+#if defined(ANGEL_SIMD_SSE)
+#  define BATCH_SIMD_NORMALIZE
+static inline simd4 simdSqrt( simd4 a )           { return _mm_sqrt_ps( a ); }
+static inline simd4 simdDiv( simd4 a, simd4 b )   { return _mm_div_ps( a, b ); }
+#elif defined(ANGEL_SIMD_NEON) && defined(__aarch64__)
+#  define BATCH_SIMD_NORMALIZE
+static inline simd4 simdSqrt( simd4 a )           { return vsqrtq_f32( a ); }
+static inline simd4 simdDiv( simd4 a, simd4 b )   { return vdivq_f32( a, b ); }
+#endif
+
+//----------------------------------------------------------------------------
+// transformPointRange(m, in, out, begin, end):
+// out[i] = m * in[i] for i in [begin, end): coordinate r of out[i] is
+// m[r][0]*x + m[r][1]*y + m[r][2]*z + m[r][3]*w, as in mat4 * vec4.
+//
+//----------------------------------------------------------------------------
+static void transformPointRange(const mat4& m, const SoAPoints& in, const SoAPointsOut& out,
+                                size_t begin, size_t end)
+{
+    size_t i = begin;
+
+#if defined(ANGEL_SIMD_AVX)
+    for (; i + 8 <= end; i += 8) {
+	__m256  x = _mm256_loadu_ps( in.x + i );
+	__m256  y = _mm256_loadu_ps( in.y + i );
+	__m256  z = _mm256_loadu_ps( in.z + i );
+	__m256  w = in.w ? _mm256_loadu_ps( in.w + i ) : _mm256_set1_ps( 1.0f );
+	GLfloat*  rows[4] = { out.x, out.y, out.z, out.w };
+
+	for ( int r = 0; r < 4; r++ ) {
+	    if ( rows[r] == NULL ) continue;
+	    __m256  sum = _mm256_mul_ps( _mm256_set1_ps( m[r][0] ), x );
+	    sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( m[r][1] ), y ) );
+	    sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( m[r][2] ), z ) );
+	    sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( m[r][3] ), w ) );
+	    _mm256_storeu_ps( rows[r] + i, sum );
+	}
+    }
+#endif // ANGEL_SIMD_AVX
+
+#ifdef ANGEL_SIMD
+    simd4  c[4][4];  // the matrix entries splatted across the lanes
+    for ( int r = 0; r < 4; r++ )
+	for ( int k = 0; k < 4; k++ )
+	    c[r][k] = simdSplat( m[r][k] );
+
+    for (; i + 4 <= end; i += 4) {
+	simd4  x = simdLoad( in.x + i );
+	simd4  y = simdLoad( in.y + i );
+	simd4  z = simdLoad( in.z + i );
+	simd4  w = in.w ? simdLoad( in.w + i ) : simdSplat( 1.0f );
+	GLfloat*  rows[4] = { out.x, out.y, out.z, out.w };
+
+	for ( int r = 0; r < 4; r++ ) {
+	    if ( rows[r] == NULL ) continue;
+	    simd4  sum = simdMul( c[r][0], x );
+	    sum = simdAdd( sum, simdMul( c[r][1], y ) );
+	    sum = simdAdd( sum, simdMul( c[r][2], z ) );
+	    sum = simdAdd( sum, simdMul( c[r][3], w ) );
+	    simdStore( rows[r] + i, sum );
+	}
+    }
+#endif // ANGEL_SIMD
+
+    for (; i < end; i++) {
+	GLfloat  x = in.x[i], y = in.y[i], z = in.z[i], w = in.w ? in.w[i] : 1.0f;
+	GLfloat*  rows[4] = { out.x, out.y, out.z, out.w };
+
+	for ( int r = 0; r < 4; r++ )
+	    if ( rows[r] != NULL )
+		rows[r][i] = m[r][0]*x + m[r][1]*y + m[r][2]*z + m[r][3]*w;
+    }
+}
+
+//----------------------------------------------------------------------------
+// transformNormalRange(m, in, out, begin, end, normalize_flag):
+// out[i] = m * in[i] for i in [begin, end), as in mat3 * vec3, then
+// normalized as normalize() does it (v * (1 / sqrt(dot(v, v)))).
+//
+//----------------------------------------------------------------------------
+static void transformNormalRange(const mat3& m, const SoAPoints& in, const SoAPointsOut& out,
+                                 size_t begin, size_t end, bool normalize_flag)
+{
+    size_t i = begin;
+
+#ifdef ANGEL_SIMD
+    simd4  c[3][3];
+    for ( int r = 0; r < 3; r++ )
+	for ( int k = 0; k < 3; k++ )
+	    c[r][k] = simdSplat( m[r][k] );
+
+    for (; i + 4 <= end; i += 4) {
+	simd4  x = simdLoad( in.x + i );
+	simd4  y = simdLoad( in.y + i );
+	simd4  z = simdLoad( in.z + i );
+	simd4  n[3];
+
+	for ( int r = 0; r < 3; r++ ) {
+	    n[r] = simdMul( c[r][0], x );
+	    n[r] = simdAdd( n[r], simdMul( c[r][1], y ) );
+	    n[r] = simdAdd( n[r], simdMul( c[r][2], z ) );
+	}
+
+#ifdef BATCH_SIMD_NORMALIZE
+	if ( normalize_flag ) {
+	    simd4  dot = simdAdd( simdAdd( simdMul( n[0], n[0] ), simdMul( n[1], n[1] ) ), simdMul( n[2], n[2] ) );
+	    simd4  r = simdDiv( simdSplat( 1.0f ), simdSqrt( dot ) );
+	    n[0] = simdMul( r, n[0] );  n[1] = simdMul( r, n[1] );  n[2] = simdMul( r, n[2] );
+	}
+#endif // BATCH_SIMD_NORMALIZE
+
+	simdStore( out.x + i, n[0] );
+	simdStore( out.y + i, n[1] );
+	simdStore( out.z + i, n[2] );
+
+#ifndef BATCH_SIMD_NORMALIZE
+	if ( normalize_flag ) {
+	    for ( size_t j = i; j < i + 4; j++ ) {
+		vec3  v = normalize( vec3( out.x[j], out.y[j], out.z[j] ) );
+		out.x[j] = v.x;  out.y[j] = v.y;  out.z[j] = v.z;
+	    }
+	}
+#endif // BATCH_SIMD_NORMALIZE
+    }
+#endif // ANGEL_SIMD
+
+    for (; i < end; i++) {
+	vec3  v = m * vec3( in.x[i], in.y[i], in.z[i] );
+	if ( normalize_flag )
+	    v = normalize( v );
+	out.x[i] = v.x;  out.y[i] = v.y;  out.z[i] = v.z;
+    }
+}
+
+//----------------------------------------------------------------------------
+// transformPoints(m, in, out, count):
+// Transforms count SoA points by m (see transform-batch.h).
+//
+//----------------------------------------------------------------------------
+void transformPoints(const mat4& m, const SoAPoints& in, const SoAPointsOut& out, size_t count)
+{
+    transformPointRange(m, in, out, 0, count);
+}
+
+//----------------------------------------------------------------------------
+// transformNormals(m, in, out, count, normalize_flag):
+// Transforms (and normalizes) count SoA normals by m (see transform-batch.h).
+//
+//----------------------------------------------------------------------------
+void transformNormals(const mat3& m, const SoAPoints& in, const SoAPointsOut& out, size_t count,
+                      bool normalize_flag)
+{
+    transformNormalRange(m, in, out, 0, count, normalize_flag);
+}
+
+//----------------------------------------------------------------------------
+// pointsToSoA(points, count, out):
+// Splits count point4s into the SoA arrays of out (w is skipped if NULL).
+//
+//----------------------------------------------------------------------------
+void pointsToSoA(const vec4* points, size_t count, const SoAPointsOut& out)
+{
+    for (size_t i = 0; i < count; i++) {
+        out.x[i] = points[i].x;
+        out.y[i] = points[i].y;
+        out.z[i] = points[i].z;
+        if (out.w != NULL)
+            out.w[i] = points[i].w;
+    }
+}
+
+//----------------------------------------------------------------------------
+// pointsFromSoA(in, count, points):
+// Gathers count SoA points back into point4s (w = 1 if in.w is NULL).
+//
+//----------------------------------------------------------------------------
+void pointsFromSoA(const SoAPoints& in, size_t count, vec4* points)
+{
+    for (size_t i = 0; i < count; i++)
+        points[i] = vec4(in.x[i], in.y[i], in.z[i], in.w ? in.w[i] : 1.0f);
+}
+
+}  // namespace Angel
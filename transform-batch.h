@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- transform-batch.h ---
+//
+//   Batched transforms of many points or normals by one matrix, for CPU-side
+//   geometry work (projecting shadows, bounds, culling) that would otherwise
+//   loop over mat4 * vec4 one point at a time.
+//
+//   The points are given in structure-of-arrays (SoA) layout, one array per
+//   coordinate, so that 4 points (8 with AVX) are transformed per SIMD step
+//   (see the SIMD backend in Angel-yjc.h). The results are bit-identical
+//   to mat4 * vec4 and mat3 * vec3 (followed by normalize()) on each point.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRANSFORM_BATCH_H__
+#define __TRANSFORM_BATCH_H__
+
+#include "Angel-yjc.h"
+#include <stddef.h>
+#include <vector>
+
+namespace Angel {
+
+//----------------------------------------------------------------------------
+//
+//  SoA arrays of count points (x[i], y[i], z[i], w[i]). A NULL w means w = 1
+//  for every input point, or that w is not wanted in the output.
+//
+
+struct SoAPoints {
+    const GLfloat*  x;
+    const GLfloat*  y;
+    const GLfloat*  z;
+    const GLfloat*  w;
+};
+
+struct SoAPointsOut {
+    GLfloat*  x;
+    GLfloat*  y;
+    GLfloat*  z;
+    GLfloat*  w;
+};
+
+//  SoAPointArray - storage for count SoA points, with views for the calls below
+struct SoAPointArray {
+    std::vector<GLfloat>  x, y, z, w;
+
+    void resize( size_t count )
+	{ x.resize( count );  y.resize( count );  z.resize( count );  w.resize( count ); }
+
+    size_t size() const { return x.size(); }
+
+    SoAPoints points() const { return SoAPoints{ x.data(), y.data(), z.data(), w.data() }; }
+    SoAPointsOut out() { return SoAPointsOut{ x.data(), y.data(), z.data(), w.data() }; }
+};
+
+//  Transform count points by m: out[i] = m * in[i].
+//  out may be in (the same arrays), but must not overlap it otherwise.
+void transformPoints( const mat4& m, const SoAPoints& in, const SoAPointsOut& out,
+                      size_t count );
+
+//  Transform count normals (or directions) by m, e.g. a NormalMatrix():
+//  out[i] = m * in[i], normalized if normalize_flag is set. The w arrays of
+//  in and out are not used.
+void transformNormals( const mat3& m, const SoAPoints& in, const SoAPointsOut& out,
+                       size_t count, bool normalize_flag = false );
+
+//  Convert count points between the point4 (array-of-structures) layout of
+//  the VBOs and SoA.
+void pointsToSoA( const vec4* points, size_t count, const SoAPointsOut& out );
+void pointsFromSoA( const SoAPoints& in, size_t count, vec4* points );
+
+}  // namespace Angel
+
+#endif // __TRANSFORM_BATCH_H__
@@ -25,42 +25,39 @@ struct vec2 {
     //  --- Constructors and Destructors ---
     //
 
-    vec2( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec2( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s) {}
 
-    vec2( GLfloat x, GLfloat y ) :
+    constexpr vec2( GLfloat x, GLfloat y ) :
 	x(x), y(y) {}
 
-    vec2( const vec2& v )
-	{ x = v.x;  y = v.y;  }
-
     //
     //  --- Indexing Operator ---
     //
 
     GLfloat& operator [] ( int i ) { return *(&x + i); }
-    const GLfloat operator [] ( int i ) const { return *(&x + i); }
+    GLfloat operator [] ( int i ) const { return *(&x + i); }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec2 operator - () const // unary minus operator
+    constexpr vec2 operator - () const // unary minus operator
 	{ return vec2( -x, -y ); }
 
-    vec2 operator + ( const vec2& v ) const
+    constexpr vec2 operator + ( const vec2& v ) const
 	{ return vec2( x + v.x, y + v.y ); }
 
-    vec2 operator - ( const vec2& v ) const
+    constexpr vec2 operator - ( const vec2& v ) const
 	{ return vec2( x - v.x, y - v.y ); }
 
-    vec2 operator * ( const GLfloat s ) const
+    constexpr vec2 operator * ( const GLfloat s ) const
 	{ return vec2( s*x, s*y ); }
 
-    vec2 operator * ( const vec2& v ) const
+    constexpr vec2 operator * ( const vec2& v ) const
 	{ return vec2( x*v.x, y*v.y ); }
 
-    friend vec2 operator * ( const GLfloat s, const vec2& v )
+    friend constexpr vec2 operator * ( const GLfloat s, const vec2& v )
 	{ return v * s; }
 
     vec2 operator / ( const GLfloat s ) const {
@@ -133,7 +130,7 @@ struct vec2 {
 //  Non-class vec2 Methods
 //
 
-inline
+constexpr
 GLfloat dot( const vec2& u, const vec2& v ) {
     return u.x * v.x + u.y * v.y;
 }
@@ -164,43 +161,42 @@ struct vec3 {
     //  --- Constructors and Destructors ---
     //
 
-    vec3( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec3( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s) {}
 
-    vec3( GLfloat x, GLfloat y, GLfloat z ) :
+    constexpr vec3( GLfloat x, GLfloat y, GLfloat z ) :
 	x(x), y(y), z(z) {}
 
-    vec3( const vec3& v ) { x = v.x;  y = v.y;  z = v.z; }
-
-    vec3( const vec2& v, const float f ) { x = v.x;  y = v.y;  z = f; }
+    constexpr vec3( const vec2& v, const float f ) :
+	x(v.x), y(v.y), z(f) {}
 
     //
     //  --- Indexing Operator ---
     //
 
     GLfloat& operator [] ( int i ) { return *(&x + i); }
-    const GLfloat operator [] ( int i ) const { return *(&x + i); }
+    GLfloat operator [] ( int i ) const { return *(&x + i); }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
     //
 
-    vec3 operator - () const  // unary minus operator
+    constexpr vec3 operator - () const  // unary minus operator
 	{ return vec3( -x, -y, -z ); }
 
-    vec3 operator + ( const vec3& v ) const
+    constexpr vec3 operator + ( const vec3& v ) const
 	{ return vec3( x + v.x, y + v.y, z + v.z ); }
 
-    vec3 operator - ( const vec3& v ) const
+    constexpr vec3 operator - ( const vec3& v ) const
 	{ return vec3( x - v.x, y - v.y, z - v.z ); }
 
-    vec3 operator * ( const GLfloat s ) const
+    constexpr vec3 operator * ( const GLfloat s ) const
 	{ return vec3( s*x, s*y, s*z ); }
 
-    vec3 operator * ( const vec3& v ) const
+    constexpr vec3 operator * ( const vec3& v ) const
 	{ return vec3( x*v.x, y*v.y, z*v.z ); }
 
-    friend vec3 operator * ( const GLfloat s, const vec3& v )
+    friend constexpr vec3 operator * ( const GLfloat s, const vec3& v )
 	{ return v * s; }
 
     vec3 operator / ( const GLfloat s ) const {
@@ -273,7 +269,7 @@ struct vec3 {
 //  Non-class vec3 Methods
 //
 
-inline
+constexpr
 GLfloat dot( const vec3& u, const vec3& v ) {
     return u.x*v.x + u.y*v.y + u.z*v.z ;
 }
@@ -288,7 +284,7 @@ vec3 normalize( const vec3& v ) {
     return v / length(v);
 }
 
-inline
+constexpr
 vec3 cross(const vec3& a, const vec3& b )
 {
     return vec3( a.y * b.z - a.z * b.y,
@@ -297,6 +293,55 @@ vec3 cross(const vec3& a, const vec3& b )
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+//
+//  simd4 - the 4 floats of a vec4 (or a mat4 row) in a SIMD register,
+//  for the SIMD backend selected in Angel-yjc.h
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#if defined(ANGEL_SIMD_SSE)
+
+typedef __m128  simd4;
+
+inline simd4 simdLoad( const GLfloat* p )        { return _mm_loadu_ps( p ); }
+inline void  simdStore( GLfloat* p, simd4 v )    { _mm_storeu_ps( p, v ); }
+inline simd4 simdSplat( GLfloat s )              { return _mm_set1_ps( s ); }
+inline simd4 simdZero()                          { return _mm_setzero_ps(); }
+inline simd4 simdAdd( simd4 a, simd4 b )         { return _mm_add_ps( a, b ); }
+inline simd4 simdSub( simd4 a, simd4 b )         { return _mm_sub_ps( a, b ); }
+inline simd4 simdMul( simd4 a, simd4 b )         { return _mm_mul_ps( a, b ); }
+inline simd4 simdNeg( simd4 a )                  { return _mm_xor_ps( a, _mm_set1_ps( -0.0f ) ); }
+inline simd4 simdSetW( GLfloat w )              { return _mm_set_ps( w, 0.0f, 0.0f, 0.0f ); }  // (0, 0, 0, w)
+
+inline void simdTranspose( simd4& r0, simd4& r1, simd4& r2, simd4& r3 )
+    { _MM_TRANSPOSE4_PS( r0, r1, r2, r3 ); }
+
+#elif defined(ANGEL_SIMD_NEON)
+
+typedef float32x4_t  simd4;
+
+inline simd4 simdLoad( const GLfloat* p )        { return vld1q_f32( p ); }
+inline void  simdStore( GLfloat* p, simd4 v )    { vst1q_f32( p, v ); }
+inline simd4 simdSplat( GLfloat s )              { return vdupq_n_f32( s ); }
+inline simd4 simdZero()                          { return vdupq_n_f32( 0.0f ); }
+inline simd4 simdAdd( simd4 a, simd4 b )         { return vaddq_f32( a, b ); }
+inline simd4 simdSub( simd4 a, simd4 b )         { return vsubq_f32( a, b ); }
+inline simd4 simdMul( simd4 a, simd4 b )         { return vmulq_f32( a, b ); }  // not vmlaq/vfmaq: no fusing
+inline simd4 simdNeg( simd4 a )                  { return vnegq_f32( a ); }
+inline simd4 simdSetW( GLfloat w )              { return vsetq_lane_f32( w, vdupq_n_f32( 0.0f ), 3 ); }  // (0, 0, 0, w)
+
+inline void simdTranspose( simd4& r0, simd4& r1, simd4& r2, simd4& r3 ) {
+    float32x4x2_t  t01 = vtrnq_f32( r0, r1 );  // (r0.x r1.x r0.z r1.z), (r0.y r1.y r0.w r1.w)
+    float32x4x2_t  t23 = vtrnq_f32( r2, r3 );
+    r0 = vcombine_f32( vget_low_f32( t01.val[0] ), vget_low_f32( t23.val[0] ) );
+    r1 = vcombine_f32( vget_low_f32( t01.val[1] ), vget_low_f32( t23.val[1] ) );
+    r2 = vcombine_f32( vget_high_f32( t01.val[0] ), vget_high_f32( t23.val[0] ) );
+    r3 = vcombine_f32( vget_high_f32( t01.val[1] ), vget_high_f32( t23.val[1] ) );
+}
+
+#endif // ANGEL_SIMD_SSE / ANGEL_SIMD_NEON
+
 //////////////////////////////////////////////////////////////////////////////
 //
 //  vec4 - 4D vector
@@ -314,31 +359,49 @@ struct vec4 {
     //  --- Constructors and Destructors ---
     //
 
-    vec4( GLfloat s = GLfloat(0.0) ) :
+    constexpr vec4( GLfloat s = GLfloat(0.0) ) :
 	x(s), y(s), z(s), w(s) {}
 
-    vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
+    constexpr vec4( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) :
 	x(x), y(y), z(z), w(w) {}
 
-    vec4( const vec4& v ) { x = v.x;  y = v.y;  z = v.z;  w = v.w; }
+    constexpr vec4( const vec3& v, const float w = 1.0 ) :
+	x(v.x), y(v.y), z(v.z), w(w) {}
 
-    vec4( const vec3& v, const float w = 1.0 ) : w(w)
-	{ x = v.x;  y = v.y;  z = v.z; }
-
-    vec4( const vec2& v, const float z, const float w ) : z(z), w(w)
-	{ x = v.x;  y = v.y; }
+    constexpr vec4( const vec2& v, const float z, const float w ) :
+	x(v.x), y(v.y), z(z), w(w) {}
 
     //
     //  --- Indexing Operator ---
     //
 
     GLfloat& operator [] ( int i ) { return *(&x + i); }
-    const GLfloat operator [] ( int i ) const { return *(&x + i); }
+    GLfloat operator [] ( int i ) const { return *(&x + i); }
 
     //
     //  --- (non-modifying) Arithematic Operators ---
     //
 
+#ifdef ANGEL_SIMD
+    explicit vec4( simd4 v ) { simdStore( &x, v ); }
+
+    simd4 simd() const { return simdLoad( &x ); }
+
+    vec4 operator - () const  // unary minus operator
+	{ return vec4( simdNeg( simd() ) ); }
+
+    vec4 operator + ( const vec4& v ) const
+	{ return vec4( simdAdd( simd(), v.simd() ) ); }
+
+    vec4 operator - ( const vec4& v ) const
+	{ return vec4( simdSub( simd(), v.simd() ) ); }
+
+    vec4 operator * ( const GLfloat s ) const
+	{ return vec4( simdMul( simdSplat( s ), simd() ) ); }
+
+    vec4 operator * ( const vec4& v ) const
+	{ return vec4( simdMul( simd(), v.simd() ) ); }
+#else
     vec4 operator - () const  // unary minus operator
 	{ return vec4( -x, -y, -z, -w ); }
 
@@ -354,6 +417,7 @@ struct vec4 {
     vec4 operator * ( const vec4& v ) const
         { return vec4( x*v.x, y*v.y, z*v.z, w*v.w ); }  // YJC: Correct version
     //	{ return vec4( x*v.x, y*v.y, z*v.z, w*v.z ); }  // Wrong! Fixed as above
+#endif // ANGEL_SIMD
 
     friend vec4 operator * ( const GLfloat s, const vec4& v )
 	{ return v * s; }
@@ -375,6 +439,19 @@ struct vec4 {
     //  --- (modifying) Arithematic Operators ---
     //
 
+#ifdef ANGEL_SIMD
+    vec4& operator += ( const vec4& v )
+	{ simdStore( &x, simdAdd( simd(), v.simd() ) );  return *this; }
+
+    vec4& operator -= ( const vec4& v )
+	{ simdStore( &x, simdSub( simd(), v.simd() ) );  return *this; }
+
+    vec4& operator *= ( const GLfloat s )
+	{ simdStore( &x, simdMul( simd(), simdSplat( s ) ) );  return *this; }
+
+    vec4& operator *= ( const vec4& v )
+	{ simdStore( &x, simdMul( simd(), v.simd() ) );  return *this; }
+#else
     vec4& operator += ( const vec4& v )
 	{ x += v.x;  y += v.y;  z += v.z;  w += v.w;  return *this; }
 
@@ -386,6 +463,7 @@ struct vec4 {
 
     vec4& operator *= ( const vec4& v )
 	{ x *= v.x, y *= v.y, z *= v.z, w *= v.w;  return *this; }
+#endif // ANGEL_SIMD
 
     vec4& operator /= ( const GLfloat s ) {
 #ifdef DEBUG
@@ -444,7 +522,7 @@ vec4 normalize( const vec4& v ) {
     return v / length(v);
 }
 
-inline
+constexpr
 vec3 cross(const vec4& a, const vec4& b )
 {
     return vec3( a.y * b.z - a.z * b.y,
@@ -452,6 +530,23 @@ vec3 cross(const vec4& a, const vec4& b )
 		 a.x * b.y - a.y * b.x );
 }
 
+//----------------------------------------------------------------------------
+//
+//  Layout: the vectors are plain, trivially copyable arrays of GLfloats, so
+//  arrays of them can be memcpy'd, loaded into SIMD registers and passed to
+//  glBufferData() / glUniform*fv() as they are.
+//
+
+static_assert( std::is_trivially_copyable<vec2>::value && std::is_standard_layout<vec2>::value &&
+	       sizeof(vec2) == 2 * sizeof(GLfloat) && offsetof(vec2, y) == 1 * sizeof(GLfloat),
+	       "vec2 must be 2 packed GLfloats" );
+static_assert( std::is_trivially_copyable<vec3>::value && std::is_standard_layout<vec3>::value &&
+	       sizeof(vec3) == 3 * sizeof(GLfloat) && offsetof(vec3, z) == 2 * sizeof(GLfloat),
+	       "vec3 must be 3 packed GLfloats" );
+static_assert( std::is_trivially_copyable<vec4>::value && std::is_standard_layout<vec4>::value &&
+	       sizeof(vec4) == 4 * sizeof(GLfloat) && offsetof(vec4, w) == 3 * sizeof(GLfloat),
+	       "vec4 must be 4 packed GLfloats" );
+
 //----------------------------------------------------------------------------
 
 }  // namespace Angel
@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- vertex-format.cpp ---
+//
+//   Attribute setup and upload of planar and interleaved vertex buffers
+//   (see vertex-format.h).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "vertex-format.h"
+#include <string.h>
+
+using namespace std;
+
+namespace Angel {
+
+// Alignment of the values in an interleaved vertex (and of its stride)
+const GLsizeiptr VertexAlignment = 4;
+
+VertexFormat& VertexFormat::add( VertexAttribute attribute )
+{
+    if (interleaved) {
+	attribute.vertex_offset = (vertex_size + VertexAlignment - 1) / VertexAlignment * VertexAlignment;
+	vertex_size = (attribute.vertex_offset + attribute.value_size + VertexAlignment - 1) /
+		      VertexAlignment * VertexAlignment;
+    }
+    else {
+	attribute.vertex_offset = 0;
+	vertex_size += attribute.value_size;
+    }
+    attributes.push_back(attribute);
+    return *this;
+}
+
+GLintptr VertexFormat::offset( int i, GLsizeiptr block_vertices ) const
+{
+    if (interleaved)
+	return attributes[i].vertex_offset;
+
+    GLintptr block_offset = 0;
+    for (int j = 0; j < i; j++)
+	block_offset += block_vertices * attributes[j].value_size;
+    return block_offset;
+}
+
+void VertexFormat::setAttributes( GLsizeiptr block_vertices ) const
+{
+    for (int i = 0; i < numAttributes(); i++) {
+	const VertexAttribute& a = attributes[i];
+	glEnableVertexAttribArray(a.location);
+	glVertexAttribPointer(a.location, a.size, a.type, a.normalized, interleaved ? GLsizei(vertex_size) : 0,
+			      BUFFER_OFFSET(offset(i, block_vertices)));
+    }
+}
+
+//----------------------------------------------------------------------------
+// upload(block_vertices, first_vertex, num_vertices, values):
+// A planar buffer gets one glBufferSubData() per attribute block; the
+// vertices of an interleaved one are packed first and uploaded at once.
+//
+//----------------------------------------------------------------------------
+void VertexFormat::upload( GLsizeiptr block_vertices, GLintptr first_vertex, GLsizeiptr num_vertices,
+			   const void* const values[] ) const
+{
+    if (!interleaved) {
+	for (int i = 0; i < numAttributes(); i++) {
+	    GLsizeiptr value_size = attributes[i].value_size;
+	    glBufferSubData(GL_ARRAY_BUFFER, offset(i, block_vertices) + first_vertex * value_size,
+			    num_vertices * value_size, values[i]);
+	}
+	return;
+    }
+
+    vector<unsigned char> packed(bufferSize(num_vertices), 0);
+    for (int i = 0; i < numAttributes(); i++) {
+	const VertexAttribute& a = attributes[i];
+	const unsigned char* value = (const unsigned char*) values[i];
+	unsigned char* out = packed.data() + a.vertex_offset;
+	for (GLsizeiptr v = 0; v < num_vertices; v++, value += a.value_size, out += vertex_size)
+	    memcpy(out, value, a.value_size);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, first_vertex * vertex_size, packed.size(), packed.data());
+}
+
+}  // namespace Angel
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- vertex-format.h ---
+//
+//   Typed description of the vertices of a vertex buffer: the C++ type of
+//   each attribute (point4, vec3, QuantizedPoint, ...) and its attribute
+//   location, from which the GL format of the attribute is derived (see
+//   VertexAttributeType), in one of two layouts:
+//
+//     planar:       all values of the first attribute, then all values of
+//                   the second one, ... (a block of block_vertices values
+//                   per attribute)
+//     interleaved:  the values of the attributes of the first vertex, then
+//                   those of the second vertex, ... (one vertex every
+//                   stride() bytes), so that a vertex fetch reads a single
+//                   run of memory
+//
+//   The description sets up the attribute pointers of the buffer
+//   (setAttributes()) and uploads the vertices into it from one array per
+//   attribute, whatever the layout (upload()).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VERTEX_FORMAT_H__
+#define __VERTEX_FORMAT_H__
+
+#include "Angel-yjc.h"
+#include <vector>
+
+namespace Angel {
+
+//----------------------------------------------------------------------------
+//
+//  VertexAttributeType<T> - the GL format of a vertex attribute stored as T:
+//  size components of type, normalized to [-1, 1] (or [0, 1]) or not.
+//  Specialize it for any other type stored in a vertex buffer.
+//
+
+template <class T> struct VertexAttributeType;
+
+template <> struct VertexAttributeType<vec2> {
+    static const GLint      size = 2;
+    static const GLenum     type = GL_FLOAT;
+    static const GLboolean  normalized = GL_FALSE;
+};
+
+template <> struct VertexAttributeType<vec3> {
+    static const GLint      size = 3;
+    static const GLenum     type = GL_FLOAT;
+    static const GLboolean  normalized = GL_FALSE;
+};
+
+template <> struct VertexAttributeType<vec4> {
+    static const GLint      size = 4;
+    static const GLenum     type = GL_FLOAT;
+    static const GLboolean  normalized = GL_FALSE;
+};
+
+//  One attribute of a VertexFormat
+struct VertexAttribute {
+    GLuint      location;
+    GLint       size;
+    GLenum      type;
+    GLboolean   normalized;
+    GLsizeiptr  value_size;     // sizeof(T)
+    GLsizeiptr  vertex_offset;  // offset of the value in an interleaved vertex
+};
+
+class VertexFormat {
+public:
+    VertexFormat( bool interleaved = false ) : interleaved(interleaved), vertex_size(0) {}
+
+    //  Append an attribute stored as T (see VertexAttributeType) at location
+    template <class T>
+    VertexFormat& add( GLuint location )
+	{
+	    VertexAttribute attribute = { location, VertexAttributeType<T>::size, VertexAttributeType<T>::type,
+					  VertexAttributeType<T>::normalized, GLsizeiptr(sizeof(T)), 0 };
+	    return add( attribute );
+	}
+
+    bool isInterleaved() const { return interleaved; }
+    int  numAttributes() const { return int(attributes.size()); }
+    const VertexAttribute& attribute( int i ) const { return attributes[i]; }
+
+    //  Bytes between two vertices of an interleaved buffer (with the padding
+    //  that keeps each value 4-byte aligned), or the sum of the value sizes
+    //  of a planar one
+    GLsizeiptr stride() const { return vertex_size; }
+
+    //  Size of a buffer of num_vertices vertices
+    GLsizeiptr bufferSize( GLsizeiptr num_vertices ) const { return num_vertices * vertex_size; }
+
+    //  Offset of the value of attribute i of the first vertex in a buffer
+    //  whose planar blocks hold block_vertices values
+    GLintptr offset( int i, GLsizeiptr block_vertices ) const;
+
+    //  Enable and point the attributes at the buffer bound to GL_ARRAY_BUFFER
+    //  (recorded in the bound vertex array)
+    void setAttributes( GLsizeiptr block_vertices ) const;
+
+    //  Upload num_vertices vertices at first_vertex of the buffer bound to
+    //  GL_ARRAY_BUFFER, from one array of num_vertices values per attribute
+    //  (values[i] for attribute i, in the attribute's type)
+    void upload( GLsizeiptr block_vertices, GLintptr first_vertex, GLsizeiptr num_vertices,
+		 const void* const values[] ) const;
+
+private:
+    VertexFormat& add( VertexAttribute attribute );
+
+    bool                          interleaved;
+    GLsizeiptr                    vertex_size;
+    std::vector<VertexAttribute>  attributes;
+};
+
+}  // namespace Angel
+
+#endif // __VERTEX_FORMAT_H__
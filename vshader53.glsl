@@ -1,8 +1,17 @@
 /* 
 File Name: "vshader53.glsl":
 Vertex shader:
-  - Per vertex shading for a single point light source and other light sources;
+  - Per vertex shading for a single point light source and other light sources
+    (flat shading is done per fragment, in fshader53.glsl);
   - Entire shading computation is done in the Eye Frame.
+  - Compiled into one program per combination of the options it is specialized
+    on (#defined to their values by InitShader(), see shader_options in
+    rotate-sphere-texture.cpp):
+      LIGHTING, WIREFRAME, FLAT_SHADING, SPOTLIGHT  (0 or 1)
+      UNLIT_COLOR         0: MaterialDiffuse, 1: shadow, 2: wireframe (unlit only)
+      QUANTIZED_POSITION  vPosition.xyz is the position divided by PositionScale
+      OCTAHEDRAL_NORMAL   vNormal.xy is the octahedral encoding of the normal
+    and the options of fshader53.glsl, which the vertex shader does not test.
 */
 
 #version 150  // YJC: Comment/un-comment this line to resolve compilation errors
@@ -21,143 +30,166 @@ out vec2 texCoord2D;
 
 out vec2 latticeTexCoord;
 
-// Shading/Lighting Flags
-uniform bool IsAxesEnabled;
-uniform bool IsPlaneEnabled;
-uniform bool IsWireframeEnabled;
-uniform bool IsShadowEnabled;
-uniform bool IsLightingEnabled;
-uniform bool IsFlatShadingEnabled;
-uniform bool IsSmoothShadingEnabled;
-uniform bool IsSpotlight;      // false => point source, true => spotlight
-
-uniform mat4 ModelView;
-uniform mat4 Projection;
-uniform mat3 NormalMatrix;
-
-uniform vec4 GlobalAmbient; 
-
-uniform vec4 LightDirection;     // Directional light direction (w = 0.0) (passed in eye frame) [originally in eye]
-uniform vec4 DirLightAmbient;
-uniform vec4 DirLightDiffuse;
-uniform vec4 DirLightSpecular;
-
-uniform vec4 LightPosition;   // Positional light direction (w = 1.0) (passed in eye frame)
-uniform vec4 LightAmbient;     
-uniform vec4 LightDiffuse;
-uniform vec4 LightSpecular;
-
-uniform vec3 SpotlightDirection;    // Spot light direction (passed in eye frame)
-uniform float SpotlightExponent;    // Spot exponent
-uniform float SpotlightCutoff;      // Spot cutoff angle in radians
-   
-uniform vec4 MaterialAmbient;
-uniform vec4 MaterialDiffuse;
-uniform vec4 MaterialSpecular;
-
-uniform float Shininess;
-
-uniform float ConstAtt;  // Constant Attenuation
-uniform float LinearAtt; // Linear Attenuation
-uniform float QuadAtt;   // Quadratic Attenuation
+// Frame-constant lighting, with the positional light and the spotlight in the
+// eye frame (LightingBlock in rotate-sphere-texture.cpp)
+layout(std140) uniform Lighting {
+    vec4 GlobalAmbient;
+
+    vec4 LightDirection;     // Directional light direction (w = 0.0) (passed in eye frame) [originally in eye]
+    vec4 DirLightAmbient;
+    vec4 DirLightDiffuse;
+    vec4 DirLightSpecular;
+
+    vec4 LightPosition;   // Positional light direction (w = 1.0) (passed in eye frame)
+    vec4 LightAmbient;
+    vec4 LightDiffuse;
+    vec4 LightSpecular;
+
+    vec3 SpotlightDirection;    // Spot light direction (passed in eye frame)
+    float SpotlightExponent;    // Spot exponent
+    float SpotlightCutoff;      // Spot cutoff angle in radians
+
+    float ConstAtt;  // Constant Attenuation
+    float LinearAtt; // Linear Attenuation
+    float QuadAtt;   // Quadratic Attenuation
+};
+
+// Per-object transforms, material and texture mapping modes (ObjectBlock in
+// rotate-sphere-texture.cpp), one block range per draw; the same block as in fshader53.glsl
+layout(std140, row_major) uniform Object {
+    mat4 ModelView;
+    mat3 NormalMatrix;
+
+    vec4 MaterialAmbient;
+    vec4 MaterialDiffuse;
+    vec4 MaterialSpecular;
+    float Shininess;
+
+    // Quantized sphere vertices (QuantizedPoint / OctahedralNormal in sphere-mesh.h)
+    float PositionScale;       // the sphere radius (with QUANTIZED_POSITION)
+
+    // Texture Mapping / Lattice Modes
+    bool IsEyeSpace;
+    int SphereMappingMode;
+    int LatticeMappingMode; // 0 = upright, 1 = tilted
+};
 
-// Texture Mapping / Lattice Flags
-uniform bool IsEyeSpace;
-uniform int SphereMappingMode;
-
-uniform bool IsLatticeOn;
-uniform int LatticeMappingMode; // 0 = upright, 1 = tilted
+uniform mat4 Projection;
 
-void main()
+// Unfolds an octahedral-encoded normal (see encodeOctahedralNormals())
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);   // the folded lower half
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+// Lights a point at pos (eye frame) with normal N, turned towards the viewer;
+// the same function as in fshader53.glsl, which uses it for flat shading
+vec4 shade(vec3 pos, vec3 N)
 {
-    // Transform vertex  position into eye coordinates
-    vec3 pos = (ModelView * vPosition).xyz;
-
-    vec3 N = normalize(NormalMatrix * vNormal);
-
     vec3 E = normalize(-pos); // Viewer eye vector
 
     if (dot(N, E) < 0) N = -N;
 
-    if (IsLightingEnabled) {
-        if (IsWireframeEnabled) {  // Wireframe mode (no lighting or shading)
-            color = vec4(1.0, 0.84, 0.0, 1.0); // Wireframe color (yellow)
-            gl_Position = Projection * ModelView * vPosition;
-            return;
-        }
-
-        vec4 totalColor = GlobalAmbient * MaterialAmbient;
+    vec4 totalColor = GlobalAmbient * MaterialAmbient;
 
-        // Directional Light 
-        vec3 dir_L = normalize(-LightDirection.xyz);
-        vec3 dir_H = normalize(dir_L + E);
+    // Directional Light 
+    vec3 dir_L = normalize(-LightDirection.xyz);
+    vec3 dir_H = normalize(dir_L + E);
 
-        float dir_d = max(dot(N, dir_L), 0.0);
-        vec4 dirDiffuse = dir_d * DirLightDiffuse * MaterialDiffuse;
+    float dir_d = max(dot(N, dir_L), 0.0);
+    vec4 dirDiffuse = dir_d * DirLightDiffuse * MaterialDiffuse;
 
-        float dir_s = pow(max(dot(N, dir_H), 0.0), Shininess);
-        vec4 dirSpecular = dir_s * DirLightSpecular * MaterialSpecular;
+    float dir_s = pow(max(dot(N, dir_H), 0.0), Shininess);
+    vec4 dirSpecular = dir_s * DirLightSpecular * MaterialSpecular;
 
-        if (dot(N, dir_L) < 0.0) dirSpecular = vec4(0.0);
+    if (dot(N, dir_L) < 0.0) dirSpecular = vec4(0.0);
 
-        float attenuation = 1.0;
+    float attenuation = 1.0;
 
-        totalColor += attenuation * (DirLightAmbient * MaterialAmbient + dirDiffuse + dirSpecular);
+    totalColor += attenuation * (DirLightAmbient * MaterialAmbient + dirDiffuse + dirSpecular);
 
-        // Positional Light
-        vec3 pos_L = LightPosition.xyz - pos;
-        float distance = length(pos_L);
-        pos_L = normalize(pos_L);
-        vec3 pos_H = normalize(pos_L + E);
+    // Positional Light
+    vec3 pos_L = LightPosition.xyz - pos;
+    float distance = length(pos_L);
+    pos_L = normalize(pos_L);
+    vec3 pos_H = normalize(pos_L + E);
 
-        attenuation = 1.0 / (ConstAtt + LinearAtt * distance + QuadAtt * distance * distance);
+    attenuation = 1.0 / (ConstAtt + LinearAtt * distance + QuadAtt * distance * distance);
 
-        float pos_d = max(dot(N, pos_L), 0.0);
-        vec4 posDiffuse = pos_d * LightDiffuse * MaterialDiffuse;
+    float pos_d = max(dot(N, pos_L), 0.0);
+    vec4 posDiffuse = pos_d * LightDiffuse * MaterialDiffuse;
 
-        float pos_s = pow(max(dot(N, pos_H), 0.0), Shininess);
-        vec4 posSpecular = pos_s * LightSpecular * MaterialSpecular;
+    float pos_s = pow(max(dot(N, pos_H), 0.0), Shininess);
+    vec4 posSpecular = pos_s * LightSpecular * MaterialSpecular;
 
-        if (dot(N, pos_L) < 0.0) posSpecular = vec4(0.0);
-
-        // Spotlight
-        vec4 spotlightAttenuation = vec4(1.0); // Starting value for spotEffect
-        if (IsSpotlight) {
-            float spotCos = dot(normalize(SpotlightDirection), -pos_L); // pos_L points from light to vert & SpotlightDirection is already in the eye frame
-            if (spotCos < cos(SpotlightCutoff)) { // SpotlightCutOff is already in radians
-                spotlightAttenuation = vec4(0.0); // outside spotlight cone
-            }
-            else {
-                spotlightAttenuation = vec4(pow(spotCos, SpotlightExponent));
-            }
-        }
+    if (dot(N, pos_L) < 0.0) posSpecular = vec4(0.0);
 
-        vec4 posAmbient = LightAmbient * MaterialAmbient;
-        totalColor += attenuation * spotlightAttenuation * (posAmbient + posDiffuse + posSpecular);
-
-        color = totalColor;
-    }
-    else {
-        if (IsAxesEnabled || IsPlaneEnabled) {
-            color = MaterialDiffuse;
-        }
-        else if (IsShadowEnabled) {  // Shadow effect (if enabled)
-            color = vec4(0.25, 0.25, 0.25, 0.65); // Dark shadow with transparency
-        }
-        else if (IsWireframeEnabled) {  // Wireframe mode (no lighting or shading)
-            color = vec4(1.0, 0.84, 0.0, 1.0); // Wireframe color (yellow)
+    // Spotlight
+    vec4 spotlightAttenuation = vec4(1.0); // Starting value for spotEffect
+#if SPOTLIGHT
+    {
+        float spotCos = dot(normalize(SpotlightDirection), -pos_L); // pos_L points from light to vert & SpotlightDirection is already in the eye frame
+        if (spotCos < cos(SpotlightCutoff)) { // SpotlightCutOff is already in radians
+            spotlightAttenuation = vec4(0.0); // outside spotlight cone
         }
         else {
-            color = MaterialDiffuse;
+            spotlightAttenuation = vec4(pow(spotCos, SpotlightExponent));
         }
     }
+#endif
+
+    vec4 posAmbient = LightAmbient * MaterialAmbient;
+    totalColor += attenuation * spotlightAttenuation * (posAmbient + posDiffuse + posSpecular);
+
+    return totalColor;
+}
+
+void main()
+{
+#if QUANTIZED_POSITION
+    vec4 position = vec4(vPosition.xyz * PositionScale, 1.0);
+#else
+    vec4 position = vPosition;
+#endif
+
+#if LIGHTING
+#if WIREFRAME  // Wireframe mode (no lighting or shading)
+    color = vec4(1.0, 0.84, 0.0, 1.0); // Wireframe color (yellow)
+    gl_Position = Projection * ModelView * position;
+    return;
+#elif FLAT_SHADING
+    // A flat shaded object is lit per fragment with the normal of its face (see fshader53.glsl)
+    color = vec4(1.0);
+#else
+#if OCTAHEDRAL_NORMAL
+    vec3 normal = octahedralDecode(vNormal.xy);
+#else
+    vec3 normal = vNormal;
+#endif
+    // Transform vertex  position into eye coordinates
+    vec3 pos = (ModelView * position).xyz;
+    color = shade(pos, normalize(NormalMatrix * normal));
+#endif
+#else
+#if UNLIT_COLOR == 1  // Shadow effect (if enabled)
+    color = vec4(0.25, 0.25, 0.25, 0.65); // Dark shadow with transparency
+#elif UNLIT_COLOR == 2  // Wireframe mode (no lighting or shading)
+    color = vec4(1.0, 0.84, 0.0, 1.0); // Wireframe color (yellow)
+#else
+    color = MaterialDiffuse;
+#endif
+#endif
 
     // Final transformation
-    gl_Position = Projection * ModelView * vPosition;
+    gl_Position = Projection * ModelView * position;
 
-    eyePosition = ModelView * vPosition;
+    eyePosition = ModelView * position;
 
-    vec4 vert = IsEyeSpace ? ModelView * vPosition : vPosition;
+    vec4 vert = IsEyeSpace ? ModelView * position : position;
 
     // 1-D Sphere Texture Coord Mapping
     if (SphereMappingMode == 0)       // Vertical
@@ -178,9 +210,9 @@ void main()
     texCoord = vTexCoord;
 
     if (LatticeMappingMode == 0) { // Upright
-        latticeTexCoord = vec2(0.5 * (vPosition.x + 1.0), 0.5 * (vPosition.y + 1.0));
+        latticeTexCoord = vec2(0.5 * (position.x + 1.0), 0.5 * (position.y + 1.0));
     }
     else { // Tilted
-        latticeTexCoord = vec2(0.3 * (vPosition.x + vPosition.y + vPosition.z), 0.3 * (vPosition.x - vPosition.y + vPosition.z));
+        latticeTexCoord = vec2(0.3 * (position.x + position.y + position.z), 0.3 * (position.x - position.y + position.z));
     }
 }
\ No newline at end of file